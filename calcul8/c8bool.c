@@ -23,6 +23,7 @@
 #include "c8buf.h"
 #include "c8objimp.h"
 #include "c8ops.h"
+#include "c8heap.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -36,7 +37,7 @@ static void c8bool_destroy(struct c8obj* o)
 {
   struct c8bool* oo = to_c8bool(o);
   assert(oo);
-  free(oo);
+  c8heap_free(oo);
 }
 
 static struct c8obj* c8bool_copy(const struct c8obj* o)
@@ -98,12 +99,22 @@ static struct c8obj* c8bool_op(struct c8obj* o, int op, struct c8obj* p)
   return 0;
 }
 
+static void c8bool_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8bool* oo = to_const_c8bool(o);
+  assert(oo);
+  st->bytes = sizeof(struct c8bool);
+}
+
 static const struct c8obj_imp c8bool_imp = {
   c8bool_destroy,
   c8bool_copy,
   c8bool_int,
   c8bool_str,
-  c8bool_op
+  c8bool_op,
+  0,
+  c8bool_stat,
+  "bool"
 };
 
 const struct c8bool* to_const_c8bool(const struct c8obj* o)
@@ -119,7 +130,7 @@ struct c8bool* to_c8bool(struct c8obj* o)
 
 struct c8bool* c8bool_create(int value)
 {
-  struct c8bool* oo = malloc(sizeof(struct c8bool));
+  struct c8bool* oo = c8heap_alloc(sizeof(struct c8bool));
   assert(oo);
   c8obj_init(&oo->base, &c8bool_imp);
   oo->value = value;
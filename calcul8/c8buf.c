@@ -36,6 +36,18 @@ char* copy_str(const char* str)
   return cstr;
 }
 
+unsigned int hash_strn(const char* str, int n)
+{
+  assert(str);
+  // FNV-1a
+  unsigned int h = 2166136261u;
+  for (int i=0; i<n; ++i) {
+    h ^= (unsigned char)str[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
 void c8buf_init(struct c8buf* o)
 {
   o->len = 0;
@@ -128,3 +140,33 @@ void c8buf_append_fmt(struct c8buf* o, const char* fmt, ...)
   memcpy(o->data+pl, str, sl+1);
   free(str);
 }
+
+char* c8buf_reserve(struct c8buf* o, int n)
+{
+  assert(o);
+  assert(n >= 0);
+  if (o->len+n+1 > o->max) {
+    int len = o->len;
+    o->len += n;
+    c8buf_realloc(o);
+    o->len = len;
+  }
+  return o->data + o->len;
+}
+
+void c8buf_commit(struct c8buf* o, int n)
+{
+  assert(o);
+  assert(o->len+n+1 <= o->max);
+  o->len += n;
+  o->data[o->len] = 0;
+}
+
+void c8buf_truncate(struct c8buf* o, int n)
+{
+  assert(o);
+  assert(n >= 0 && n <= o->len);
+  if (!o->data) return;
+  o->len = n;
+  o->data[o->len] = 0;
+}
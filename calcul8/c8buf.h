@@ -24,6 +24,10 @@
  */
 char* copy_str(const char* cstr);
 
+/** Returns a hash of n characters of a string
+ */
+unsigned int hash_strn(const char* str, int n);
+
 /** Buffer/string
  */
 struct c8buf {
@@ -45,3 +49,14 @@ void c8buf_append_buf(struct c8buf* o, const struct c8buf* buf);
 void c8buf_append_strn(struct c8buf* o, const char* str, int n);
 void c8buf_append_str(struct c8buf* o, const char* str);
 void c8buf_append_fmt(struct c8buf* o, const char* fmt, ...);
+
+/** Append in place
+ * c8buf_reserve makes room for n more characters and returns where they
+ * go, then c8buf_commit appends the n or fewer that were written there.
+ */
+char* c8buf_reserve(struct c8buf* o, int n);
+void c8buf_commit(struct c8buf* o, int n);
+
+/** Shorten to the first n characters
+ */
+void c8buf_truncate(struct c8buf* o, int n);
@@ -24,10 +24,18 @@
 #include "c8obj.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+struct c8ctx_lazy {
+  char* name;
+  c8ctx_lazy_func f;
+  struct c8ctx_lazy* next;
+};
+
 struct c8ctx {
   struct c8map* lib;
+  struct c8ctx_lazy* lazy;
 };
 
 struct c8ctx* c8ctx_create()
@@ -35,6 +43,7 @@ struct c8ctx* c8ctx_create()
   struct c8ctx* o = malloc(sizeof(struct c8ctx));
   assert(o);
   o->lib = c8map_create();
+  o->lazy = 0;
   return o;
 }
 
@@ -42,6 +51,12 @@ void c8ctx_destroy(struct c8ctx* o)
 {
   assert(o);
   c8obj_unref((struct c8obj*)o->lib);
+  while (o->lazy) {
+    struct c8ctx_lazy* l = o->lazy;
+    o->lazy = l->next;
+    free(l->name);
+    free(l);
+  }
   free(o);
 }
 
@@ -52,8 +67,25 @@ void c8ctx_add(struct c8ctx* o, const char* name, struct c8obj* obj)
   c8obj_unref(obj);
 }
 
+void c8ctx_add_lazy(struct c8ctx* o, const char* name, c8ctx_lazy_func f)
+{
+  assert(o);
+  assert(f);
+  struct c8ctx_lazy* l = malloc(sizeof(struct c8ctx_lazy));
+  assert(l);
+  l->name = strdup(name);
+  l->f = f;
+  l->next = o->lazy;
+  o->lazy = l;
+}
+
 struct c8obj* c8ctx_resolve(struct c8ctx* o, const char* name)
 {
   assert(o);
-  return c8map_lookup(o->lib, name);
+  struct c8obj* obj = c8map_lookup(o->lib, name);
+  if (obj) return obj;
+  for (struct c8ctx_lazy* l = o->lazy; l; l = l->next) {
+    if (strcmp(l->name, name) == 0) return (l->f)(name);
+  }
+  return 0;
 }
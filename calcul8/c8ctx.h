@@ -35,6 +35,12 @@ void c8ctx_destroy(struct c8ctx* o);
  */
 void c8ctx_add(struct c8ctx* o, const char* name, struct c8obj* obj);
 
+/** Add a named object which is created by a function each time it is
+ * resolved, for values which are costly to make or depend on settings
+ */
+typedef struct c8obj* (*c8ctx_lazy_func)(const char* name);
+void c8ctx_add_lazy(struct c8ctx* o, const char* name, c8ctx_lazy_func f);
+
 /** Resolve a named object in the context
  */
 struct c8obj* c8ctx_resolve(struct c8ctx* o, const char* name);
@@ -95,7 +95,8 @@ static int c8decl_run(struct c8stmt* o, struct c8script* script)
   if (!group) return C8_RUN_ERROR;
   
   struct c8eval* eval = c8script_eval(script);
-  struct c8obj* init = c8eval_expr(eval, c8buf_str(&oo->initialiser));
+  struct c8obj* init =
+    c8obj_take(c8eval_expr(eval, c8buf_str(&oo->initialiser)));
   struct c8ctx* ctx = c8group_ctx(group);
   c8ctx_add(ctx, c8buf_str(&oo->name), init);
 
@@ -21,6 +21,7 @@
 #include "c8error.h"
 #include "c8objimp.h"
 #include "c8buf.h"
+#include "c8heap.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -35,7 +36,8 @@ static void c8error_destroy(struct c8obj* o)
 {
   struct c8error* oo = to_c8error(o);
   assert(oo);
-  free(oo);
+  c8buf_clear(&oo->arg);
+  c8heap_free(oo);
 }
 
 static struct c8obj* c8error_copy(const struct c8obj* o)
@@ -72,6 +74,12 @@ static void c8error_str(const struct c8obj* o, struct c8buf* buf, int f)
       c8buf_append_str(buf, "precision - real type required"); break;
     case C8_ERROR_PRECISION_COMPLEX:
       c8buf_append_str(buf, "precision - complex type required"); break;
+    case C8_ERROR_FILE:
+      c8buf_append_str(buf, "file"); break;
+    case C8_ERROR_FORMAT:
+      c8buf_append_str(buf, "bad encoding"); break;
+    case C8_ERROR_UNVERIFIED:
+      c8buf_append_str(buf, "unverified result"); break;
     default:
       c8buf_append_str(buf, "unknown"); break;
   }
@@ -87,12 +95,22 @@ static struct c8obj* c8error_op(struct c8obj* o, int op, struct c8obj* p)
   return 0;
 }
 
+static void c8error_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8error* oo = to_const_c8error(o);
+  assert(oo);
+  st->bytes = sizeof(struct c8error) + oo->arg.max;
+}
+
 static const struct c8obj_imp c8error_imp = {
   c8error_destroy,
   c8error_copy,
   c8error_int,
   c8error_str,
-  c8error_op
+  c8error_op,
+  0,
+  c8error_stat,
+  "error"
 };
 
 const struct c8error* to_const_c8error(const struct c8obj* o)
@@ -108,10 +126,9 @@ struct c8error* to_c8error(struct c8obj* o)
 
 struct c8error* c8error_create(int code)
 {
-  struct c8error* oo = malloc(sizeof(struct c8error));
+  struct c8error* oo = c8heap_alloc(sizeof(struct c8error));
   assert(oo);
-  oo->base.refs = 1;
-  oo->base.imp = &c8error_imp;
+  c8obj_init(&oo->base, &c8error_imp);
   oo->code = code;
   c8buf_init(&oo->arg);
   return oo;
@@ -119,10 +136,9 @@ struct c8error* c8error_create(int code)
 
 struct c8error* c8error_create_arg(int code, const char* arg)
 {
-  struct c8error* oo = malloc(sizeof(struct c8error));
+  struct c8error* oo = c8heap_alloc(sizeof(struct c8error));
   assert(oo);
-  oo->base.refs = 1;
-  oo->base.imp = &c8error_imp;
+  c8obj_init(&oo->base, &c8error_imp);
   oo->code = code;
   c8buf_init_str(&oo->arg, arg);
   return oo;
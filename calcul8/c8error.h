@@ -30,6 +30,9 @@
 #define C8_ERROR_PARENTHESIS 5
 #define C8_ERROR_PRECISION_REAL 6
 #define C8_ERROR_PRECISION_COMPLEX 7
+#define C8_ERROR_FILE 8
+#define C8_ERROR_FORMAT 9
+#define C8_ERROR_UNVERIFIED 10
 
 struct c8error;
 struct c8obj;
@@ -30,6 +30,7 @@
 #include "c8num.h"
 #include "c8ctx.h"
 #include "c8debug.h"
+#include "c8gc.h"
 
 #define _GNU_SOURCE
 #include <assert.h>
@@ -55,6 +56,10 @@ struct c8eval {
   struct c8buf name;
   struct c8obj* value;
   struct c8list* list;
+  int defer; // set to ask for a final product or power to be left to the caller
+  struct c8obj* factor; // where it is left, as result factor_op factor
+  int factor_op;
+  struct c8num_settings num;
 };
 
 static struct c8obj* expression(struct c8eval* o, int p, int f, int ex);
@@ -64,10 +69,63 @@ static struct c8obj* resolve(struct c8eval* o, const char* name);
 
 static void next(struct c8eval* o);
 
+// Finish an operation left unevaluated for fusing with the next one
+static struct c8obj* settle(struct c8obj* left, struct c8obj** pending,
+                            int op)
+{
+  if (!*pending) return left;
+  struct c8obj* r = c8obj_op(left, op, *pending);
+  c8obj_unref(left);
+  c8obj_unref(*pending);
+  *pending = 0;
+  return r;
+}
+
+// Whether an operation can be fused with the op following it
+static int fuses(int op, int next_op)
+{
+  if (C8_OP_MULTIPLY == op) {
+    return (C8_OP_ADD == next_op || C8_OP_SUBTRACT == next_op);
+  }
+  if (C8_OP_POWER == op) return (C8_OP_MODULUS == next_op);
+  return 0;
+}
+
+// Whether the next token ends an expression at precedence p
+static int ends(struct c8eval* o, int p)
+{
+  if (C8_TOKEN_OP != o->type) return 1;
+  int p2 = c8ops_prec(o->binary_op);
+  if (p2 > 0) return p2 < p;
+  return c8ops_prec(o->postfix_op) < 0;
+}
+
+// The form of fused multiply-add for c op a*b, or -1 if op can't be fused
+static int fma_form(int op)
+{
+  switch (op) {
+    case C8_OP_ADD: return C8NUM_FMA;
+    case C8_OP_SUBTRACT: return C8NUM_FNMA;
+    case C8_OP_ADD_ASSIGN: return C8NUM_FMA_ASSIGN;
+    case C8_OP_SUBTRACT_ASSIGN: return C8NUM_FNMA_ASSIGN;
+  }
+  return -1;
+}
+
 static struct c8obj* expression(struct c8eval* o, int p, int f, int ex)
 {
+  int defer = o->defer;
+  o->defer = 0;
   struct c8obj* left = primary(o, f, ex);
 
+  // Numeric products followed by an addition or subtraction, and powers
+  // followed by a modulus, are kept here as left pending_op pending, so
+  // they can be done as one fused operation. A parenthesised one is left
+  // by primary.
+  struct c8obj* pending = o->factor;
+  int pending_op = o->factor_op;
+  o->factor = 0;
+
   while (1) {
     if (C8_TOKEN_NULL == o->type) {
       break;
@@ -79,7 +137,10 @@ static struct c8obj* expression(struct c8eval* o, int p, int f, int ex)
       if (p2 > 0) {
         // Binary op
         if (p2 < p) break;
-        
+        if (pending && !fuses(pending_op, op)) {
+          left = settle(left, &pending, pending_op);
+        }
+
         if (C8_OP_SUBSCRIPT == op) {
           // Subscript op
           struct c8obj* right = expression(o, 0, 1, ex);
@@ -116,7 +177,7 @@ static struct c8obj* expression(struct c8eval* o, int p, int f, int ex)
             // If the name is not found, then attempt to lookup the name as a method of
             // the first argument.
             struct c8obj* method = (struct c8obj*)c8string_create_str(c8error_arg(lerr));
-            struct c8obj* new_left = c8obj_op(c8list_at(lr, 0), C8_OP_LOOKUP, method);
+            struct c8obj* new_left = c8obj_op(c8list_peek(lr, 0), C8_OP_LOOKUP, method);
             c8obj_unref(method);
             if (new_left) {
               c8list_pop_front(lr);
@@ -158,18 +219,60 @@ static struct c8obj* expression(struct c8eval* o, int p, int f, int ex)
             }
           }
           
+          // Let a product on the right be fused with this op
+          o->defer = (lex && !pending && fma_form(op) >= 0 && to_c8num(left));
           right = expression(o, p2+1, f, lex);
+          struct c8obj* factor = o->factor;
+          int factor_op = o->factor_op;
+          o->factor = 0;
+          o->defer = 0;
+          if (factor && C8_OP_MULTIPLY != factor_op) {
+            right = settle(right, &factor, factor_op);
+          }
 
           if (0 == right) {
             o->type = C8_TOKEN_NULL;
             c8obj_unref(left);
+            c8obj_unref(pending);
+            c8obj_unref(factor);
             return 0;
           }
 
+          int fusable = (lex && to_c8num(left) && to_c8num(right));
           if (C8_OP_SEQUENTIAL == op || C8_OP_RESOLVE == op) {
             if (o->list) c8list_push_back(o->list, left);
             c8obj_unref(left);
             left = right;
+          } else if (factor) { // left op right*factor
+            struct c8obj* new_left = c8num_fma(right, factor, left, fma_form(op));
+            c8obj_unref(left);
+            c8obj_unref(right);
+            c8obj_unref(factor);
+            left = new_left;
+          } else if (pending) { // left*pending op right, or left^pending % right
+            struct c8obj* new_left = 0;
+            if (C8_OP_POWER == pending_op) {
+              new_left = c8num_powmod(left, pending, right);
+            } else {
+              int form = (C8_OP_ADD == op) ? C8NUM_FMA : C8NUM_FMS;
+              new_left = c8num_fma(left, pending, right, form);
+            }
+            c8obj_unref(left);
+            c8obj_unref(pending);
+            c8obj_unref(right);
+            pending = 0;
+            left = new_left;
+          } else if (fusable && C8_TOKEN_OP == o->type &&
+                     fuses(op, o->binary_op) &&
+                     c8ops_prec(o->binary_op) >= p) {
+            // Followed by an op at this level which it fuses with
+            pending = right;
+            pending_op = op;
+          } else if (fusable && defer && ends(o, p) &&
+                     (C8_OP_MULTIPLY == op || C8_OP_POWER == op)) {
+            // The last op here, so the caller may fuse it
+            pending = right;
+            pending_op = op;
           } else { // normal binary op
             struct c8obj* new_left = c8obj_op(left, op, right);
             c8obj_unref(left);
@@ -179,10 +282,12 @@ static struct c8obj* expression(struct c8eval* o, int p, int f, int ex)
         }
         if (0 == left) {
           o->type = C8_TOKEN_NULL;
+          c8obj_unref(pending);
           return 0;
         }
       
       } else if (c8ops_prec(o->postfix_op) >= 0) { // Unary postfix
+        left = settle(left, &pending, pending_op);
         struct c8obj* new_left = c8obj_op(left, o->postfix_op, 0);
         c8obj_unref(left);
         left = new_left;
@@ -194,10 +299,18 @@ static struct c8obj* expression(struct c8eval* o, int p, int f, int ex)
 
     } else {
       o->type = C8_TOKEN_NULL;
-      return left;
+      break;
     }
   }
 
+  if (pending) {
+    if (defer) {
+      o->factor = pending;
+      o->factor_op = pending_op;
+      return left;
+    }
+    left = settle(left, &pending, pending_op);
+  }
   return left;
 }
 
@@ -233,11 +346,15 @@ static struct c8obj* primary(struct c8eval* o, int f, int ex)
 
       // Sub-expression
       if (C8_OP_LIST == op) {
+        // A final product or power is left for fusing with what follows
+        o->defer = 1;
         struct c8obj* r = expression(o, 0, 1, ex);
 
         // Check for end
         if (o->binary_op != C8_OP_LIST_END) {
           o->type = C8_TOKEN_NULL;
+          c8obj_unref(o->factor);
+          o->factor = 0;
           c8obj_unref(r);
           return (struct c8obj*)c8error_create(C8_ERROR_PARENTHESIS);
         }
@@ -269,16 +386,8 @@ static struct c8obj* primary(struct c8eval* o, int f, int ex)
         }
         struct c8map* map = c8map_create();
         for (int i=0; i<s; i+=2) {
-          struct c8buf key; c8buf_init(&key);
-          struct c8obj* ko = c8list_at(lr, i);
-          if (ko) {
-            c8obj_str(ko, &key, 0);
-            struct c8obj* value = c8list_at(lr, i+1);
-            c8map_set(map, c8buf_str(&key), value);
-            c8obj_unref(ko);
-            c8obj_unref(value);
-          }
-          c8buf_clear(&key);
+          struct c8obj* ko = c8list_peek(lr, i);
+          if (ko) c8map_set_obj(map, ko, c8list_peek(lr, i+1));
         }
         c8obj_unref((struct c8obj*)lr);
         
@@ -311,6 +420,20 @@ static struct c8obj* primary(struct c8eval* o, int f, int ex)
   return 0;
 }
 
+// Take the items of a list or map initializer as variables take their
+// values, so the container doesn't share objects with the names they came
+// from
+static void take_items(struct c8list* ls)
+{
+  for (int n = c8list_size(ls); n > 0; --n) {
+    struct c8obj* item = c8list_at(ls, 0);
+    c8list_pop_front(ls);
+    item = c8obj_take(item);
+    c8list_push_back(ls, item);
+    c8obj_unref(item);
+  }
+}
+
 static struct c8obj* list(struct c8eval* o, int lop, int ex)
 {
   struct c8list* plist = o->list;
@@ -336,6 +459,7 @@ static struct c8obj* list(struct c8eval* o, int lop, int ex)
     return (struct c8obj*)c8error_create(C8_ERROR_LIST_INIT);
   }
 
+  if (C8_OP_LIST != lop) take_items(ls);
   return (struct c8obj*)ls;
 }
 
@@ -440,7 +564,8 @@ static void next(struct c8eval* o)
       c8buf_append_strn(&o->name, c, 1);
     }
     if (*c) o->pos = ++c;
-    o->value = (struct c8obj*)c8string_create_buf(&o->name);
+    o->value = (struct c8obj*)
+      c8string_create_interned(c8buf_str(&o->name), c8buf_len(&o->name));
     o->type = C8_TOKEN_VALUE;
     return;
   }
@@ -453,6 +578,7 @@ struct c8eval* c8eval_create(struct c8ctx* global)
   o->global = global;
   o->resolver = 0;
   o->resolver_data = 0;
+  o->num = *c8num_settings();
   return o;
 }
 
@@ -470,10 +596,15 @@ struct c8obj* c8eval_expr(struct c8eval* o, const char* expr)
   c8buf_init(&o->name);
   o->value = 0;
   o->list = 0;
+  o->defer = 0;
+  o->factor = 0;
+  struct c8num_settings* num = c8num_use_settings(&o->num);
   struct c8obj* ro = expression(o, 0, 1, 1);
   c8buf_clear(&o->name);
   c8obj_unref((struct c8obj*)o->value);
   c8obj_unref((struct c8obj*)o->list);
+  c8num_use_settings(num);
+  c8gc_poll();
   return ro;
 }
 
@@ -0,0 +1,457 @@
+/** c8f64 - fast real number object, using a double
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8f64.h"
+#include "c8mpz.h"
+#include "c8mpq.h"
+#include "c8mpfr.h"
+#include "c8mpc.h"
+#include "c8obj.h"
+#include "c8ops.h"
+#include "c8bool.h"
+#include "c8error.h"
+#include "c8func.h"
+#include "c8ctx.h"
+#include "c8list.h"
+#include "c8buf.h"
+#include "c8num.h"
+#include "c8numimp.h"
+#include "c8heap.h"
+#include "c8fmt.h"
+
+#include <mpfr.h>
+#include <mpc.h>
+#include <math.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Decimal digits shown, matching mpfr at 53 bits
+#define C8F64_DIGITS 15
+
+struct c8f64 {
+  struct c8num base;
+  double value;
+};
+
+/* Get the value of another numeric type directly, returning 0 if obj isn't
+ * one
+ */
+static int c8f64_convert(const struct c8obj* obj, double* value)
+{
+  const struct c8f64* ro = to_const_c8f64(obj);
+  if (ro) { *value = ro->value; return 1; }
+  const struct c8mpz* zo = to_const_c8mpz(obj);
+  if (zo) { *value = mpz_get_d(c8mpz_value(zo)); return 1; }
+  const struct c8mpq* qo = to_const_c8mpq(obj);
+  if (qo) { *value = mpq_get_d(c8mpq_value(qo)); return 1; }
+  const struct c8mpfr* fo = to_const_c8mpfr(obj);
+  if (fo) { *value = mpfr_get_d(c8mpfr_value(fo), GMP_RNDN); return 1; }
+  const struct c8mpc* co = to_const_c8mpc(obj);
+  if (co) { *value = mpfr_get_d(mpc_realref(c8mpc_value(co)), GMP_RNDN); return 1; }
+  return 0;
+}
+
+static void c8f64_destroy(struct c8obj* o)
+{
+  struct c8f64* oo = to_c8f64(o);
+  assert(oo);
+  c8heap_free(oo);
+}
+
+static struct c8obj* c8f64_copy(const struct c8obj* o)
+{
+  const struct c8f64* oo = to_const_c8f64(o);
+  assert(oo);
+  return (struct c8obj*)c8f64_create(oo->value);
+}
+
+static int c8f64_int(const struct c8obj* o)
+{
+  const struct c8f64* oo = to_const_c8f64(o);
+  assert(oo);
+  return (int)oo->value;
+}
+
+static void c8f64_str(const struct c8obj* o, struct c8buf* buf, int f)
+{
+  const struct c8f64* oo = to_const_c8f64(o);
+  assert(oo);
+
+  if (isinf(oo->value)) {
+    c8buf_append_str(buf, "Infinity");
+    return;
+  }
+  if (isnan(oo->value)) {
+    c8buf_append_str(buf, "Not a number");
+    return;
+  }
+
+  if ((f & C8_FMT_MASK_BASE) == C8_FMT_DEC) {
+    char cs[32];
+    snprintf(cs, sizeof(cs), "%.*g", C8F64_DIGITS, oo->value);
+    c8buf_append_str(buf, cs);
+    return;
+  }
+
+  // Other formats are rare, so use mpfr to match its output exactly
+  mpfr_t t;
+  mpfr_init2(t, 53);
+  mpfr_set_d(t, oo->value, GMP_RNDN);
+  int dp = C8F64_DIGITS;
+  const char* fmt = "%-.*Rg";
+  switch (f & C8_FMT_MASK_BASE) {
+    case C8_FMT_BIN: fmt = "%-.*Rb"; break;
+    case C8_FMT_HEX: fmt = "%-.*Ra"; break;
+    case C8_FMT_SCI: fmt = "%-Re"; break;
+    case C8_FMT_FIX: fmt = "%-.*Rf"; dp = c8fmt_mpfr_fix_dp(t); break;
+  }
+  c8fmt_mpfr_append(buf, fmt, dp, t);
+  mpfr_clear(t);
+}
+
+static struct c8obj* c8f64_binary_op(struct c8f64* oo, int op, double p)
+{
+  switch (op) {
+    case C8_OP_ADD:
+      return (struct c8obj*)c8f64_create(oo->value + p);
+    case C8_OP_SUBTRACT:
+      return (struct c8obj*)c8f64_create(oo->value - p);
+    case C8_OP_MULTIPLY:
+      return (struct c8obj*)c8f64_create(oo->value * p);
+    case C8_OP_DIVIDE:
+      return (struct c8obj*)c8f64_create(oo->value / p);
+    case C8_OP_MODULUS:
+      return (struct c8obj*)c8f64_create(fmod(oo->value, p));
+    case C8_OP_POWER:
+      return (struct c8obj*)c8f64_create(pow(oo->value, p));
+
+    case C8_OP_EQUALITY:
+      return (struct c8obj*)c8bool_create(oo->value == p);
+    case C8_OP_INEQUALITY:
+      return (struct c8obj*)c8bool_create(oo->value != p);
+    case C8_OP_GREATER:
+      return (struct c8obj*)c8bool_create(oo->value > p);
+    case C8_OP_LESS:
+      return (struct c8obj*)c8bool_create(oo->value < p);
+    case C8_OP_GREATER_OR_EQUAL:
+      return (struct c8obj*)c8bool_create(oo->value >= p);
+    case C8_OP_LESS_OR_EQUAL:
+      return (struct c8obj*)c8bool_create(oo->value <= p);
+
+    case C8_OP_ASSIGN:
+      oo->value = p;
+      return c8obj_ref((struct c8obj*)oo);
+    case C8_OP_ADD_ASSIGN:
+      oo->value += p;
+      return c8obj_ref((struct c8obj*)oo);
+    case C8_OP_SUBTRACT_ASSIGN:
+      oo->value -= p;
+      return c8obj_ref((struct c8obj*)oo);
+    case C8_OP_MULTIPLY_ASSIGN:
+      oo->value *= p;
+      return c8obj_ref((struct c8obj*)oo);
+    case C8_OP_DIVIDE_ASSIGN:
+      oo->value /= p;
+      return c8obj_ref((struct c8obj*)oo);
+  }
+  return 0;
+}
+
+static const int c8f64_kernel_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_MODULUS,
+  C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+// Used with any real or integer operand, whose value is read directly
+static struct c8obj* c8f64_kernel(struct c8obj* o, int op, struct c8obj* p)
+{
+  double value = 0;
+  c8f64_convert(p, &value);
+  return c8f64_binary_op((struct c8f64*)o, op, value);
+}
+
+static struct c8obj* c8f64_fma(struct c8obj* a, struct c8obj* b,
+                               struct c8obj* c, int form)
+{
+  double av = ((struct c8f64*)a)->value;
+  double bv = ((struct c8f64*)b)->value;
+  struct c8f64* oc = (struct c8f64*)c;
+  switch (form) {
+    case C8NUM_FMA: return (struct c8obj*)c8f64_create(fma(av, bv, oc->value));
+    case C8NUM_FMS: return (struct c8obj*)c8f64_create(fma(av, bv, -oc->value));
+    case C8NUM_FNMA: return (struct c8obj*)c8f64_create(fma(-av, bv, oc->value));
+    case C8NUM_FMA_ASSIGN: oc->value = fma(av, bv, oc->value); break;
+    case C8NUM_FNMA_ASSIGN: oc->value = fma(-av, bv, oc->value); break;
+  }
+  return c8obj_ref(c);
+}
+
+static struct c8obj* c8f64_lookup(struct c8obj* o, const char* name)
+{
+  if (strcmp("abs", name)==0) return (struct c8obj*)c8func_create_method(c8f64_abs, o);
+  if (strcmp("ceil", name)==0) return (struct c8obj*)c8func_create_method(c8f64_ceil, o);
+  if (strcmp("floor", name)==0) return (struct c8obj*)c8func_create_method(c8f64_floor, o);
+  if (strcmp("trunc", name)==0) return (struct c8obj*)c8func_create_method(c8f64_trunc, o);
+  if (strcmp("log", name)==0) return (struct c8obj*)c8func_create_method(c8f64_log, o);
+  if (strcmp("exp", name)==0) return (struct c8obj*)c8func_create_method(c8f64_exp, o);
+  if (strcmp("sqrt", name)==0) return (struct c8obj*)c8func_create_method(c8f64_sqrt, o);
+  if (strcmp("cos", name)==0) return (struct c8obj*)c8func_create_method(c8f64_cos, o);
+  if (strcmp("sin", name)==0) return (struct c8obj*)c8func_create_method(c8f64_sin, o);
+  if (strcmp("tan", name)==0) return (struct c8obj*)c8func_create_method(c8f64_tan, o);
+  if (strcmp("acos", name)==0) return (struct c8obj*)c8func_create_method(c8f64_acos, o);
+  if (strcmp("asin", name)==0) return (struct c8obj*)c8func_create_method(c8f64_asin, o);
+  if (strcmp("atan", name)==0) return (struct c8obj*)c8func_create_method(c8f64_atan, o);
+  if (strcmp("atan2", name)==0) return (struct c8obj*)c8func_create_method(c8f64_atan2, o);
+  if (strcmp("cosh", name)==0) return (struct c8obj*)c8func_create_method(c8f64_cosh, o);
+  if (strcmp("sinh", name)==0) return (struct c8obj*)c8func_create_method(c8f64_sinh, o);
+  if (strcmp("tanh", name)==0) return (struct c8obj*)c8func_create_method(c8f64_tanh, o);
+  if (strcmp("mean", name)==0) return (struct c8obj*)c8func_create_method(c8f64_mean, o);
+  return 0;
+}
+
+static struct c8obj* c8f64_op(struct c8obj* o, int op, struct c8obj* p)
+{
+  struct c8f64* oo = to_c8f64(o);
+  assert(oo);
+
+  switch (op) {
+    case C8_OP_LOOKUP: {
+      struct c8buf nb; c8buf_init(&nb);
+      c8obj_str(p, &nb, 0);
+      struct c8obj* ret = c8f64_lookup(o, c8buf_str(&nb));
+      c8buf_clear(&nb);
+      return ret;
+    }
+    case C8_OP_POSITIVE:
+      return c8f64_copy(o);
+    case C8_OP_NEGATIVE:
+      return (struct c8obj*)c8f64_create(-oo->value);
+    case C8_OP_PRE_INC:
+      oo->value += 1;
+      return c8obj_ref(o);
+    case C8_OP_PRE_DEC:
+      oo->value -= 1;
+      return c8obj_ref(o);
+    case C8_OP_FACTORIAL: {
+      if (oo->value < 0 || oo->value != floor(oo->value)) {
+        return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+      }
+      return (struct c8obj*)c8f64_create(tgamma(oo->value + 1));
+    }
+    case C8_OP_POST_INC: {
+      struct c8obj* nr = c8f64_copy(o);
+      oo->value += 1;
+      return nr;
+    }
+    case C8_OP_POST_DEC: {
+      struct c8obj* nr = c8f64_copy(o);
+      oo->value -= 1;
+      return nr;
+    }
+  }
+
+  double value;
+  if (p && c8f64_convert(p, &value)) return c8f64_binary_op(oo, op, value);
+
+  // Convert p to f64 and perform the op
+  if (p) {
+    struct c8f64* fo = c8f64_create_c8obj(p);
+    struct c8obj* r = c8f64_binary_op(oo, op, fo->value);
+    c8obj_unref((struct c8obj*)fo);
+    return r;
+  }
+
+  return 0;
+}
+
+static void c8f64_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  st->bytes = sizeof(struct c8f64);
+}
+
+static const struct c8obj_imp c8f64_imp = {
+  c8f64_destroy,
+  c8f64_copy,
+  c8f64_int,
+  c8f64_str,
+  c8f64_op,
+  0,
+  c8f64_stat,
+  "f64"
+};
+
+const struct c8f64* to_const_c8f64(const struct c8obj* o)
+{
+  const struct c8num* on = to_const_c8num(o);
+  return (on && on->imp && on->imp == &c8f64_imp) ?
+    (const struct c8f64*)o : 0;
+}
+
+struct c8f64* to_c8f64(struct c8obj* o)
+{
+  return (struct c8f64*)to_const_c8f64(o);
+}
+
+struct c8f64* c8f64_create(double value)
+{
+  struct c8f64* oo = (struct c8f64*)c8heap_alloc(sizeof(struct c8f64));
+  assert(oo);
+  c8num_init(&oo->base, &c8f64_imp);
+  oo->value = value;
+  return oo;
+}
+
+struct c8f64* c8f64_create_str(const char* str)
+{
+  if (strlen(str) > 2 && str[0] == '0' &&
+      (str[1] == 'b' || str[1] == 'o' || str[1] == 'd')) {
+    // Prefixes which strtod doesn't understand
+    int base = (str[1] == 'b') ? 2 : (str[1] == 'o') ? 8 : 10;
+    mpfr_t t;
+    mpfr_init2(t, 53);
+    mpfr_set_str(t, str+2, base, GMP_RNDN);
+    struct c8f64* oo = c8f64_create(mpfr_get_d(t, GMP_RNDN));
+    mpfr_clear(t);
+    return oo;
+  }
+  return c8f64_create(strtod(str, 0));
+}
+
+struct c8f64* c8f64_create_c8obj(const struct c8obj* obj)
+{
+  assert(obj);
+  double value;
+  if (c8f64_convert(obj, &value)) return c8f64_create(value);
+  struct c8buf buf; c8buf_init(&buf);
+  c8obj_str(obj, &buf, 0);
+  struct c8f64* oo = c8f64_create_str(c8buf_len(&buf) ? c8buf_str(&buf) : "");
+  c8buf_clear(&buf);
+  return oo;
+}
+
+double c8f64_value(const struct c8f64* oo)
+{
+  assert(oo);
+  return oo->value;
+}
+
+static struct c8num* c8f64_real_create(const char* str)
+{
+  return (struct c8num*)c8f64_create_str(str);
+}
+
+static struct c8num* c8f64_real_convert(const struct c8obj* o)
+{
+  return (struct c8num*)c8f64_create_c8obj(o);
+}
+
+void c8f64_init_ctx(struct c8ctx* ctx)
+{
+  int t = c8num_register_fast_real(&c8f64_imp, c8f64_real_create,
+                                   c8f64_real_convert);
+  c8num_register_kernel(t, t, c8f64_kernel_ops, c8f64_kernel);
+  c8num_register_fma(t, c8f64_fma);
+  c8num_register_kernel(t, c8num_type_id("mpz"), c8f64_kernel_ops, c8f64_kernel);
+  c8num_register_kernel(t, c8num_type_id("mpq"), c8f64_kernel_ops, c8f64_kernel);
+  c8num_register_kernel(t, c8num_type_id("mpfr"), c8f64_kernel_ops, c8f64_kernel);
+}
+
+/* Get the value of an argument, converting it if needed
+ */
+static double c8f64_arg(struct c8obj* a)
+{
+  double value;
+  if (c8f64_convert(a, &value)) return value;
+  struct c8f64* na = c8f64_create_c8obj(a);
+  value = na->value;
+  c8obj_unref((struct c8obj*)na);
+  return value;
+}
+
+/* Get the value of the single argument, returning an error if there isn't
+ * exactly one.
+ */
+static struct c8obj* c8f64_single_arg(struct c8list* args, double* value)
+{
+  if (c8list_size(args) != 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* a = c8list_peek(args, 0);
+  if (!a)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  *value = c8f64_arg(a);
+  return 0;
+}
+
+#define C8F64_SINGLE_ARG_FN(name, code)             \
+  struct c8obj* c8f64_##name (struct c8list* args)  \
+  {                                                 \
+    double a = 0;                                   \
+    struct c8obj* err = c8f64_single_arg(args, &a); \
+    if (err) return err;                            \
+    return (struct c8obj*)c8f64_create(code);       \
+  }
+
+C8F64_SINGLE_ARG_FN(abs, fabs(a))
+C8F64_SINGLE_ARG_FN(ceil, ceil(a))
+C8F64_SINGLE_ARG_FN(floor, floor(a))
+C8F64_SINGLE_ARG_FN(trunc, trunc(a))
+C8F64_SINGLE_ARG_FN(log, log(a))
+C8F64_SINGLE_ARG_FN(exp, exp(a))
+C8F64_SINGLE_ARG_FN(sqrt, sqrt(a))
+C8F64_SINGLE_ARG_FN(cos, cos(a))
+C8F64_SINGLE_ARG_FN(sin, sin(a))
+C8F64_SINGLE_ARG_FN(tan, tan(a))
+C8F64_SINGLE_ARG_FN(acos, acos(a))
+C8F64_SINGLE_ARG_FN(asin, asin(a))
+C8F64_SINGLE_ARG_FN(atan, atan(a))
+C8F64_SINGLE_ARG_FN(cosh, cosh(a))
+C8F64_SINGLE_ARG_FN(sinh, sinh(a))
+C8F64_SINGLE_ARG_FN(tanh, tanh(a))
+
+struct c8obj* c8f64_atan2(struct c8list* args)
+{
+  if (c8list_size(args) != 2)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* y = c8list_peek(args, 0);
+  struct c8obj* x = c8list_peek(args, 1);
+  if (!y || !x)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  return (struct c8obj*)c8f64_create(atan2(c8f64_arg(y), c8f64_arg(x)));
+}
+
+struct c8obj* c8f64_mean(struct c8list* args)
+{
+  int n = c8list_size(args);
+  if (n == 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  double sum = 0;
+  for (int i=0; i<n; ++i) {
+    struct c8obj* a = c8list_peek(args, i);
+    if (a) sum += c8f64_arg(a);
+  }
+  return (struct c8obj*)c8f64_create(sum / n);
+}
@@ -0,0 +1,67 @@
+/** c8f64 - fast real number object, using a double
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+struct c8f64;
+struct c8obj;
+struct c8ctx;
+struct c8list;
+
+/** Safe casts from c8obj
+ */
+const struct c8f64* to_const_c8f64(const struct c8obj* o);
+struct c8f64* to_c8f64(struct c8obj* o);
+
+/** Create a c8f64 object
+ */
+struct c8f64* c8f64_create(double value);
+struct c8f64* c8f64_create_str(const char* str);
+struct c8f64* c8f64_create_c8obj(const struct c8obj* obj);
+
+/** Get the value
+ */
+double c8f64_value(const struct c8f64* oo);
+
+/** Make reals use c8f64 rather than arbitrary precision
+ * Should be called after c8mpfr_init_ctx, if at all.
+ */
+void c8f64_init_ctx(struct c8ctx* ctx);
+
+/** Functions
+ */
+struct c8obj* c8f64_abs(struct c8list* args);
+struct c8obj* c8f64_ceil(struct c8list* args);
+struct c8obj* c8f64_floor(struct c8list* args);
+struct c8obj* c8f64_trunc(struct c8list* args);
+struct c8obj* c8f64_log(struct c8list* args);
+struct c8obj* c8f64_exp(struct c8list* args);
+struct c8obj* c8f64_sqrt(struct c8list* args);
+struct c8obj* c8f64_cos(struct c8list* args);
+struct c8obj* c8f64_sin(struct c8list* args);
+struct c8obj* c8f64_tan(struct c8list* args);
+struct c8obj* c8f64_acos(struct c8list* args);
+struct c8obj* c8f64_asin(struct c8list* args);
+struct c8obj* c8f64_atan(struct c8list* args);
+struct c8obj* c8f64_atan2(struct c8list* args);
+struct c8obj* c8f64_cosh(struct c8list* args);
+struct c8obj* c8f64_sinh(struct c8list* args);
+struct c8obj* c8f64_tanh(struct c8list* args);
+struct c8obj* c8f64_mean(struct c8list* args);
@@ -0,0 +1,194 @@
+/** c8fmt - number formatting
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8fmt.h"
+#include "c8buf.h"
+
+#include <gmp.h>
+#include <mpfr.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+// Digits converted directly by GMP, and written in one chunk
+#define C8FMT_LEAF_DIGITS (1 << 14)
+
+// Powers base^(C8FMT_LEAF_DIGITS * 2^i) kept for splitting, allowing for
+// values with up to C8FMT_LEAF_DIGITS * 2^C8FMT_POWERS digits
+#define C8FMT_POWERS 40
+
+static int c8fmt_base = 0;
+static int c8fmt_npowers = 0;
+static mpz_t c8fmt_powers[C8FMT_POWERS];
+
+// The power with C8FMT_LEAF_DIGITS * 2^i digits
+static mpz_srcptr c8fmt_power(int base, int i)
+{
+  assert(i < C8FMT_POWERS);
+  if (base != c8fmt_base) {
+    for (int j=0; j<c8fmt_npowers; ++j) mpz_clear(c8fmt_powers[j]);
+    c8fmt_npowers = 0;
+    c8fmt_base = base;
+  }
+  for (; c8fmt_npowers<=i; ++c8fmt_npowers) {
+    mpz_ptr p = c8fmt_powers[c8fmt_npowers];
+    mpz_init(p);
+    if (c8fmt_npowers == 0) mpz_ui_pow_ui(p, base, C8FMT_LEAF_DIGITS);
+    else mpz_mul(p, c8fmt_powers[c8fmt_npowers-1], c8fmt_powers[c8fmt_npowers-1]);
+  }
+  return c8fmt_powers[i];
+}
+
+static void c8fmt_zeros(size_t n, c8fmt_sink sink, void* arg)
+{
+  static const char zeros[64] =
+    "0000000000000000000000000000000000000000000000000000000000000000";
+  for (; n > sizeof(zeros); n -= sizeof(zeros)) sink(zeros, sizeof(zeros), arg);
+  sink(zeros, n, arg);
+}
+
+// Write non-negative v, padded with leading zeros to width digits if
+// width is non-zero
+static void c8fmt_split(mpz_srcptr v, int base, size_t width,
+                        c8fmt_sink sink, void* arg)
+{
+  // This may be one too many, but never more than the width
+  size_t digits = mpz_sizeinbase(v, base);
+  if (width && digits > width) digits = width;
+
+  // Split at the largest cached power below v with at most half the digits,
+  // so that the high part is no longer than the low part
+  int i = -1;
+  size_t k = C8FMT_LEAF_DIGITS;
+  if (digits > C8FMT_LEAF_DIGITS) {
+    for (i=0; 2 * k < digits; ++i) k *= 2;
+    if (mpz_cmp(v, c8fmt_power(base, i)) < 0) {
+      --i;
+      k /= 2;
+    }
+  }
+
+  if (i < 0) {
+    char s[C8FMT_LEAF_DIGITS + 3];
+    mpz_get_str(s, base, v);
+    size_t n = strlen(s);
+    if (width && !mpz_sgn(v)) {
+      c8fmt_zeros(width, sink, arg);
+    } else {
+      if (width > n) c8fmt_zeros(width - n, sink, arg);
+      sink(s, n, arg);
+    }
+    return;
+  }
+
+  mpz_t q, r;
+  mpz_inits(q, r, NULL);
+  mpz_tdiv_qr(q, r, v, c8fmt_power(base, i));
+  int high = width || mpz_sgn(q); // Whether there are digits before r
+  if (high) c8fmt_split(q, base, width ? width - k : 0, sink, arg);
+  mpz_clear(q);
+  c8fmt_split(r, base, high ? k : 0, sink, arg);
+  mpz_clear(r);
+}
+
+void c8fmt_file_sink(const char* s, size_t n, void* arg)
+{
+  fwrite(s, 1, n, (FILE*)arg);
+}
+
+size_t c8fmt_mpz_size(mpz_srcptr v, int base)
+{
+  return mpz_sizeinbase(v, base) + (mpz_sgn(v) < 0);
+}
+
+static void c8fmt_str_sink(const char* s, size_t n, void* arg)
+{
+  char** p = arg;
+  memcpy(*p, s, n);
+  *p += n;
+}
+
+size_t c8fmt_mpz_get(char* s, mpz_srcptr v, int base)
+{
+  if (mpz_sizeinbase(v, base) <= C8FMT_LEAF_DIGITS) {
+    mpz_get_str(s, base, v);
+    return strlen(s);
+  }
+  char* p = s;
+  c8fmt_mpz_write(v, base, c8fmt_str_sink, &p);
+  *p = 0;
+  return p - s;
+}
+
+void c8fmt_mpz_write(mpz_srcptr v, int base, c8fmt_sink sink, void* arg)
+{
+  if (mpz_sgn(v) < 0) {
+    sink("-", 1, arg);
+    // Convert the magnitude, sharing the limbs of v
+    mpz_t a;
+    mpz_roinit_n(a, mpz_limbs_read(v), mpz_size(v));
+    c8fmt_split(a, base, 0, sink, arg);
+  } else {
+    c8fmt_split(v, base, 0, sink, arg);
+  }
+}
+
+void c8fmt_mpz_append(struct c8buf* buf, mpz_srcptr v, int base)
+{
+  size_t n = c8fmt_mpz_size(v, base);
+  char* s = c8buf_reserve(buf, n);
+  c8buf_commit(buf, c8fmt_mpz_get(s, v, base));
+}
+
+int c8fmt_mpfr_fix_dp(mpfr_srcptr v)
+{
+  // Significant digits needed to read back the precision, less those
+  // before the point, plus one as the exponent is estimated
+  int digits = 2 + (int)(mpfr_get_prec(v) * 0.30103);
+  if (!mpfr_regular_p(v)) return digits;
+  long e10 = (long)((mpfr_get_exp(v) - 1) * 0.30103);
+  if (mpfr_get_exp(v) < 1) e10 -= 1;
+  long dp = digits - e10;
+  return dp < 0 ? 0 : (int)dp;
+}
+
+// Print v with fmt, giving it dp only if it takes a precision argument
+static int c8fmt_mpfr_print(char* s, size_t n, const char* fmt, int dp,
+                            mpfr_srcptr v)
+{
+  if (strstr(fmt, ".*")) return mpfr_snprintf(s, n, fmt, dp, v);
+  return mpfr_snprintf(s, n, fmt, v);
+}
+
+void c8fmt_mpfr_append(struct c8buf* buf, const char* fmt, int dp, mpfr_srcptr v)
+{
+  // Digits, with any before the point in fixed formats, plus room for the
+  // sign, point, exponent and prefix
+  size_t n = dp + 32;
+  if (mpfr_regular_p(v) && mpfr_get_exp(v) > 0) n += mpfr_get_exp(v) * 0.302;
+  char* s = c8buf_reserve(buf, n);
+  int len = c8fmt_mpfr_print(s, n + 1, fmt, dp, v);
+  if (len < 0) return;
+  if ((size_t)len > n) {
+    s = c8buf_reserve(buf, len);
+    c8fmt_mpfr_print(s, len + 1, fmt, dp, v);
+  }
+  c8buf_commit(buf, len);
+}
@@ -0,0 +1,64 @@
+/** c8fmt - number formatting
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gmp.h>
+#include <mpfr.h>
+#include <stddef.h>
+
+struct c8buf;
+
+/** Receives successive chunks of output
+ */
+typedef void (*c8fmt_sink)(const char* s, size_t n, void* arg);
+
+/** Sink writing to a FILE*
+ */
+void c8fmt_file_sink(const char* s, size_t n, void* arg);
+
+/** Upper bound on the characters in v written in a base, including any
+ * sign but not a terminator
+ */
+size_t c8fmt_mpz_size(mpz_srcptr v, int base);
+
+/** Write v in a base to s, which must have room for c8fmt_mpz_size(v) + 1
+ * characters, and return the number written, not counting the terminator
+ */
+size_t c8fmt_mpz_get(char* s, mpz_srcptr v, int base);
+
+/** Write v in a base to a sink
+ * Large values are converted by divide and conquer, so that digits are
+ * written in chunks as they are found and the whole string is never held.
+ */
+void c8fmt_mpz_write(mpz_srcptr v, int base, c8fmt_sink sink, void* arg);
+
+/** Append v in a base to a buffer
+ */
+void c8fmt_mpz_append(struct c8buf* buf, mpz_srcptr v, int base);
+
+/** Append v to a buffer using an mpfr_printf format, which is given dp
+ * as its precision if it takes one, as in "%-.*Rg"
+ */
+void c8fmt_mpfr_append(struct c8buf* buf, const char* fmt, int dp, mpfr_srcptr v);
+
+/** Decimal places for v in fixed point which read back as the same value
+ */
+int c8fmt_mpfr_fix_dp(mpfr_srcptr v);
@@ -24,6 +24,7 @@
 #include "c8objimp.h"
 #include "c8ops.h"
 #include "c8list.h"
+#include "c8heap.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -39,7 +40,7 @@ static void c8func_destroy(struct c8obj* o)
   struct c8func* oo = to_c8func(o);
   assert(oo);
   c8obj_unref(oo->object);
-  free(oo);
+  c8heap_free(oo);
 }
 
 static struct c8obj* c8func_copy(const struct c8obj* o)
@@ -74,12 +75,29 @@ static struct c8obj* c8func_op(struct c8obj* o, int op, struct c8obj* p)
   return 0;
 }
 
+static void c8func_traverse(struct c8obj* o, c8obj_visit_func visit, void* arg)
+{
+  struct c8func* oo = to_c8func(o);
+  assert(oo);
+  visit(&oo->object, arg);
+}
+
+static void c8func_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8func* oo = to_const_c8func(o);
+  assert(oo);
+  st->bytes = sizeof(struct c8func);
+}
+
 static const struct c8obj_imp c8func_imp = {
   c8func_destroy,
   c8func_copy,
   c8func_int,
   c8func_str,
-  c8func_op
+  c8func_op,
+  c8func_traverse,
+  c8func_stat,
+  "func"
 };
 
 const struct c8func* to_const_c8func(const struct c8obj* o)
@@ -96,7 +114,7 @@ struct c8func* to_c8func(struct c8obj* o)
 struct c8func* c8func_create(c8func_func f)
 {
   assert(f);
-  struct c8func* oo = malloc(sizeof(struct c8func));
+  struct c8func* oo = c8heap_alloc(sizeof(struct c8func));
   assert(oo);
   c8obj_init(&oo->base, &c8func_imp);
   oo->func = f;
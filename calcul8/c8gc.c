@@ -0,0 +1,225 @@
+/** c8gc - cycle collector for container objects
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8gc.h"
+#include "c8obj.h"
+#include "c8objimp.h"
+#include "c8vec.h"
+#include "c8debug.h"
+
+#include <assert.h>
+
+// Synchronous trial deletion (Bacon & Rajan). Containers whose count drops
+// to a non-zero value are buffered as candidate roots. A collection then
+// subtracts the references internal to the subgraph reachable from them
+// (mark gray), restores counts for anything still referenced from outside
+// (scan), and frees what's left (collect white). The work is proportional
+// to the subgraph under the candidates rather than the whole heap.
+//
+// An object's gc field holds its colour in the low bits and, if buffered,
+// its position in the candidate buffer + 1 in the rest.
+
+#define C8GC_BLACK 0
+#define C8GC_GRAY 1
+#define C8GC_WHITE 2
+#define C8GC_PURPLE 3
+#define C8GC_COLOR_MASK 3
+#define C8GC_SLOT_SHIFT 2
+
+#define C8GC_DEFAULT_THRESHOLD 1000
+
+static struct c8vec roots = {0, 0, 0, 0};
+static int threshold = C8GC_DEFAULT_THRESHOLD;
+
+static int color(const struct c8obj* o)
+{
+  return o->gc & C8GC_COLOR_MASK;
+}
+
+static void set_color(struct c8obj* o, int c)
+{
+  o->gc = (o->gc & ~C8GC_COLOR_MASK) | c;
+}
+
+static int buffered(const struct c8obj* o)
+{
+  return o->gc >> C8GC_SLOT_SHIFT;
+}
+
+static void unbuffer(struct c8obj* o)
+{
+  o->gc &= C8GC_COLOR_MASK;
+}
+
+static int container(const struct c8obj* o)
+{
+  return o && o->imp->traverse;
+}
+
+static void mark_gray(struct c8obj* o);
+static void scan(struct c8obj* o);
+static void scan_black(struct c8obj* o);
+static void collect_white(struct c8obj* o, struct c8vec* garbage);
+
+static void mark_gray_visit(struct c8obj** slot, void* arg)
+{
+  struct c8obj* t = *slot;
+  if (!container(t)) return;
+  --t->refs;
+  mark_gray(t);
+}
+
+static void mark_gray(struct c8obj* o)
+{
+  if (color(o) == C8GC_GRAY) return;
+  set_color(o, C8GC_GRAY);
+  (o->imp->traverse)(o, mark_gray_visit, 0);
+}
+
+static void scan_visit(struct c8obj** slot, void* arg)
+{
+  if (container(*slot)) scan(*slot);
+}
+
+static void scan(struct c8obj* o)
+{
+  if (color(o) != C8GC_GRAY) return;
+  if (o->refs > 0) {
+    scan_black(o);
+  } else {
+    set_color(o, C8GC_WHITE);
+    (o->imp->traverse)(o, scan_visit, 0);
+  }
+}
+
+static void scan_black_visit(struct c8obj** slot, void* arg)
+{
+  struct c8obj* t = *slot;
+  if (!container(t)) return;
+  ++t->refs;
+  if (color(t) != C8GC_BLACK) scan_black(t);
+}
+
+static void scan_black(struct c8obj* o)
+{
+  set_color(o, C8GC_BLACK);
+  (o->imp->traverse)(o, scan_black_visit, 0);
+}
+
+static void collect_white_visit(struct c8obj** slot, void* arg)
+{
+  if (container(*slot)) collect_white(*slot, (struct c8vec*)arg);
+}
+
+static void collect_white(struct c8obj* o, struct c8vec* garbage)
+{
+  if (color(o) != C8GC_WHITE || buffered(o)) return;
+  set_color(o, C8GC_BLACK);
+  (o->imp->traverse)(o, collect_white_visit, garbage);
+  c8vec_push_back(garbage, o);
+}
+
+// The counts of containers referenced from garbage already exclude those
+// references, so they're dropped without an unref.
+static void release_visit(struct c8obj** slot, void* arg)
+{
+  if (container(*slot)) *slot = 0;
+}
+
+void c8gc_possible_root(struct c8obj* o)
+{
+  assert(o);
+  if (threshold == 0) return;
+  set_color(o, C8GC_PURPLE);
+  if (buffered(o)) return;
+  c8vec_push_back(&roots, o);
+  o->gc |= c8vec_size(&roots) << C8GC_SLOT_SHIFT;
+}
+
+void c8gc_forget(struct c8obj* o)
+{
+  assert(o);
+  int slot = buffered(o);
+  if (slot) *c8vec_slot(&roots, slot - 1) = 0;
+  o->gc = 0;
+}
+
+int c8gc_collect()
+{
+  // Take the candidates, so any buffered while freeing go to a fresh buffer
+  struct c8vec cands = roots;
+  c8vec_init(&roots);
+  int n = c8vec_size(&cands);
+
+  for (int i=0; i<n; ++i) {
+    struct c8obj** s = (struct c8obj**)c8vec_slot(&cands, i);
+    if (!*s) continue;
+    if (color(*s) == C8GC_PURPLE) {
+      mark_gray(*s);
+    } else {
+      unbuffer(*s);
+      *s = 0;
+    }
+  }
+  for (int i=0; i<n; ++i) {
+    struct c8obj* o = (struct c8obj*)c8vec_at(&cands, i);
+    if (o) scan(o);
+  }
+  struct c8vec garbage; c8vec_init(&garbage);
+  for (int i=0; i<n; ++i) {
+    struct c8obj* o = (struct c8obj*)c8vec_at(&cands, i);
+    if (!o) continue;
+    unbuffer(o);
+    collect_white(o, &garbage);
+  }
+  c8vec_clear(&cands);
+
+  // Break the garbage cycles, then free it through the usual path
+  int freed = c8vec_size(&garbage);
+  for (int i=0; i<freed; ++i) {
+    struct c8obj* o = (struct c8obj*)c8vec_at(&garbage, i);
+    (o->imp->traverse)(o, release_visit, 0);
+  }
+  for (int i=0; i<freed; ++i) {
+    struct c8obj* o = (struct c8obj*)c8vec_at(&garbage, i);
+    assert(o->refs == 0);
+    o->refs = 1;
+    c8obj_unref(o);
+  }
+  c8vec_clear(&garbage);
+
+  if (freed) c8debug(C8_DEBUG_INFO, "c8gc_collect: freed %d of %d", freed, n);
+  return freed;
+}
+
+void c8gc_poll()
+{
+  if (threshold && c8vec_size(&roots) >= threshold) c8gc_collect();
+}
+
+void c8gc_threshold(int n)
+{
+  threshold = n;
+}
+
+int c8gc_roots()
+{
+  return c8vec_size(&roots);
+}
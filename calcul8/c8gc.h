@@ -0,0 +1,53 @@
+/** c8gc - cycle collector for container objects
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+struct c8obj;
+
+/** Note a container whose reference count dropped without reaching zero
+ * It may now only be referenced from within a cycle, so becomes a candidate
+ * root for the next collection.
+ */
+void c8gc_possible_root(struct c8obj* o);
+
+/** Remove a container being destroyed from the candidate roots
+ */
+void c8gc_forget(struct c8obj* o);
+
+/** Free any garbage cycles reachable from the candidate roots
+ * Returns the number of objects freed.
+ */
+int c8gc_collect();
+
+/** Collect if the candidate roots have reached the threshold
+ * Must only be called where no borrowed references are held.
+ */
+void c8gc_poll();
+
+/** Set the number of candidate roots which triggers a collection
+ * This bounds the work done by each collection. Zero disables cycle
+ * collection altogether.
+ */
+void c8gc_threshold(int n);
+
+/** Get the number of pending candidate roots
+ */
+int c8gc_roots();
@@ -0,0 +1,266 @@
+/** c8heap - heap statistics and live object census
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8heap.h"
+#include "c8obj.h"
+#include "c8objimp.h"
+#include "c8map.h"
+#include "c8list.h"
+#include "c8ctx.h"
+#include "c8func.h"
+#include "c8error.h"
+#include "c8string.h"
+#include "c8mpz.h"
+#include "c8mpfr.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Creation counts are kept per imp as objects are created, everything else
+// is measured by walking the live allocations when a census is taken. Each
+// allocation is preceded by a link in the list of live allocations.
+
+#define C8HEAP_TYPES 32
+#define C8HEAP_LARGEST_MAX 100
+
+struct counter {
+  const struct c8obj_imp* imp;
+  long created;
+  long last;
+};
+
+struct link {
+  struct link* prev;
+  struct link* next;
+};
+
+#define C8HEAP_ALIGN 16
+#define C8HEAP_LINK ((sizeof(struct link) + C8HEAP_ALIGN-1) & ~(size_t)(C8HEAP_ALIGN-1))
+
+static struct link live = {&live, &live};
+
+static struct counter counters[C8HEAP_TYPES];
+static int ncounters = 0;
+static clock_t last_census = 0;
+
+struct census {
+  struct c8heap_type* types;
+  int n;
+  int max;
+  struct c8obj** objs;
+  size_t* bytes;
+  int nobjs;
+  int maxobjs;
+};
+
+void* c8heap_alloc(size_t n)
+{
+  struct link* l = malloc(C8HEAP_LINK + n);
+  assert(l);
+  l->prev = &live;
+  l->next = live.next;
+  live.next->prev = l;
+  live.next = l;
+  return (char*)l + C8HEAP_LINK;
+}
+
+void c8heap_free(void* p)
+{
+  if (!p) return;
+  struct link* l = (struct link*)((char*)p - C8HEAP_LINK);
+  l->prev->next = l->next;
+  l->next->prev = l->prev;
+  free(l);
+}
+
+typedef void (*walk_func)(void* p, void* arg);
+
+static void walk(walk_func fn, void* arg)
+{
+  for (struct link* l = live.next; l != &live; l = l->next) {
+    fn((char*)l + C8HEAP_LINK, arg);
+  }
+}
+
+void c8heap_created(const struct c8obj_imp* imp)
+{
+  for (int i=0; i<ncounters; ++i) {
+    if (counters[i].imp == imp) {
+      ++counters[i].created;
+      return;
+    }
+  }
+  if (ncounters == C8HEAP_TYPES) return;
+  counters[ncounters].imp = imp;
+  counters[ncounters].created = 1;
+  counters[ncounters].last = 0;
+  ++ncounters;
+}
+
+static struct c8heap_type* census_type(struct census* c, const char* type)
+{
+  for (int i=0; i<c->n; ++i) {
+    if (strcmp(c->types[i].type, type) == 0) return &c->types[i];
+  }
+  if (c->n == c->max) return 0;
+  struct c8heap_type* t = &c->types[c->n++];
+  memset(t, 0, sizeof(struct c8heap_type));
+  t->type = type;
+  return t;
+}
+
+static void census_visit(void* p, void* arg)
+{
+  struct census* c = (struct census*)arg;
+  struct c8obj* o = (struct c8obj*)p;
+  if (o->refs == 0) return; // Destroyed, but storage still shared
+  struct c8obj_stat st = {o->imp->type, 0, 0};
+  if (o->imp->stat) (o->imp->stat)(o, &st);
+  if (!st.type) st.type = "unknown";
+
+  if (c->types) {
+    struct c8heap_type* t = census_type(c, st.type);
+    if (t) {
+      ++t->count;
+      t->bytes += st.bytes;
+      t->limb_bytes += st.limb_bytes;
+    }
+  }
+
+  if (c->objs) {
+    // Insert into the largest so far, keeping them in order
+    int i = c->nobjs;
+    if (i == c->maxobjs) {
+      if (st.bytes <= c->bytes[i-1]) return;
+      --i;
+    } else {
+      ++c->nobjs;
+    }
+    for (; i>0 && c->bytes[i-1] < st.bytes; --i) {
+      c->objs[i] = c->objs[i-1];
+      c->bytes[i] = c->bytes[i-1];
+    }
+    c->objs[i] = o;
+    c->bytes[i] = st.bytes;
+  }
+}
+
+int c8heap_census(struct c8heap_type* types, int max)
+{
+  struct census c = {types, 0, max, 0, 0, 0, 0};
+  // Include types which were created but have no live objects
+  for (int i=0; i<ncounters; ++i) {
+    if (counters[i].imp->type) census_type(&c, counters[i].imp->type);
+  }
+  walk(census_visit, &c);
+
+  clock_t now = clock();
+  double secs = (double)(now - last_census) / CLOCKS_PER_SEC;
+  last_census = now;
+  for (int i=0; i<ncounters; ++i) {
+    struct counter* k = &counters[i];
+    struct c8heap_type* t = k->imp->type ? census_type(&c, k->imp->type) : 0;
+    if (t) {
+      t->created += k->created;
+      if (secs > 0) t->rate += (k->created - k->last) / secs;
+    }
+    k->last = k->created;
+  }
+  return c.n;
+}
+
+int c8heap_largest(struct c8obj** objs, size_t* bytes, int n)
+{
+  if (n <= 0) return 0;
+  struct census c = {0, 0, 0, objs, bytes, 0, n};
+  walk(census_visit, &c);
+  return c.nobjs;
+}
+
+static void stats_set(struct c8map* m, const char* key, struct c8obj* value)
+{
+  c8map_set(m, key, value);
+  c8obj_unref(value);
+}
+
+static struct c8map* stats_type(const struct c8heap_type* t)
+{
+  struct c8map* m = c8map_create();
+  stats_set(m, "count", (struct c8obj*)c8mpz_create_double(t->count));
+  stats_set(m, "bytes", (struct c8obj*)c8mpz_create_double(t->bytes));
+  stats_set(m, "limbs", (struct c8obj*)c8mpz_create_double(t->limb_bytes));
+  stats_set(m, "created", (struct c8obj*)c8mpz_create_double(t->created));
+  stats_set(m, "rate", (struct c8obj*)c8mpfr_create_double(t->rate));
+  return m;
+}
+
+struct c8map* c8heap_stats(int largest)
+{
+  struct c8heap_type types[C8HEAP_TYPES];
+  int n = c8heap_census(types, C8HEAP_TYPES);
+
+  struct c8map* m = c8map_create();
+  struct c8heap_type total = {"total", 0, 0, 0, 0, 0};
+  for (int i=0; i<n; ++i) {
+    stats_set(m, types[i].type, (struct c8obj*)stats_type(&types[i]));
+    total.count += types[i].count;
+    total.bytes += types[i].bytes;
+    total.limb_bytes += types[i].limb_bytes;
+    total.created += types[i].created;
+    total.rate += types[i].rate;
+  }
+  stats_set(m, "total", (struct c8obj*)stats_type(&total));
+
+  if (largest > 0) {
+    if (largest > C8HEAP_LARGEST_MAX) largest = C8HEAP_LARGEST_MAX;
+    struct c8obj* objs[C8HEAP_LARGEST_MAX];
+    size_t bytes[C8HEAP_LARGEST_MAX];
+    int nl = c8heap_largest(objs, bytes, largest);
+    struct c8list* l = c8list_create();
+    for (int i=0; i<nl; ++i) {
+      struct c8map* e = c8map_create();
+      struct c8obj_stat st = {objs[i]->imp->type, 0, 0};
+      if (objs[i]->imp->stat) (objs[i]->imp->stat)(objs[i], &st);
+      stats_set(e, "type", (struct c8obj*)c8string_create_str(st.type ? st.type : "unknown"));
+      stats_set(e, "bytes", (struct c8obj*)c8mpz_create_double(bytes[i]));
+      c8map_set(e, "value", objs[i]);
+      c8list_push_back(l, (struct c8obj*)e);
+      c8obj_unref((struct c8obj*)e);
+    }
+    stats_set(m, "largest", (struct c8obj*)l);
+  }
+  return m;
+}
+
+void c8heap_init_ctx(struct c8ctx* ctx)
+{
+  c8ctx_add(ctx, "heapstats", (struct c8obj*)c8func_create(c8heap_heapstats));
+}
+
+struct c8obj* c8heap_heapstats(struct c8list* args)
+{
+  int n = c8list_size(args);
+  if (n > 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  int largest = n ? c8obj_int(c8list_peek(args, 0)) : 0;
+  return (struct c8obj*)c8heap_stats(largest);
+}
@@ -0,0 +1,72 @@
+/** c8heap - heap statistics and live object census
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+struct c8obj;
+struct c8obj_imp;
+struct c8map;
+struct c8ctx;
+struct c8list;
+
+/** Statistics for one type of object
+ */
+struct c8heap_type {
+  const char* type;
+  long count; // Live objects
+  size_t bytes; // Memory used by live objects, including owned storage
+  size_t limb_bytes; // Part of bytes allocated for GMP limbs
+  long created; // Objects created in total
+  double rate; // Objects created per second since the previous census
+};
+
+/** Allocate and free memory for an object
+ * Live allocations are kept in a list, so the census can find them.
+ */
+void* c8heap_alloc(size_t n);
+void c8heap_free(void* p);
+
+/** Count the creation of an object of the given type
+ */
+void c8heap_created(const struct c8obj_imp* imp);
+
+/** Take a census of live objects
+ * Fills in up to max types and returns the number filled in.
+ */
+int c8heap_census(struct c8heap_type* types, int max);
+
+/** Find the n largest live objects
+ * Fills in objs (borrowed) and their sizes, largest first, and returns the
+ * number found.
+ */
+int c8heap_largest(struct c8obj** objs, size_t* bytes, int n);
+
+/** Get heap statistics as a map
+ * Maps each type name, and "total", to a map of its statistics. If
+ * largest is non-zero, "largest" lists that many of the largest live
+ * objects.
+ */
+struct c8map* c8heap_stats(int largest);
+
+void c8heap_init_ctx(struct c8ctx* ctx);
+
+struct c8obj* c8heap_heapstats(struct c8list* args);
@@ -0,0 +1,858 @@
+/** c8ival - real interval object, using a pair of mpfrs
+ *
+ * Copyright (c) 2021 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8ival.h"
+#include "c8mpz.h"
+#include "c8mpq.h"
+#include "c8mpfr.h"
+#include "c8mpc.h"
+#include "c8f64.h"
+#include "c8obj.h"
+#include "c8ops.h"
+#include "c8bool.h"
+#include "c8error.h"
+#include "c8func.h"
+#include "c8ctx.h"
+#include "c8list.h"
+#include "c8buf.h"
+#include "c8num.h"
+#include "c8numimp.h"
+#include "c8heap.h"
+
+#include <mpfr.h>
+#include <mpc.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The value is somewhere from lo to hi inclusive. Every operation rounds
+ * lo down and hi up, whatever the working rounding mode, so the result
+ * contains every value the operation could give for values in the
+ * operands. Where that can't be bounded (such as dividing by an interval
+ * containing zero) both are NaN, which nothing can be verified from.
+ */
+struct c8ival {
+  struct c8num base;
+  mpfr_t lo;
+  mpfr_t hi;
+};
+
+#define D MPFR_RNDD
+#define U MPFR_RNDU
+
+typedef int (*c8ival_mpfr_func)(mpfr_ptr r, mpfr_srcptr x, mpfr_rnd_t rnd);
+typedef int (*c8ival_mpfr2_func)(mpfr_ptr r, mpfr_srcptr x, mpfr_srcptr y,
+                                 mpfr_rnd_t rnd);
+
+static struct c8ival* c8ival_create_prec(mpfr_prec_t prec);
+
+static void c8ival_set_nan(mpfr_ptr lo, mpfr_ptr hi)
+{
+  mpfr_set_nan(lo);
+  mpfr_set_nan(hi);
+}
+
+static int c8ival_point(const struct c8ival* oo)
+{
+  return mpfr_equal_p(oo->lo, oo->hi);
+}
+
+/* Set bounds from another numeric type directly, returning 0 if obj isn't
+ * one
+ */
+static int c8ival_convert(const struct c8obj* obj, mpfr_ptr lo, mpfr_ptr hi)
+{
+  const struct c8ival* io = to_const_c8ival(obj);
+  if (io) {
+    mpfr_set(lo, io->lo, D);
+    mpfr_set(hi, io->hi, U);
+    return 1;
+  }
+  const struct c8mpz* zo = to_const_c8mpz(obj);
+  if (zo) {
+    mpfr_set_z(lo, c8mpz_value(zo), D);
+    mpfr_set_z(hi, c8mpz_value(zo), U);
+    return 1;
+  }
+  const struct c8mpq* qo = to_const_c8mpq(obj);
+  if (qo) {
+    mpfr_set_q(lo, c8mpq_value(qo), D);
+    mpfr_set_q(hi, c8mpq_value(qo), U);
+    return 1;
+  }
+  const struct c8mpfr* fo = to_const_c8mpfr(obj);
+  if (fo) {
+    mpfr_set(lo, c8mpfr_value(fo), D);
+    mpfr_set(hi, c8mpfr_value(fo), U);
+    return 1;
+  }
+  const struct c8f64* ro = to_const_c8f64(obj);
+  if (ro) {
+    mpfr_set_d(lo, c8f64_value(ro), D);
+    mpfr_set_d(hi, c8f64_value(ro), U);
+    return 1;
+  }
+  const struct c8mpc* co = to_const_c8mpc(obj);
+  if (co) {
+    // Only the real part, as for reals
+    if (!mpfr_zero_p(mpc_imagref(c8mpc_value(co)))) c8num_doubt();
+    mpfr_set(lo, mpc_realref(c8mpc_value(co)), D);
+    mpfr_set(hi, mpc_realref(c8mpc_value(co)), U);
+    return 1;
+  }
+  return 0;
+}
+
+// Set r from f applied to each combination of bounds, for functions which
+// are monotone in each argument so are bounded by the corners
+static void c8ival_corners(mpfr_ptr lo, mpfr_ptr hi, c8ival_mpfr2_func f,
+                           const struct c8ival* a, const struct c8ival* b)
+{
+  mpfr_srcptr x[2] = { a->lo, a->hi };
+  mpfr_srcptr y[2] = { b->lo, b->hi };
+  mpfr_t t; mpfr_init2(t, mpfr_get_prec(lo));
+  int nan = 0;
+  for (int i=0; i<4; ++i) {
+    f(t, x[i/2], y[i%2], D);
+    nan |= mpfr_nan_p(t);
+    if (i == 0 || mpfr_less_p(t, lo)) mpfr_set(lo, t, D);
+    f(t, x[i/2], y[i%2], U);
+    nan |= mpfr_nan_p(t);
+    if (i == 0 || mpfr_greater_p(t, hi)) mpfr_set(hi, t, U);
+  }
+  mpfr_clear(t);
+  if (nan) c8ival_set_nan(lo, hi);
+}
+
+static int c8ival_contains_zero(const struct c8ival* a)
+{
+  return mpfr_sgn(a->lo) <= 0 && mpfr_sgn(a->hi) >= 0;
+}
+
+// Raise to an integer power, which is monotone on either side of zero
+static void c8ival_pow_si(mpfr_ptr lo, mpfr_ptr hi, const struct c8ival* a,
+                          long n)
+{
+  int even = (n % 2) == 0;
+  if (n == 0) {
+    mpfr_set_ui(lo, 1, D);
+    mpfr_set_ui(hi, 1, U);
+  } else if (n < 0 && c8ival_contains_zero(a)) {
+    c8ival_set_nan(lo, hi);
+  } else if (even && n > 0 && c8ival_contains_zero(a)) {
+    mpfr_set_ui(lo, 0, D);
+    if (mpfr_cmpabs(a->lo, a->hi) > 0) mpfr_pow_si(hi, a->lo, n, U);
+    else mpfr_pow_si(hi, a->hi, n, U);
+  } else {
+    // Decreasing for even powers of negatives and all negative powers of
+    // positives, except where both apply
+    int down = even ? ((mpfr_sgn(a->hi) <= 0) != (n < 0)) : (n < 0);
+    mpfr_pow_si(lo, down ? a->hi : a->lo, n, D);
+    mpfr_pow_si(hi, down ? a->lo : a->hi, n, U);
+  }
+}
+
+static void c8ival_pow(mpfr_ptr lo, mpfr_ptr hi, const struct c8ival* a,
+                       const struct c8ival* b)
+{
+  if (c8ival_point(b) && mpfr_integer_p(b->lo) &&
+      mpfr_fits_slong_p(b->lo, D)) {
+    c8ival_pow_si(lo, hi, a, mpfr_get_si(b->lo, D));
+  } else if (mpfr_sgn(a->lo) > 0 ||
+             (mpfr_zero_p(a->lo) && mpfr_sgn(b->lo) > 0)) {
+    c8ival_corners(lo, hi, mpfr_pow, a, b);
+  } else {
+    // Negative bases need an integer power
+    c8ival_set_nan(lo, hi);
+  }
+}
+
+// Remainder after dividing by a single value, which is increasing in the
+// dividend between the multiples of the divisor where it jumps
+static void c8ival_fmod(mpfr_ptr lo, mpfr_ptr hi, const struct c8ival* a,
+                        const struct c8ival* b)
+{
+  if (!c8ival_point(b) || mpfr_zero_p(b->lo)) {
+    c8ival_set_nan(lo, hi);
+    return;
+  }
+  mpfr_t ql, qh, y;
+  mpfr_inits2(mpfr_get_prec(lo), ql, qh, (mpfr_ptr)0);
+  mpfr_init2(y, mpfr_get_prec(b->lo));
+  mpfr_abs(y, b->lo, D);
+  mpfr_div(ql, a->lo, y, D);
+  mpfr_div(qh, a->hi, y, U);
+  mpfr_trunc(ql, ql);
+  mpfr_trunc(qh, qh);
+  if (mpfr_equal_p(ql, qh)) {
+    mpfr_fmod(lo, a->lo, y, D);
+    mpfr_fmod(hi, a->hi, y, U);
+  } else {
+    c8ival_set_nan(lo, hi);
+  }
+  mpfr_clears(ql, qh, y, (mpfr_ptr)0);
+}
+
+// Arithmetic, giving bounds in lo and hi, which mustn't be a's or b's
+static void c8ival_arith(mpfr_ptr lo, mpfr_ptr hi, int op,
+                         const struct c8ival* a, const struct c8ival* b)
+{
+  switch (op) {
+    case C8_OP_ADD:
+    case C8_OP_ADD_ASSIGN:
+      mpfr_add(lo, a->lo, b->lo, D);
+      mpfr_add(hi, a->hi, b->hi, U);
+      break;
+    case C8_OP_SUBTRACT:
+    case C8_OP_SUBTRACT_ASSIGN:
+      mpfr_sub(lo, a->lo, b->hi, D);
+      mpfr_sub(hi, a->hi, b->lo, U);
+      break;
+    case C8_OP_MULTIPLY:
+    case C8_OP_MULTIPLY_ASSIGN:
+      c8ival_corners(lo, hi, mpfr_mul, a, b);
+      break;
+    case C8_OP_DIVIDE:
+    case C8_OP_DIVIDE_ASSIGN:
+      if (c8ival_contains_zero(b)) c8ival_set_nan(lo, hi);
+      else c8ival_corners(lo, hi, mpfr_div, a, b);
+      break;
+    case C8_OP_MODULUS:
+      c8ival_fmod(lo, hi, a, b);
+      break;
+    case C8_OP_POWER:
+      c8ival_pow(lo, hi, a, b);
+      break;
+    case C8_OP_ASSIGN:
+      mpfr_set(lo, b->lo, D);
+      mpfr_set(hi, b->hi, U);
+      break;
+  }
+}
+
+/* Compare intervals, which is only decided when the result is the same
+ * for all values in them. Otherwise the lower bounds are compared, and the
+ * result noted as doubtful.
+ */
+static int c8ival_compare(int op, const struct c8ival* a,
+                          const struct c8ival* b)
+{
+  int yes = 0;
+  int no = 0;
+  switch (op) {
+    case C8_OP_EQUALITY:
+    case C8_OP_INEQUALITY:
+      yes = c8ival_point(a) && c8ival_point(b) && mpfr_equal_p(a->lo, b->lo);
+      no = mpfr_less_p(a->hi, b->lo) || mpfr_greater_p(a->lo, b->hi);
+      break;
+    case C8_OP_GREATER:
+      yes = mpfr_greater_p(a->lo, b->hi);
+      no = mpfr_lessequal_p(a->hi, b->lo);
+      break;
+    case C8_OP_LESS:
+      yes = mpfr_less_p(a->hi, b->lo);
+      no = mpfr_greaterequal_p(a->lo, b->hi);
+      break;
+    case C8_OP_GREATER_OR_EQUAL:
+      yes = mpfr_greaterequal_p(a->lo, b->hi);
+      no = mpfr_less_p(a->hi, b->lo);
+      break;
+    case C8_OP_LESS_OR_EQUAL:
+      yes = mpfr_lessequal_p(a->hi, b->lo);
+      no = mpfr_greater_p(a->lo, b->hi);
+      break;
+  }
+  if (!yes && !no) {
+    c8num_doubt();
+    int c = mpfr_cmp(a->lo, b->lo);
+    switch (op) {
+      case C8_OP_EQUALITY: case C8_OP_INEQUALITY: yes = (c == 0); break;
+      case C8_OP_GREATER: yes = (c > 0); break;
+      case C8_OP_LESS: yes = (c < 0); break;
+      case C8_OP_GREATER_OR_EQUAL: yes = (c >= 0); break;
+      case C8_OP_LESS_OR_EQUAL: yes = (c <= 0); break;
+    }
+  }
+  if (op == C8_OP_INEQUALITY) yes = !yes;
+  return yes;
+}
+
+static void c8ival_destroy(struct c8obj* o)
+{
+  struct c8ival* oo = to_c8ival(o);
+  assert(oo);
+  mpfr_clear(oo->lo);
+  mpfr_clear(oo->hi);
+  c8heap_free(oo);
+}
+
+static struct c8obj* c8ival_copy(const struct c8obj* o)
+{
+  const struct c8ival* oo = to_const_c8ival(o);
+  assert(oo);
+  struct c8ival* nr = c8ival_create_prec(mpfr_get_prec(oo->lo));
+  mpfr_set(nr->lo, oo->lo, D);
+  mpfr_set(nr->hi, oo->hi, U);
+  return (struct c8obj*)nr;
+}
+
+static int c8ival_int(const struct c8obj* o)
+{
+  const struct c8ival* oo = to_const_c8ival(o);
+  assert(oo);
+  long lo = mpfr_get_si(oo->lo, MPFR_RNDZ);
+  if (!mpfr_number_p(oo->lo) || !mpfr_number_p(oo->hi) ||
+      lo != mpfr_get_si(oo->hi, MPFR_RNDZ)) {
+    c8num_doubt();
+  }
+  return (int)lo;
+}
+
+static void c8ival_str(const struct c8obj* o, struct c8buf* buf, int f)
+{
+  const struct c8ival* oo = to_const_c8ival(o);
+  assert(oo);
+
+  // Shown as the nearest real to the midpoint, which is only the value if
+  // the interval is a single one. This isn't doubted, as it's also used for
+  // debug output.
+  mpfr_t mid;
+  mpfr_init2(mid, mpfr_get_prec(oo->lo) + 1);
+  mpfr_add(mid, oo->lo, oo->hi, MPFR_RNDN);
+  mpfr_div_2ui(mid, mid, 1, MPFR_RNDN);
+  mpfr_prec_round(mid, mpfr_get_prec(oo->lo), MPFR_RNDN);
+  struct c8obj* r = (struct c8obj*)c8mpfr_create_exact(mid);
+  c8obj_str(r, buf, f);
+  c8obj_unref(r);
+  mpfr_clear(mid);
+}
+
+static struct c8obj* c8ival_binary_op(struct c8ival* oo, int op,
+                                      const struct c8ival* np)
+{
+  switch (op) {
+    case C8_OP_ADD:
+    case C8_OP_SUBTRACT:
+    case C8_OP_MULTIPLY:
+    case C8_OP_DIVIDE:
+    case C8_OP_MODULUS:
+    case C8_OP_POWER: {
+      struct c8ival* nr = c8ival_create();
+      c8ival_arith(nr->lo, nr->hi, op, oo, np);
+      return (struct c8obj*)nr;
+    }
+
+    case C8_OP_EQUALITY:
+    case C8_OP_INEQUALITY:
+    case C8_OP_GREATER:
+    case C8_OP_LESS:
+    case C8_OP_GREATER_OR_EQUAL:
+    case C8_OP_LESS_OR_EQUAL:
+      return (struct c8obj*)c8bool_create(c8ival_compare(op, oo, np));
+
+    case C8_OP_ASSIGN:
+    case C8_OP_ADD_ASSIGN:
+    case C8_OP_SUBTRACT_ASSIGN:
+    case C8_OP_MULTIPLY_ASSIGN:
+    case C8_OP_DIVIDE_ASSIGN: {
+      // Into new bounds, as the operands may be the same
+      struct c8ival* nr = c8ival_create_prec(mpfr_get_prec(oo->lo));
+      c8ival_arith(nr->lo, nr->hi, op, oo, np);
+      mpfr_swap(oo->lo, nr->lo);
+      mpfr_swap(oo->hi, nr->hi);
+      c8obj_unref((struct c8obj*)nr);
+      return c8obj_ref((struct c8obj*)oo);
+    }
+  }
+  return 0;
+}
+
+static const int c8ival_kernel_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_MODULUS,
+  C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+// Used with any real or integer operand, which is converted exactly
+static struct c8obj* c8ival_kernel(struct c8obj* o, int op, struct c8obj* p)
+{
+  if (to_c8ival(p)) {
+    return c8ival_binary_op((struct c8ival*)o, op, (struct c8ival*)p);
+  }
+  struct c8ival* np = c8ival_create_c8obj(p);
+  struct c8obj* r = c8ival_binary_op((struct c8ival*)o, op, np);
+  c8obj_unref((struct c8obj*)np);
+  return r;
+}
+
+// Other reals operated on by an interval, done as intervals rather than in
+// the left operand's type as for reals of the same rank
+static const int c8ival_left_kernel_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_MODULUS,
+  C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8ival_left_kernel(struct c8obj* o, int op,
+                                        struct c8obj* p)
+{
+  struct c8ival* no = c8ival_create_c8obj(o);
+  struct c8obj* r = c8ival_binary_op(no, op, (struct c8ival*)p);
+  c8obj_unref((struct c8obj*)no);
+  return r;
+}
+
+static struct c8obj* c8ival_lookup(struct c8obj* o, const char* name)
+{
+  if (strcmp("abs", name)==0) return (struct c8obj*)c8func_create_method(c8ival_abs, o);
+  if (strcmp("ceil", name)==0) return (struct c8obj*)c8func_create_method(c8ival_ceil, o);
+  if (strcmp("floor", name)==0) return (struct c8obj*)c8func_create_method(c8ival_floor, o);
+  if (strcmp("trunc", name)==0) return (struct c8obj*)c8func_create_method(c8ival_trunc, o);
+  if (strcmp("log", name)==0) return (struct c8obj*)c8func_create_method(c8ival_log, o);
+  if (strcmp("exp", name)==0) return (struct c8obj*)c8func_create_method(c8ival_exp, o);
+  if (strcmp("sqrt", name)==0) return (struct c8obj*)c8func_create_method(c8ival_sqrt, o);
+  if (strcmp("cos", name)==0) return (struct c8obj*)c8func_create_method(c8ival_cos, o);
+  if (strcmp("sin", name)==0) return (struct c8obj*)c8func_create_method(c8ival_sin, o);
+  if (strcmp("tan", name)==0) return (struct c8obj*)c8func_create_method(c8ival_tan, o);
+  if (strcmp("acos", name)==0) return (struct c8obj*)c8func_create_method(c8ival_acos, o);
+  if (strcmp("asin", name)==0) return (struct c8obj*)c8func_create_method(c8ival_asin, o);
+  if (strcmp("atan", name)==0) return (struct c8obj*)c8func_create_method(c8ival_atan, o);
+  if (strcmp("atan2", name)==0) return (struct c8obj*)c8func_create_method(c8ival_atan2, o);
+  if (strcmp("cosh", name)==0) return (struct c8obj*)c8func_create_method(c8ival_cosh, o);
+  if (strcmp("sinh", name)==0) return (struct c8obj*)c8func_create_method(c8ival_sinh, o);
+  if (strcmp("tanh", name)==0) return (struct c8obj*)c8func_create_method(c8ival_tanh, o);
+  if (strcmp("mean", name)==0) return (struct c8obj*)c8func_create_method(c8ival_mean, o);
+  return 0;
+}
+
+static struct c8obj* c8ival_op(struct c8obj* o, int op, struct c8obj* p)
+{
+  struct c8ival* oo = to_c8ival(o);
+  assert(oo);
+
+  switch (op) {
+    case C8_OP_LOOKUP: {
+      struct c8buf nb; c8buf_init(&nb);
+      c8obj_str(p, &nb, 0);
+      struct c8obj* ret = c8ival_lookup(o, c8buf_str(&nb));
+      c8buf_clear(&nb);
+      return ret;
+    }
+    case C8_OP_POSITIVE:
+      return c8ival_copy(o);
+    case C8_OP_NEGATIVE: {
+      struct c8ival* nr = c8ival_create();
+      mpfr_neg(nr->lo, oo->hi, D);
+      mpfr_neg(nr->hi, oo->lo, U);
+      return (struct c8obj*)nr;
+    }
+    case C8_OP_PRE_INC:
+      mpfr_add_ui(oo->lo, oo->lo, 1, D);
+      mpfr_add_ui(oo->hi, oo->hi, 1, U);
+      return c8obj_ref(o);
+    case C8_OP_PRE_DEC:
+      mpfr_sub_ui(oo->lo, oo->lo, 1, D);
+      mpfr_sub_ui(oo->hi, oo->hi, 1, U);
+      return c8obj_ref(o);
+    case C8_OP_FACTORIAL: {
+      if (!c8ival_point(oo) || !mpfr_integer_p(oo->lo) ||
+          mpfr_sgn(oo->lo) < 0 || !mpfr_fits_ulong_p(oo->lo, D)) {
+        return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+      }
+      struct c8ival* nr = c8ival_create();
+      mpfr_fac_ui(nr->lo, mpfr_get_ui(oo->lo, D), D);
+      mpfr_fac_ui(nr->hi, mpfr_get_ui(oo->lo, D), U);
+      return (struct c8obj*)nr;
+    }
+    case C8_OP_POST_INC: {
+      struct c8obj* nr = c8ival_copy(o);
+      mpfr_add_ui(oo->lo, oo->lo, 1, D);
+      mpfr_add_ui(oo->hi, oo->hi, 1, U);
+      return nr;
+    }
+    case C8_OP_POST_DEC: {
+      struct c8obj* nr = c8ival_copy(o);
+      mpfr_sub_ui(oo->lo, oo->lo, 1, D);
+      mpfr_sub_ui(oo->hi, oo->hi, 1, U);
+      return nr;
+    }
+  }
+
+  // Convert p to an interval and perform the op
+  if (p) {
+    struct c8ival* np = c8ival_create_c8obj(p);
+    struct c8obj* r = c8ival_binary_op(oo, op, np);
+    c8obj_unref((struct c8obj*)np);
+    return r;
+  }
+
+  return 0;
+}
+
+static void c8ival_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8ival* oo = to_const_c8ival(o);
+  assert(oo);
+  st->limb_bytes = mpfr_custom_get_size(mpfr_get_prec(oo->lo)) +
+    mpfr_custom_get_size(mpfr_get_prec(oo->hi));
+  st->bytes = sizeof(struct c8ival) + st->limb_bytes;
+}
+
+static const struct c8obj_imp c8ival_imp = {
+  c8ival_destroy,
+  c8ival_copy,
+  c8ival_int,
+  c8ival_str,
+  c8ival_op,
+  0,
+  c8ival_stat,
+  "ival"
+};
+
+const struct c8ival* to_const_c8ival(const struct c8obj* o)
+{
+  const struct c8num* on = to_const_c8num(o);
+  return (on && on->imp && on->imp == &c8ival_imp) ?
+    (const struct c8ival*)o : 0;
+}
+
+struct c8ival* to_c8ival(struct c8obj* o)
+{
+  return (struct c8ival*)to_const_c8ival(o);
+}
+
+static struct c8ival* c8ival_create_prec(mpfr_prec_t prec)
+{
+  struct c8ival* oo = (struct c8ival*)c8heap_alloc(sizeof(struct c8ival));
+  assert(oo);
+  c8num_init(&oo->base, &c8ival_imp);
+  mpfr_init2(oo->lo, prec);
+  mpfr_init2(oo->hi, prec);
+  mpfr_set_zero(oo->lo, 1);
+  mpfr_set_zero(oo->hi, 1);
+  return oo;
+}
+
+struct c8ival* c8ival_create()
+{
+  return c8ival_create_prec(c8num_prec());
+}
+
+struct c8ival* c8ival_create_str(const char* str)
+{
+  struct c8ival* oo = c8ival_create();
+  int len = strlen(str);
+  int base = 10;
+  if (len > 2 && str[0] == '0') {
+    switch (str[1]) {
+      case 'b': base = 2; str+=2; break;
+      case 'o': base = 8; str+=2; break;
+      case 'd': base = 10; str+=2; break;
+      case 'x': base = 16; str+=2; break;
+    }
+  }
+  if (mpfr_set_str(oo->lo, str, base, D) != 0 ||
+      mpfr_set_str(oo->hi, str, base, U) != 0) {
+    c8ival_set_nan(oo->lo, oo->hi);
+  }
+  return oo;
+}
+
+struct c8ival* c8ival_create_c8obj(const struct c8obj* obj)
+{
+  assert(obj);
+  struct c8ival* oo = c8ival_create();
+  if (c8ival_convert(obj, oo->lo, oo->hi)) return oo;
+  c8obj_unref((struct c8obj*)oo);
+  struct c8buf buf; c8buf_init(&buf);
+  c8obj_str(obj, &buf, 0);
+  oo = c8ival_create_str(c8buf_len(&buf) ? c8buf_str(&buf) : "");
+  c8buf_clear(&buf);
+  return oo;
+}
+
+mpfr_srcptr c8ival_lo(const struct c8ival* oo)
+{
+  assert(oo);
+  return oo->lo;
+}
+
+mpfr_srcptr c8ival_hi(const struct c8ival* oo)
+{
+  assert(oo);
+  return oo->hi;
+}
+
+static struct c8num* c8ival_real_create(const char* str)
+{
+  return (struct c8num*)c8ival_create_str(str);
+}
+
+static struct c8num* c8ival_real_convert(const struct c8obj* o)
+{
+  return (struct c8num*)c8ival_create_c8obj(o);
+}
+
+static struct c8num* c8ival_real_bounds(const struct c8obj* lo,
+                                        const struct c8obj* hi)
+{
+  struct c8ival* l = c8ival_create_c8obj(lo);
+  struct c8ival* h = c8ival_create_c8obj(hi);
+  mpfr_swap(l->hi, h->hi);
+  c8obj_unref((struct c8obj*)h);
+  return (struct c8num*)l;
+}
+
+static struct c8obj* c8ival_real_narrow(const struct c8obj* o)
+{
+  const struct c8ival* oo = to_const_c8ival(o);
+  assert(oo);
+  mpfr_t lo, hi;
+  mpfr_inits2(c8num_prec(), lo, hi, (mpfr_ptr)0);
+  mpfr_set(lo, oo->lo, MPFR_RNDN);
+  mpfr_set(hi, oo->hi, MPFR_RNDN);
+  struct c8obj* r = 0;
+  if (mpfr_equal_p(lo, hi)) r = (struct c8obj*)c8mpfr_create_exact(lo);
+  mpfr_clears(lo, hi, (mpfr_ptr)0);
+  return r;
+}
+
+void c8ival_init_ctx(struct c8ctx* ctx)
+{
+  int t = c8num_register_interval_real(&c8ival_imp, c8ival_real_create,
+                                       c8ival_real_convert, c8ival_real_bounds,
+                                       c8ival_real_narrow);
+  c8num_register_kernel(t, t, c8ival_kernel_ops, c8ival_kernel);
+  static const char* reals[] = { "mpz", "mpq", "mpfr", "f64", 0 };
+  for (int i=0; reals[i]; ++i) {
+    int r = c8num_type_id(reals[i]);
+    c8num_register_kernel(t, r, c8ival_kernel_ops, c8ival_kernel);
+  }
+  c8num_register_kernel(c8num_type_id("mpfr"), t, c8ival_left_kernel_ops,
+                        c8ival_left_kernel);
+  c8num_register_kernel(c8num_type_id("f64"), t, c8ival_left_kernel_ops,
+                        c8ival_left_kernel);
+}
+
+/* Get the single argument as a c8ival, borrowed from the list if it already
+ * is one. Any new object (a conversion or an error) is also returned in owned,
+ * which the caller must unref.
+ */
+static struct c8obj* c8ival_single_arg(struct c8list* args, struct c8obj** owned)
+{
+  *owned = 0;
+  if (c8list_size(args) != 1)
+    return *owned = (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* a = c8list_peek(args, 0);
+  if (!a)
+    return *owned = (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  if (to_c8ival(a)) return a;
+  return *owned = (struct c8obj*)c8ival_create_c8obj(a);
+}
+
+#define C8IVAL_SINGLE_ARG_FN(name, code)            \
+  struct c8obj* c8ival_##name (struct c8list* args) \
+  {                                                 \
+    struct c8obj* t;                                \
+    struct c8obj* a = c8ival_single_arg(args, &t);  \
+    struct c8ival* na = to_c8ival(a);               \
+    if (!na) return a;                              \
+    struct c8ival* nr = c8ival_create();            \
+    code;                                           \
+    c8obj_unref(t);                                 \
+    return (struct c8obj*)nr;                       \
+  }
+
+static void c8ival_increasing(struct c8ival* r, const struct c8ival* a,
+                              c8ival_mpfr_func f)
+{
+  f(r->lo, a->lo, D);
+  f(r->hi, a->hi, U);
+  if (mpfr_nan_p(r->lo) || mpfr_nan_p(r->hi)) c8ival_set_nan(r->lo, r->hi);
+}
+
+static void c8ival_decreasing(struct c8ival* r, const struct c8ival* a,
+                              c8ival_mpfr_func f)
+{
+  f(r->lo, a->hi, D);
+  f(r->hi, a->lo, U);
+  if (mpfr_nan_p(r->lo) || mpfr_nan_p(r->hi)) c8ival_set_nan(r->lo, r->hi);
+}
+
+static void c8ival_set_abs(struct c8ival* r, const struct c8ival* a)
+{
+  if (mpfr_sgn(a->lo) >= 0) {
+    mpfr_set(r->lo, a->lo, D);
+    mpfr_set(r->hi, a->hi, U);
+  } else if (mpfr_sgn(a->hi) <= 0) {
+    mpfr_neg(r->lo, a->hi, D);
+    mpfr_neg(r->hi, a->lo, U);
+  } else {
+    mpfr_set_ui(r->lo, 0, D);
+    if (mpfr_cmpabs(a->lo, a->hi) > 0) mpfr_neg(r->hi, a->lo, U);
+    else mpfr_set(r->hi, a->hi, U);
+  }
+  if (mpfr_nan_p(a->lo) || mpfr_nan_p(a->hi)) c8ival_set_nan(r->lo, r->hi);
+}
+
+/* Bounds on the integers k where a + k*pi lies in the interval, giving the
+ * number of them
+ */
+static int c8ival_turns(const struct c8ival* x, mpfr_ptr k, double a)
+{
+  if (!mpfr_number_p(x->lo) || !mpfr_number_p(x->hi)) return 2;
+  mpfr_prec_t prec = mpfr_get_prec(x->lo) + 8;
+  mpfr_t plo, phi, tlo, thi;
+  mpfr_inits2(prec, plo, phi, tlo, thi, (mpfr_ptr)0);
+  mpfr_const_pi(plo, D);
+  mpfr_const_pi(phi, U);
+  // Dividing by the larger pi gives the smaller magnitude
+  mpfr_div(tlo, x->lo, mpfr_sgn(x->lo) >= 0 ? phi : plo, D);
+  mpfr_div(thi, x->hi, mpfr_sgn(x->hi) >= 0 ? plo : phi, U);
+  mpfr_sub_d(tlo, tlo, a, D);
+  mpfr_sub_d(thi, thi, a, U);
+  mpfr_ceil(tlo, tlo);
+  mpfr_floor(thi, thi);
+  int n = 0;
+  if (mpfr_lessequal_p(tlo, thi)) {
+    mpfr_sub(thi, thi, tlo, U);
+    n = mpfr_cmp_ui(thi, 0) == 0 ? 1 : 2;
+    mpfr_set_prec(k, prec);
+    mpfr_set(k, tlo, D);
+  }
+  mpfr_clears(plo, phi, tlo, thi, (mpfr_ptr)0);
+  return n;
+}
+
+// Sine or cosine, which take their bounds at the ends unless the interval
+// contains a turning point, at a + k*pi with a maximum for even k
+static void c8ival_wave(struct c8ival* r, const struct c8ival* x,
+                        c8ival_mpfr_func f, double a)
+{
+  mpfr_t k, t;
+  mpfr_init2(k, mpfr_get_prec(r->lo));
+  mpfr_init2(t, mpfr_get_prec(r->lo));
+  int n = c8ival_turns(x, k, a);
+  if (n > 1) {
+    mpfr_set_si(r->lo, -1, D);
+    mpfr_set_si(r->hi, 1, U);
+  } else {
+    f(r->lo, x->lo, D);
+    f(t, x->hi, D);
+    mpfr_min(r->lo, r->lo, t, D);
+    f(r->hi, x->lo, U);
+    f(t, x->hi, U);
+    mpfr_max(r->hi, r->hi, t, U);
+    if (n == 1) {
+      mpfr_div_2ui(k, k, 1, D);
+      if (mpfr_integer_p(k)) mpfr_set_si(r->hi, 1, U);
+      else mpfr_set_si(r->lo, -1, D);
+    }
+  }
+  mpfr_clears(k, t, (mpfr_ptr)0);
+}
+
+// Tangent, which is increasing between its poles at pi/2 + k*pi
+static void c8ival_set_tan(struct c8ival* r, const struct c8ival* x)
+{
+  mpfr_t k;
+  mpfr_init2(k, mpfr_get_prec(r->lo));
+  if (c8ival_turns(x, k, 0.5) > 0) c8ival_set_nan(r->lo, r->hi);
+  else c8ival_increasing(r, x, mpfr_tan);
+  mpfr_clear(k);
+}
+
+// Hyperbolic cosine, which is increasing with the magnitude
+static void c8ival_set_cosh(struct c8ival* r, const struct c8ival* x)
+{
+  c8ival_set_abs(r, x);
+  c8ival_increasing(r, r, mpfr_cosh);
+}
+
+C8IVAL_SINGLE_ARG_FN(abs, c8ival_set_abs(nr, na))
+C8IVAL_SINGLE_ARG_FN(ceil, c8ival_increasing(nr, na, mpfr_rint_ceil))
+C8IVAL_SINGLE_ARG_FN(floor, c8ival_increasing(nr, na, mpfr_rint_floor))
+C8IVAL_SINGLE_ARG_FN(trunc, c8ival_increasing(nr, na, mpfr_rint_trunc))
+C8IVAL_SINGLE_ARG_FN(log, c8ival_increasing(nr, na, mpfr_log))
+C8IVAL_SINGLE_ARG_FN(exp, c8ival_increasing(nr, na, mpfr_exp))
+C8IVAL_SINGLE_ARG_FN(sqrt, c8ival_increasing(nr, na, mpfr_sqrt))
+C8IVAL_SINGLE_ARG_FN(cos, c8ival_wave(nr, na, mpfr_cos, 0))
+C8IVAL_SINGLE_ARG_FN(sin, c8ival_wave(nr, na, mpfr_sin, 0.5))
+C8IVAL_SINGLE_ARG_FN(tan, c8ival_set_tan(nr, na))
+C8IVAL_SINGLE_ARG_FN(acos, c8ival_decreasing(nr, na, mpfr_acos))
+C8IVAL_SINGLE_ARG_FN(asin, c8ival_increasing(nr, na, mpfr_asin))
+C8IVAL_SINGLE_ARG_FN(atan, c8ival_increasing(nr, na, mpfr_atan))
+C8IVAL_SINGLE_ARG_FN(cosh, c8ival_set_cosh(nr, na))
+C8IVAL_SINGLE_ARG_FN(sinh, c8ival_increasing(nr, na, mpfr_sinh))
+C8IVAL_SINGLE_ARG_FN(tanh, c8ival_increasing(nr, na, mpfr_tanh))
+
+struct c8obj* c8ival_atan2(struct c8list* args)
+{
+  if (c8list_size(args) != 2)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* y = c8list_peek(args, 0);
+  struct c8obj* x = c8list_peek(args, 1);
+  if (!y || !x)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8ival* ty = 0;
+  struct c8ival* ny = to_c8ival(y);
+  if (!ny) ny = ty = c8ival_create_c8obj(y);
+  struct c8ival* tx = 0;
+  struct c8ival* nx = to_c8ival(x);
+  if (!nx) nx = tx = c8ival_create_c8obj(x);
+  struct c8ival* nr = c8ival_create();
+  // Bounded by the corners, unless the angle could wrap around at -pi
+  if (mpfr_sgn(nx->lo) <= 0 && c8ival_contains_zero(ny)) {
+    c8ival_set_nan(nr->lo, nr->hi);
+  } else {
+    c8ival_corners(nr->lo, nr->hi, mpfr_atan2, ny, nx);
+  }
+  c8obj_unref((struct c8obj*)ty);
+  c8obj_unref((struct c8obj*)tx);
+  return (struct c8obj*)nr;
+}
+
+struct c8obj* c8ival_mean(struct c8list* args)
+{
+  int n = c8list_size(args);
+  if (n == 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8ival* nr = c8ival_create();
+
+  for (int i=0; i<n; ++i) {
+    struct c8obj* a = c8list_peek(args, i);
+    if (!a) continue;
+    struct c8ival* ta = 0;
+    struct c8ival* na = to_c8ival(a);
+    if (!na) na = ta = c8ival_create_c8obj(a);
+    mpfr_add(nr->lo, nr->lo, na->lo, D);
+    mpfr_add(nr->hi, nr->hi, na->hi, U);
+    c8obj_unref((struct c8obj*)ta);
+  }
+  mpfr_div_ui(nr->lo, nr->lo, n, D);
+  mpfr_div_ui(nr->hi, nr->hi, n, U);
+  return (struct c8obj*)nr;
+}
@@ -0,0 +1,74 @@
+/** c8ival - real interval object, using a pair of mpfrs
+ *
+ * Copyright (c) 2021 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <mpfr.h>
+
+struct c8ival;
+struct c8obj;
+struct c8ctx;
+struct c8list;
+
+/** Safe casts from c8obj
+ */
+const struct c8ival* to_const_c8ival(const struct c8obj* o);
+struct c8ival* to_c8ival(struct c8obj* o);
+
+/** Create a c8ival object at the working precision, containing the value
+ * of another object. A real is taken to be exact, and a string to be the
+ * decimal it gives.
+ */
+struct c8ival* c8ival_create();
+struct c8ival* c8ival_create_str(const char* str);
+struct c8ival* c8ival_create_c8obj(const struct c8obj* obj);
+
+/** Get the bounds, which must not be modified. Either is NaN if nothing is
+ * known about the value.
+ */
+mpfr_srcptr c8ival_lo(const struct c8ival* oo);
+mpfr_srcptr c8ival_hi(const struct c8ival* oo);
+
+/** Make intervals available as reals, for adaptive evaluation (see
+ * c8num_adaptive). Should be called after c8mpfr_init_ctx.
+ */
+void c8ival_init_ctx(struct c8ctx* ctx);
+
+/** Functions, giving intervals which contain every result for values in
+ * the arguments' intervals
+ */
+struct c8obj* c8ival_abs(struct c8list* args);
+struct c8obj* c8ival_ceil(struct c8list* args);
+struct c8obj* c8ival_floor(struct c8list* args);
+struct c8obj* c8ival_trunc(struct c8list* args);
+struct c8obj* c8ival_log(struct c8list* args);
+struct c8obj* c8ival_exp(struct c8list* args);
+struct c8obj* c8ival_sqrt(struct c8list* args);
+struct c8obj* c8ival_cos(struct c8list* args);
+struct c8obj* c8ival_sin(struct c8list* args);
+struct c8obj* c8ival_tan(struct c8list* args);
+struct c8obj* c8ival_acos(struct c8list* args);
+struct c8obj* c8ival_asin(struct c8list* args);
+struct c8obj* c8ival_atan(struct c8list* args);
+struct c8obj* c8ival_atan2(struct c8list* args);
+struct c8obj* c8ival_cosh(struct c8list* args);
+struct c8obj* c8ival_sinh(struct c8list* args);
+struct c8obj* c8ival_tanh(struct c8list* args);
+struct c8obj* c8ival_mean(struct c8list* args);
@@ -23,41 +23,173 @@
 #include "c8objimp.h"
 #include "c8vec.h"
 #include "c8buf.h"
+#include "c8heap.h"
+#include "c8ops.h"
+#include "c8func.h"
+#include "c8error.h"
+#include "c8mpz.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+// Items per chunk, and the smallest chunk allocated for a short list
+#define C8LIST_CHUNK 64
+#define C8LIST_CHUNK_MIN 4
+
+/* Items are held in chunks, which are shared between copies of a list
+ * along with the directory of chunks. Modifying a list sharing them copies
+ * the directory and just the chunk being changed, so the first change after
+ * a copy costs O(n/C8LIST_CHUNK) rather than O(n).
+ *
+ * Item i is in slot (head+i) % C8LIST_CHUNK of chunk (head+i) / C8LIST_CHUNK.
+ * A list with a single chunk may have a smaller one, which then starts at
+ * head 0 and grows as needed. Unused slots are null.
+ */
+struct chunk {
+  int refs;
+  int max;
+  struct c8obj* item[];
+};
+
+struct items {
+  int refs;
+  struct c8vec chunks;
+  int head;
+  int size;
+};
 
 struct c8list {
   struct c8obj base;
-  struct c8vec vec;
+  struct items* items;
 };
 
+static struct chunk* chunk_create(int max)
+{
+  struct chunk* c = calloc(1, sizeof(struct chunk) + max * sizeof(void*));
+  assert(c);
+  c->refs = 1;
+  c->max = max;
+  return c;
+}
+
+static void chunk_unref(struct chunk* c)
+{
+  assert(c->refs > 0);
+  if (--c->refs > 0) return;
+  for (int i=0; i<c->max; ++i) c8obj_unref(c->item[i]);
+  free(c);
+}
+
+// Copy of a chunk with room for max items, sharing the items
+static struct chunk* chunk_copy(const struct chunk* c, int max)
+{
+  assert(max >= c->max);
+  struct chunk* nc = chunk_create(max);
+  for (int i=0; i<c->max; ++i) {
+    struct c8obj* item = c->item[i];
+    nc->item[i] = item ? c8obj_ref(item) : 0;
+  }
+  return nc;
+}
+
+static struct items* items_create()
+{
+  struct items* t = malloc(sizeof(struct items));
+  assert(t);
+  t->refs = 1;
+  c8vec_init(&t->chunks);
+  t->head = 0;
+  t->size = 0;
+  return t;
+}
+
+static void items_unref(struct items* t)
+{
+  assert(t->refs > 0);
+  if (--t->refs > 0) return;
+  int n = c8vec_size(&t->chunks);
+  for (int i=0; i<n; ++i) chunk_unref(c8vec_at(&t->chunks, i));
+  c8vec_clear(&t->chunks);
+  free(t);
+}
+
+static struct chunk* items_chunk(const struct items* t, int k)
+{
+  return (struct chunk*)c8vec_const_at(&t->chunks, k);
+}
+
+/* Take a private directory of chunks before modifying the list
+ */
+static struct items* c8list_own(struct c8list* oo)
+{
+  struct items* t = oo->items;
+  if (t->refs > 1) {
+    struct items* nt = items_create();
+    int n = c8vec_size(&t->chunks);
+    c8vec_reserve(&nt->chunks, n);
+    for (int i=0; i<n; ++i) {
+      struct chunk* c = items_chunk(t, i);
+      ++c->refs;
+      c8vec_push_back(&nt->chunks, c);
+    }
+    nt->head = t->head;
+    nt->size = t->size;
+    items_unref(t);
+    oo->items = t = nt;
+  }
+  return t;
+}
+
+/* Take a private chunk k, with room for at least max items, before
+ * modifying it
+ */
+static struct chunk* c8list_own_chunk(struct items* t, int k, int max)
+{
+  struct chunk** s = (struct chunk**)c8vec_slot(&t->chunks, k);
+  if ((*s)->refs > 1 || (*s)->max < max) {
+    struct chunk* c = chunk_copy(*s, max > (*s)->max ? max : (*s)->max);
+    chunk_unref(*s);
+    *s = c;
+  }
+  return *s;
+}
+
+// Slot holding item i, which must exist
+static struct c8obj** items_slot(const struct items* t, int i)
+{
+  if (i<0) i = t->size + i;
+  assert(i>=0 && i<t->size);
+  int pos = t->head + i;
+  return &items_chunk(t, pos / C8LIST_CHUNK)->item[pos % C8LIST_CHUNK];
+}
+
 static void c8list_destroy(struct c8obj* o)
 {
   struct c8list* oo = to_c8list(o);
   assert(oo);
-  int size = c8vec_size(&oo->vec);
-  for (int i=0; i<size; ++i) {
-    struct c8obj* item = (struct c8obj*)c8vec_at(&oo->vec, i);
-    c8obj_unref(item);
-  }
-  c8vec_clear(&oo->vec);
-  free(oo);
+  items_unref(oo->items);
+  c8heap_free(oo);
 }
 
 static struct c8obj* c8list_copy(const struct c8obj* o)
 {
   const struct c8list* oo = to_const_c8list(o);
   assert(oo);
-  return 0;
+  // Share the items, which are shared rather than copied
+  struct c8list* lc = c8list_create();
+  items_unref(lc->items);
+  lc->items = oo->items;
+  ++lc->items->refs;
+  return (struct c8obj*)lc;
 }
 
 static int c8list_int(const struct c8obj* o)
 {
   const struct c8list* oo = to_const_c8list(o);
   assert(oo);
-  return c8vec_size(&oo->vec);
+  return oo->items->size;
 }
 
 static void c8list_str(const struct c8obj* o, struct c8buf* buf, int f)
@@ -65,11 +197,10 @@ static void c8list_str(const struct c8obj* o, struct c8buf* buf, int f)
   const struct c8list* oo = to_const_c8list(o);
   assert(oo);
   c8buf_append_str(buf, "[");
-  int size = c8vec_size(&oo->vec);
+  int size = oo->items->size;
   for (int i=0; i<size; ++i) {
     if (i!=0) c8buf_append_str(buf, ",");
-    const struct c8obj* item =
-      (const struct c8obj*)c8vec_const_at(&oo->vec, i);
+    const struct c8obj* item = *items_slot(oo->items, i);
     if (item) c8obj_str(item, buf, f);
   }
   c8buf_append_str(buf, "]");
@@ -79,15 +210,63 @@ static struct c8obj* c8list_op(struct c8obj* o, int op, struct c8obj* p)
 {
   struct c8list* oo = to_c8list(o);
   assert(oo);
+
+  if (op == C8_OP_LOOKUP && p) {
+    struct c8buf nb; c8buf_init(&nb); c8obj_str(p, &nb, 0);
+    const char* name = c8buf_str(&nb);
+    struct c8func* fn = 0;
+    if (strcmp("size", name)==0) fn = c8func_create_method(c8list_length, o);
+    if (strcmp("push", name)==0) fn = c8func_create_method(c8list_push, o);
+    if (strcmp("pop", name)==0) fn = c8func_create_method(c8list_pop, o);
+    if (strcmp("unshift", name)==0) fn = c8func_create_method(c8list_unshift, o);
+    if (strcmp("shift", name)==0) fn = c8func_create_method(c8list_shift, o);
+    c8buf_clear(&nb);
+    return (struct c8obj*)fn;
+  }
   return 0;
 }
 
+static void c8list_traverse(struct c8obj* o, c8obj_visit_func visit, void* arg)
+{
+  struct c8list* oo = to_c8list(o);
+  assert(oo);
+  // Shared chunks are held by each sharer, so aren't attributed to any one
+  // of them. This keeps whatever they reference alive until unshared.
+  const struct items* t = oo->items;
+  if (t->refs > 1) return;
+  int n = c8vec_size(&t->chunks);
+  for (int k=0; k<n; ++k) {
+    struct chunk* c = items_chunk(t, k);
+    if (c->refs > 1) continue;
+    for (int i=0; i<c->max; ++i) {
+      if (c->item[i]) visit(&c->item[i], arg);
+    }
+  }
+}
+
+static void c8list_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8list* oo = to_const_c8list(o);
+  assert(oo);
+  const struct items* t = oo->items;
+  int bytes = sizeof(struct items) + t->chunks.max * sizeof(void*);
+  int n = c8vec_size(&t->chunks);
+  for (int k=0; k<n; ++k) {
+    const struct chunk* c = items_chunk(t, k);
+    bytes += (sizeof(struct chunk) + c->max * sizeof(void*)) / c->refs;
+  }
+  st->bytes = sizeof(struct c8list) + bytes / t->refs;
+}
+
 static const struct c8obj_imp c8list_imp = {
   c8list_destroy,
   c8list_copy,
   c8list_int,
   c8list_str,
-  c8list_op
+  c8list_op,
+  c8list_traverse,
+  c8list_stat,
+  "list"
 };
 
 const struct c8list* to_const_c8list(const struct c8obj* o)
@@ -103,38 +282,73 @@ struct c8list* to_c8list(struct c8obj* o)
 
 struct c8list* c8list_create()
 {
-  struct c8list* oo = malloc(sizeof(struct c8list));
+  struct c8list* oo = c8heap_alloc(sizeof(struct c8list));
   assert(oo);
   c8obj_init(&oo->base, &c8list_imp);
-  c8vec_init(&oo->vec);
+  oo->items = items_create();
   return oo;
 }
 
 int c8list_size(const struct c8list* oo)
 {
   assert(oo);
-  return c8vec_size(&oo->vec);
+  return oo->items->size;
 }
 
 struct c8obj* c8list_at(struct c8list* oo, int i)
 {
-  assert(oo);
-  struct c8obj* r = (struct c8obj*)c8vec_at(&oo->vec, i);
+  struct c8obj* r = c8list_peek(oo, i);
   if (r) return c8obj_ref(r);
   return 0;
 }
 
+struct c8obj* c8list_peek(const struct c8list* oo, int i)
+{
+  assert(oo);
+  return *items_slot(oo->items, i);
+}
+
 void c8list_push_back(struct c8list* oo, struct c8obj* p)
 {
   assert(oo);
   if (p) c8obj_ref(p);
-  c8vec_push_back(&oo->vec, p);
+  struct items* t = c8list_own(oo);
+  int pos = t->head + t->size;
+  int k = pos / C8LIST_CHUNK;
+  if (k == c8vec_size(&t->chunks)) {
+    // Start a further chunk, or the first one small
+    int max = k ? C8LIST_CHUNK : C8LIST_CHUNK_MIN;
+    c8vec_push_back(&t->chunks, chunk_create(max));
+  }
+  struct chunk* c = items_chunk(t, k);
+  int slot = pos % C8LIST_CHUNK;
+  if (slot >= c->max) {
+    // Grow a small sole chunk
+    int max = c->max * 2;
+    c = c8list_own_chunk(t, k, max < C8LIST_CHUNK ? max : C8LIST_CHUNK);
+  } else {
+    c = c8list_own_chunk(t, k, 0);
+  }
+  c->item[slot] = p;
+  ++t->size;
 }
 
 void c8list_pop_back(struct c8list* oo)
 {
   assert(oo);
-  struct c8obj* p = (struct c8obj*)c8vec_pop_back(&oo->vec);
+  struct items* t = c8list_own(oo);
+  assert(t->size > 0);
+  int pos = t->head + t->size - 1;
+  int k = pos / C8LIST_CHUNK;
+  struct chunk* c = c8list_own_chunk(t, k, 0);
+  struct c8obj* p = c->item[pos % C8LIST_CHUNK];
+  c->item[pos % C8LIST_CHUNK] = 0;
+  --t->size;
+  if (t->size == 0 || pos % C8LIST_CHUNK == 0) {
+    // Release the emptied chunk
+    chunk_unref(c8vec_pop_back(&t->chunks));
+    if (t->size == 0) t->head = 0;
+  }
   c8obj_unref(p);
 }
 
@@ -142,12 +356,113 @@ void c8list_push_front(struct c8list* oo, struct c8obj* p)
 {
   assert(oo);
   if (p) c8obj_ref(p);
-  c8vec_push_front(&oo->vec, p);
+  struct items* t = c8list_own(oo);
+  if (c8vec_size(&t->chunks) == 0) {
+    c8vec_push_back(&t->chunks, chunk_create(C8LIST_CHUNK_MIN));
+  }
+  struct chunk* c = items_chunk(t, 0);
+  if (c->max < C8LIST_CHUNK) {
+    // A small sole chunk starts at 0, so move its items up
+    assert(t->head == 0);
+    int max = t->size < c->max ? c->max : c->max * 2;
+    c = c8list_own_chunk(t, 0, max);
+    memmove(&c->item[1], &c->item[0], t->size * sizeof(void*));
+  } else if (t->head == 0) {
+    c = chunk_create(C8LIST_CHUNK);
+    c8vec_push_front(&t->chunks, c);
+    t->head = C8LIST_CHUNK - 1;
+  } else {
+    c = c8list_own_chunk(t, 0, 0);
+    --t->head;
+  }
+  c->item[t->head] = p;
+  ++t->size;
 }
 
 void c8list_pop_front(struct c8list* oo)
 {
   assert(oo);
-  struct c8obj* p = (struct c8obj*)c8vec_pop_front(&oo->vec);
+  struct items* t = c8list_own(oo);
+  assert(t->size > 0);
+  struct chunk* c = c8list_own_chunk(t, 0, 0);
+  struct c8obj* p = c->item[t->head];
+  --t->size;
+  if (c->max < C8LIST_CHUNK) {
+    // Keep a small sole chunk starting at 0
+    memmove(&c->item[0], &c->item[1], t->size * sizeof(void*));
+    c->item[t->size] = 0;
+  } else {
+    c->item[t->head++] = 0;
+  }
+  if (t->size == 0 || t->head == C8LIST_CHUNK) {
+    // Release the emptied chunk
+    chunk_unref(c8vec_pop_front(&t->chunks));
+    t->head = 0;
+  }
   c8obj_unref(p);
 }
+
+// Add an item as list initializers do, taking it like a variable's value
+static void c8list_push_take(struct c8list* oo, struct c8obj* p, int front)
+{
+  struct c8obj* pt = p ? c8obj_take(c8obj_ref(p)) : 0;
+  if (front) c8list_push_front(oo, pt);
+  else c8list_push_back(oo, pt);
+  c8obj_unref(pt);
+}
+
+struct c8obj* c8list_length(struct c8list* args)
+{
+  if (c8list_size(args) != 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8list* l = to_c8list(c8list_peek(args, 0));
+  if (!l)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  return (struct c8obj*)c8mpz_create_int(c8list_size(l));
+}
+
+struct c8obj* c8list_push(struct c8list* args)
+{
+  int n = c8list_size(args);
+  struct c8list* l = n ? to_c8list(c8list_peek(args, 0)) : 0;
+  if (!l)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  // Later changes to the arguments don't show in the list
+  for (int i=1; i<n; ++i) c8list_push_take(l, c8list_peek(args, i), 0);
+  return (struct c8obj*)c8mpz_create_int(c8list_size(l));
+}
+
+struct c8obj* c8list_pop(struct c8list* args)
+{
+  if (c8list_size(args) != 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8list* l = to_c8list(c8list_peek(args, 0));
+  if (!l || c8list_size(l) == 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* r = c8list_at(l, -1);
+  c8list_pop_back(l);
+  return r;
+}
+
+struct c8obj* c8list_unshift(struct c8list* args)
+{
+  int n = c8list_size(args);
+  struct c8list* l = n ? to_c8list(c8list_peek(args, 0)) : 0;
+  if (!l)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  // Keep the arguments in order at the front
+  for (int i=n-1; i>=1; --i) c8list_push_take(l, c8list_peek(args, i), 1);
+  return (struct c8obj*)c8mpz_create_int(c8list_size(l));
+}
+
+struct c8obj* c8list_shift(struct c8list* args)
+{
+  if (c8list_size(args) != 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8list* l = to_c8list(c8list_peek(args, 0));
+  if (!l || c8list_size(l) == 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* r = c8list_at(l, 0);
+  c8list_pop_front(l);
+  return r;
+}
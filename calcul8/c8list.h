@@ -35,6 +35,12 @@ struct c8list* c8list_create();
 int c8list_size(const struct c8list* oo);
 struct c8obj* c8list_at(struct c8list* oo, int i);
 
+/** Borrowed access
+ * Doesn't add a reference, so the item is only valid while it remains in
+ * the list.
+ */
+struct c8obj* c8list_peek(const struct c8list* oo, int i);
+
 /** Stack-like access
  */
 void c8list_push_back(struct c8list* oo, struct c8obj* p);
@@ -42,3 +48,14 @@ void c8list_pop_back(struct c8list* oo);
 
 void c8list_push_front(struct c8list* oo, struct c8obj* p);
 void c8list_pop_front(struct c8list* oo);
+
+/** Functions
+ * Methods for adding and removing items at the back (push, pop) and front
+ * (unshift, shift) of a list. Items are added as list initializers add
+ * them, see c8obj_take.
+ */
+struct c8obj* c8list_length(struct c8list* args);
+struct c8obj* c8list_push(struct c8list* args);
+struct c8obj* c8list_pop(struct c8list* args);
+struct c8obj* c8list_unshift(struct c8list* args);
+struct c8obj* c8list_shift(struct c8list* args);
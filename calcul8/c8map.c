@@ -21,53 +21,376 @@
 #include "c8map.h"
 #include "c8obj.h"
 #include "c8objimp.h"
-#include "c8vec.h"
 #include "c8list.h"
 #include "c8string.h"
+#include "c8mpz.h"
+#include "c8bool.h"
 #include "c8buf.h"
+#include "c8heap.h"
+#include "c8ops.h"
+#include "c8func.h"
+#include "c8error.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+/* Entries are kept in insertion order in a compact array, and located via
+ * an open-addressed (linear probing) index of entry positions.
+ * Keys are private copies, so they can't be changed once inserted.
+ */
 struct entry {
-  struct c8buf key;
+  struct c8obj* key;
   struct c8obj* value;
+  unsigned int hash;
+};
+
+// Entries per chunk and index slots per page, and the smallest chunk
+// allocated for a small map
+#define C8MAP_CHUNK 32
+#define C8MAP_PAGE 256
+#define C8MAP_CHUNK_MIN 4
+
+/* Entries are held in chunks and the index in pages, which are shared
+ * between copies of a map along with the table directing to them.
+ * Modifying a map sharing them copies the table and just the chunk and
+ * page being changed, so the first change after a copy costs O(n/C8MAP_CHUNK)
+ * rather than O(n).
+ *
+ * A map with a single chunk may have a smaller one, which grows as needed.
+ * Unused entries have a null key.
+ */
+struct chunk {
+  int refs;
+  int max;
+  struct entry e[];
+};
+
+struct page {
+  int refs;
+  int slot[];
+};
+
+struct table {
+  int refs;
+  struct chunk** chunks;
+  int nchunks;
+  int maxchunks;
+  int size;
+  struct page** pages;
+  int slots;
 };
 
+#define ENTRY(t, i) (&(t)->chunks[(i) / C8MAP_CHUNK]->e[(i) % C8MAP_CHUNK])
+#define SLOT(t, s) ((t)->pages[(s) / C8MAP_PAGE]->slot[(s) % C8MAP_PAGE])
+
 struct c8map {
   struct c8obj base;
-  struct c8vec vec;
+  struct table* t;
+};
+
+#define C8MAP_EMPTY -1
+
+static int key_equal_strn(const struct c8obj* a, const char* str, int len)
+{
+  const struct c8string* as = to_const_c8string(a);
+  return as && c8string_len(as) == len &&
+    memcmp(c8string_chars(as), str, len) == 0;
+}
+
+/* Keys are equal when their string forms are, and are stored as interned
+ * strings. Strings, booleans and integers which fit in a long are looked up
+ * by their string form without creating an object.
+ */
+struct keyform {
+  const char* str;
+  int len;
+  unsigned int hash;
+  char small[24];
+  struct c8buf buf;
 };
 
+static void keyform_init(struct keyform* kf, const struct c8obj* key)
+{
+  c8buf_init(&kf->buf);
+  const struct c8string* ks = to_const_c8string(key);
+  if (ks) {
+    kf->str = c8string_chars(ks);
+    kf->len = c8string_len(ks);
+    kf->hash = c8string_hash(ks);
+    return;
+  }
+  const struct c8bool* kb = to_const_c8bool(key);
+  const struct c8mpz* kz = to_const_c8mpz(key);
+  if (kb) {
+    kf->str = c8bool_value(kb) ? "true" : "false";
+    kf->len = strlen(kf->str);
+  } else if (kz && mpz_fits_slong_p(c8mpz_value(kz))) {
+    kf->len = snprintf(kf->small, sizeof(kf->small), "%ld",
+                       mpz_get_si(c8mpz_value(kz)));
+    kf->str = kf->small;
+  } else {
+    c8obj_str(key, &kf->buf, 0);
+    kf->len = c8buf_len(&kf->buf);
+    kf->str = kf->len ? c8buf_str(&kf->buf) : "";
+  }
+  kf->hash = hash_strn(kf->str, kf->len);
+}
+
+static void keyform_clear(struct keyform* kf)
+{
+  c8buf_clear(&kf->buf);
+}
+
+/* Make a private key from a key object
+ * String keys are interned, so comparing them with interned strings when
+ * looking up is a pointer comparison.
+ */
+static struct c8obj* key_create(const struct c8obj* key,
+                                const struct keyform* kf)
+{
+  const struct c8string* ks = to_const_c8string(key);
+  if (ks && c8string_interned(ks)) return c8obj_copy(key);
+  return (struct c8obj*)c8string_create_interned(kf->str, kf->len);
+}
+
+static struct chunk* chunk_create(int max)
+{
+  struct chunk* c =
+    calloc(1, sizeof(struct chunk) + max * sizeof(struct entry));
+  assert(c);
+  c->refs = 1;
+  c->max = max;
+  return c;
+}
+
+static void chunk_unref(struct chunk* c)
+{
+  assert(c->refs > 0);
+  if (--c->refs > 0) return;
+  for (int i=0; i<c->max; ++i) {
+    c8obj_unref(c->e[i].key);
+    c8obj_unref(c->e[i].value);
+  }
+  free(c);
+}
+
+static struct page* page_create(int n)
+{
+  struct page* g = malloc(sizeof(struct page) + n * sizeof(int));
+  assert(g);
+  g->refs = 1;
+  for (int s=0; s<n; ++s) g->slot[s] = C8MAP_EMPTY;
+  return g;
+}
+
+static void page_unref(struct page* g)
+{
+  assert(g->refs > 0);
+  if (--g->refs == 0) free(g);
+}
+
+static int table_npages(const struct table* t)
+{
+  return (t->slots + C8MAP_PAGE - 1) / C8MAP_PAGE;
+}
+
+static struct table* table_create()
+{
+  struct table* t = malloc(sizeof(struct table));
+  assert(t);
+  t->refs = 1;
+  t->chunks = 0;
+  t->nchunks = 0;
+  t->maxchunks = 0;
+  t->size = 0;
+  t->pages = 0;
+  t->slots = 0;
+  return t;
+}
+
+static void table_unref(struct table* t)
+{
+  assert(t->refs > 0);
+  if (--t->refs > 0) return;
+  for (int k=0; k<t->nchunks; ++k) chunk_unref(t->chunks[k]);
+  for (int k=0; k<table_npages(t); ++k) page_unref(t->pages[k]);
+  free(t->chunks);
+  free(t->pages);
+  free(t);
+}
+
+// Copy of a table sharing its chunks and pages
+static struct table* table_clone(const struct table* t)
+{
+  struct table* tc = table_create();
+  if (t->size == 0) return tc;
+  tc->maxchunks = t->nchunks;
+  tc->chunks = malloc(tc->maxchunks * sizeof(struct chunk*));
+  assert(tc->chunks);
+  for (int k=0; k<t->nchunks; ++k) {
+    tc->chunks[k] = t->chunks[k];
+    ++tc->chunks[k]->refs;
+  }
+  tc->nchunks = t->nchunks;
+  tc->size = t->size;
+  int npages = table_npages(t);
+  tc->pages = malloc(npages * sizeof(struct page*));
+  assert(tc->pages);
+  for (int k=0; k<npages; ++k) {
+    tc->pages[k] = t->pages[k];
+    ++tc->pages[k]->refs;
+  }
+  tc->slots = t->slots;
+  return tc;
+}
+
+/* Take a private chunk k, with room for at least max entries, before
+ * modifying it
+ */
+static struct chunk* table_own_chunk(struct table* t, int k, int max)
+{
+  struct chunk* c = t->chunks[k];
+  if (c->refs == 1 && c->max >= max) return c;
+  if (max < c->max) max = c->max;
+  struct chunk* nc = chunk_create(max);
+  for (int i=0; i<c->max; ++i) {
+    const struct entry* e = &c->e[i];
+    if (!e->key) continue;
+    nc->e[i].key = c8obj_ref(e->key);
+    nc->e[i].value = e->value ? c8obj_ref(e->value) : 0;
+    nc->e[i].hash = e->hash;
+  }
+  chunk_unref(c);
+  return t->chunks[k] = nc;
+}
+
+/* Take a private page k before modifying it
+ */
+static struct page* table_own_page(struct table* t, int k)
+{
+  struct page* g = t->pages[k];
+  if (g->refs == 1) return g;
+  int n = t->slots < C8MAP_PAGE ? t->slots : C8MAP_PAGE;
+  struct page* ng = malloc(sizeof(struct page) + n * sizeof(int));
+  assert(ng);
+  ng->refs = 1;
+  memcpy(ng->slot, g->slot, n * sizeof(int));
+  page_unref(g);
+  return t->pages[k] = ng;
+}
+
+static void table_reindex(struct table* t, int slots)
+{
+  for (int k=0; k<table_npages(t); ++k) page_unref(t->pages[k]);
+  free(t->pages);
+  t->slots = slots;
+  int npages = table_npages(t);
+  t->pages = malloc(npages * sizeof(struct page*));
+  assert(t->pages);
+  for (int k=0; k<npages; ++k) {
+    t->pages[k] = page_create(slots < C8MAP_PAGE ? slots : C8MAP_PAGE);
+  }
+  for (int i=0; i<t->size; ++i) {
+    int s = ENTRY(t, i)->hash & (slots - 1);
+    while (SLOT(t, s) != C8MAP_EMPTY) s = (s + 1) & (slots - 1);
+    SLOT(t, s) = i;
+  }
+}
+
+/* Find the index slot for a key with the given hash, which is either the
+ * slot referring to the matching entry or the empty slot ending the probe.
+ */
+#define C8MAP_PROBE(t, hash, match)                       \
+  int s = (hash) & ((t)->slots - 1);                      \
+  for (; SLOT(t, s) != C8MAP_EMPTY;                       \
+       s = (s + 1) & ((t)->slots - 1)) {                  \
+    const struct entry* e = ENTRY(t, SLOT(t, s));         \
+    if (e->hash == (hash) && (match)) break;              \
+  }
+
+static int table_find_strn(const struct table* t, const char* str,
+                           int len, unsigned int hash)
+{
+  if (!t->slots) return C8MAP_EMPTY;
+  C8MAP_PROBE(t, hash, key_equal_strn(e->key, str, len));
+  return s;
+}
+
+static void table_set_slot(struct table* t, int s, unsigned int hash,
+                           struct c8obj* key, struct c8obj* value)
+{
+  if (s != C8MAP_EMPTY && SLOT(t, s) != C8MAP_EMPTY) {
+    // Replace existing value
+    int i = SLOT(t, s);
+    struct chunk* c = table_own_chunk(t, i / C8MAP_CHUNK, 0);
+    struct entry* e = &c->e[i % C8MAP_CHUNK];
+    assert(!key);
+    if (value) c8obj_ref(value);
+    c8obj_unref(e->value);
+    e->value = value;
+    return;
+  }
+
+  // Add a new entry, keeping the index at most half full
+  int i = t->size;
+  int k = i / C8MAP_CHUNK;
+  if (k == t->nchunks) {
+    if (t->nchunks == t->maxchunks) {
+      t->maxchunks = t->maxchunks ? t->maxchunks * 2 : 1;
+      t->chunks = realloc(t->chunks, t->maxchunks * sizeof(struct chunk*));
+      assert(t->chunks);
+    }
+    // Start a further chunk, or the first one small
+    t->chunks[t->nchunks++] = chunk_create(k ? C8MAP_CHUNK : C8MAP_CHUNK_MIN);
+  }
+  int max = t->chunks[k]->max;
+  if (i % C8MAP_CHUNK == max) {
+    // Grow a small sole chunk
+    max *= 2;
+  }
+  struct entry* e = &table_own_chunk(t, k, max)->e[i % C8MAP_CHUNK];
+  e->key = key;
+  e->value = value ? c8obj_ref(value) : 0;
+  e->hash = hash;
+  ++t->size;
+  if (t->size * 2 > t->slots) {
+    table_reindex(t, t->slots ? t->slots * 2 : 8);
+  } else {
+    table_own_page(t, s / C8MAP_PAGE)->slot[s % C8MAP_PAGE] = i;
+  }
+}
+
+/* Take a private table before modifying the map
+ */
+static struct table* c8map_own(struct c8map* oo)
+{
+  if (oo->t->refs > 1) {
+    struct table* t = table_clone(oo->t);
+    table_unref(oo->t);
+    oo->t = t;
+  }
+  return oo->t;
+}
+
 static void c8map_destroy(struct c8obj* o)
 {
   struct c8map* oo = to_c8map(o);
   assert(oo);
-  int size = c8vec_size(&oo->vec);
-  for (int i=0; i<size; ++i) {
-    struct entry* e = (struct entry*)c8vec_at(&oo->vec, i);
-    c8buf_clear(&e->key);
-    c8obj_unref(e->value);
-    free(e);
-  }
-  c8vec_clear(&oo->vec);
-  free(oo);
+  table_unref(oo->t);
+  c8heap_free(oo);
 }
 
 static struct c8obj* c8map_copy(const struct c8obj* o)
 {
   const struct c8map* oo = to_const_c8map(o);
   assert(oo);
+  // Share the table, values are shared rather than copied
   struct c8map* mc = c8map_create();
-  int size = c8vec_size(&oo->vec);
-  for (int i=0; i<size; ++i) {
-    const struct entry* e = (const struct entry*)c8vec_const_at(&oo->vec, i);
-    struct c8obj* vc = e->value ? c8obj_copy(e->value) : 0;
-    c8map_set(mc, c8buf_str(&e->key), vc);
-    c8obj_unref(vc);
-  }
+  table_unref(mc->t);
+  mc->t = oo->t;
+  ++mc->t->refs;
   return (struct c8obj*)mc;
 }
 
@@ -75,7 +398,7 @@ static int c8map_int(const struct c8obj* o)
 {
   const struct c8map* oo = to_const_c8map(o);
   assert(oo);
-  return c8vec_size(&oo->vec);
+  return oo->t->size;
 }
 
 static void c8map_str(const struct c8obj* o, struct c8buf* buf, int f)
@@ -83,11 +406,10 @@ static void c8map_str(const struct c8obj* o, struct c8buf* buf, int f)
   const struct c8map* oo = to_const_c8map(o);
   assert(oo);
   c8buf_append_str(buf, "{");
-  int size = c8vec_size(&oo->vec);
-  for (int i=0; i<size; ++i) {
+  for (int i=0; i<oo->t->size; ++i) {
     if (i!=0) c8buf_append_str(buf, ",");
-    const struct entry* e = (const struct entry*)c8vec_const_at(&oo->vec, i);
-    c8buf_append_buf(buf, &e->key);
+    const struct entry* e = ENTRY(oo->t, i);
+    c8obj_str(e->key, buf, f);
     c8buf_append_str(buf, ":");
     if (e->value) c8obj_str(e->value, buf, f);
   }
@@ -98,16 +420,64 @@ static struct c8obj* c8map_op(struct c8obj* o, int op, struct c8obj* p)
 {
   struct c8map* oo = to_c8map(o);
   assert(oo);
-  //assert(p);
+
+  if (op == C8_OP_LOOKUP && p) {
+    struct c8buf nb; c8buf_init(&nb); c8obj_str(p, &nb, 0);
+    const char* name = c8buf_str(&nb);
+    struct c8func* fn = 0;
+    if (strcmp("size", name)==0) fn = c8func_create_method(c8map_length, o);
+    if (strcmp("get", name)==0) fn = c8func_create_method(c8map_get, o);
+    c8buf_clear(&nb);
+    return (struct c8obj*)fn;
+  }
   return 0;
 }
 
+static void c8map_traverse(struct c8obj* o, c8obj_visit_func visit, void* arg)
+{
+  struct c8map* oo = to_c8map(o);
+  assert(oo);
+  // As with lists, shared chunks aren't attributed to any one sharer. Keys
+  // are always strings, so only values are visited.
+  const struct table* t = oo->t;
+  if (t->refs > 1) return;
+  for (int k=0; k<t->nchunks; ++k) {
+    struct chunk* c = t->chunks[k];
+    if (c->refs > 1) continue;
+    for (int i=0; i<c->max; ++i) {
+      if (c->e[i].value) visit(&c->e[i].value, arg);
+    }
+  }
+}
+
+static void c8map_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8map* oo = to_const_c8map(o);
+  assert(oo);
+  const struct table* t = oo->t;
+  int bytes = sizeof(struct table) + t->maxchunks * sizeof(struct chunk*) +
+    table_npages(t) * sizeof(struct page*);
+  for (int k=0; k<t->nchunks; ++k) {
+    const struct chunk* c = t->chunks[k];
+    bytes += (sizeof(struct chunk) + c->max * sizeof(struct entry)) / c->refs;
+  }
+  int n = t->slots < C8MAP_PAGE ? t->slots : C8MAP_PAGE;
+  for (int k=0; k<table_npages(t); ++k) {
+    const struct page* g = t->pages[k];
+    bytes += (sizeof(struct page) + n * sizeof(int)) / g->refs;
+  }
+  st->bytes = sizeof(struct c8map) + bytes / t->refs;
+}
+
 static const struct c8obj_imp c8map_imp = {
   c8map_destroy,
   c8map_copy,
   c8map_int,
   c8map_str,
-  c8map_op
+  c8map_op,
+  c8map_traverse,
+  c8map_stat,
+  "map"
 };
 
 const struct c8map* to_const_c8map(const struct c8obj* o)
@@ -123,28 +493,26 @@ struct c8map* to_c8map(struct c8obj* o)
 
 struct c8map* c8map_create()
 {
-  struct c8map* oo = malloc(sizeof(struct c8map));
+  struct c8map* oo = c8heap_alloc(sizeof(struct c8map));
   assert(oo);
   c8obj_init(&oo->base, &c8map_imp);
-  c8vec_init(&oo->vec);
+  oo->t = table_create();
   return oo;
 }
 
 int c8map_size(const struct c8map* oo)
 {
   assert(oo);
-  return c8vec_size(&oo->vec);
+  return oo->t->size;
 }
 
-
 struct c8obj* c8map_at(struct c8map* oo, int i, struct c8buf* key)
 {
   assert(oo);
-  struct entry* e = (struct entry*)c8vec_at(&oo->vec, i);
-  if (e) {
-    if (key) c8buf_append_buf(key, &e->key);
-    if (e->value) return c8obj_ref(e->value);
-  }
+  assert(i>=0 && i<oo->t->size);
+  const struct entry* e = ENTRY(oo->t, i);
+  if (key) c8obj_str(e->key, key, 0);
+  if (e->value) return c8obj_ref(e->value);
   return 0;
 }
 
@@ -152,45 +520,101 @@ struct c8list* c8map_keys(const struct c8map* oo)
 {
   assert(oo);
   struct c8list* kl = c8list_create();
-  int size = c8vec_size(&oo->vec);
-  for (int i=0; i<size; ++i) {
-    const struct entry* e = (const struct entry*)c8vec_const_at(&oo->vec, i);
-    struct c8obj* k = (struct c8obj*)c8string_create_buf(&e->key);
+  for (int i=0; i<oo->t->size; ++i) {
+    struct c8obj* k = c8obj_copy(ENTRY(oo->t, i)->key);
     c8list_push_back(kl, k);
     c8obj_unref(k);
-  }  
+  }
   return kl;
 }
 
 struct c8obj* c8map_lookup(struct c8map* oo, const char* key)
+{
+  struct c8obj* value = c8map_peek(oo, key);
+  return value ? c8obj_ref(value) : 0;
+}
+
+struct c8obj* c8map_lookup_obj(struct c8map* oo, const struct c8obj* key)
+{
+  struct c8obj* value = c8map_peek_obj(oo, key);
+  return value ? c8obj_ref(value) : 0;
+}
+
+struct c8obj* c8map_peek(const struct c8map* oo, const char* key)
 {
   assert(oo);
-  int size = c8vec_size(&oo->vec);
-  for (int i=0; i<size; ++i) {
-    struct entry* e = (struct entry*)c8vec_at(&oo->vec, i);
-    if (strcmp(c8buf_str(&e->key), key) == 0) {
-      if (e->value) return c8obj_ref(e->value);
-      return 0;
-    }
-  }
-  return 0;
+  assert(key);
+  int len = strlen(key);
+  const struct table* t = oo->t;
+  int s = table_find_strn(t, key, len, hash_strn(key, len));
+  if (s == C8MAP_EMPTY || SLOT(t, s) == C8MAP_EMPTY) return 0;
+  return ENTRY(t, SLOT(t, s))->value;
+}
+
+struct c8obj* c8map_peek_obj(const struct c8map* oo, const struct c8obj* key)
+{
+  assert(oo);
+  assert(key);
+  struct keyform kf;
+  keyform_init(&kf, key);
+  const struct table* t = oo->t;
+  int s = table_find_strn(t, kf.str, kf.len, kf.hash);
+  keyform_clear(&kf);
+  if (s == C8MAP_EMPTY || SLOT(t, s) == C8MAP_EMPTY) return 0;
+  return ENTRY(t, SLOT(t, s))->value;
 }
 
 void c8map_set(struct c8map* oo, const char* key, struct c8obj* value)
 {
   assert(oo);
-  int size = c8vec_size(&oo->vec);
-  for (int i=0; i<size; ++i) {
-    struct entry* e = (struct entry*)c8vec_at(&oo->vec, i);
-    if (strcmp(c8buf_str(&e->key), key) == 0) {
-      c8obj_unref(e->value);
-      e->value = value ? c8obj_ref(value) : 0;
-      return;
-    }
+  assert(key);
+  int len = strlen(key);
+  struct table* t = c8map_own(oo);
+  unsigned int hash = hash_strn(key, len);
+  int s = table_find_strn(t, key, len, hash);
+  struct c8obj* k = 0;
+  if (s == C8MAP_EMPTY || SLOT(t, s) == C8MAP_EMPTY) {
+    k = (struct c8obj*)c8string_create_interned(key, len);
   }
-  // Add a new entry
-  struct entry* e = (struct entry*)malloc(sizeof (struct entry));
-  c8buf_init_str(&e->key, key);
-  e->value = value ? c8obj_ref(value) : 0;
-  c8vec_push_back(&oo->vec, e);
+  table_set_slot(t, s, hash, k, value);
+}
+
+void c8map_set_obj(struct c8map* oo, const struct c8obj* key,
+                   struct c8obj* value)
+{
+  assert(oo);
+  assert(key);
+  struct keyform kf;
+  keyform_init(&kf, key);
+  struct table* t = c8map_own(oo);
+  int s = table_find_strn(t, kf.str, kf.len, kf.hash);
+  struct c8obj* k = 0;
+  if (s == C8MAP_EMPTY || SLOT(t, s) == C8MAP_EMPTY) {
+    k = key_create(key, &kf);
+  }
+  table_set_slot(t, s, kf.hash, k, value);
+  keyform_clear(&kf);
+}
+
+struct c8obj* c8map_length(struct c8list* args)
+{
+  if (c8list_size(args) != 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8map* m = to_c8map(c8list_peek(args, 0));
+  if (!m)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  return (struct c8obj*)c8mpz_create_int(c8map_size(m));
+}
+
+struct c8obj* c8map_get(struct c8list* args)
+{
+  if (c8list_size(args) != 2)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8map* m = to_c8map(c8list_peek(args, 0));
+  struct c8obj* key = c8list_peek(args, 1);
+  if (!m || !key)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  // A copy, so changing the result doesn't change the map
+  struct c8obj* v = c8map_peek_obj(m, key);
+  return v ? c8obj_copy(v) : 0;
 }
@@ -44,9 +44,28 @@ struct c8obj* c8map_at(struct c8map* oo, int i, struct c8buf* key);
 struct c8list* c8map_keys(const struct c8map* oo);
 
 /** Lookup by key
+ * Objects are keyed by their string representation, so keys are equal when
+ * their strings are.
  */
 struct c8obj* c8map_lookup(struct c8map* oo, const char* key);
+struct c8obj* c8map_lookup_obj(struct c8map* oo, const struct c8obj* key);
+
+/** Borrowed lookup by key
+ * Doesn't add a reference, so the value is only valid while it remains in
+ * the map.
+ */
+struct c8obj* c8map_peek(const struct c8map* oo, const char* key);
+struct c8obj* c8map_peek_obj(const struct c8map* oo, const struct c8obj* key);
 
 /** Set by key
  */
 void c8map_set(struct c8map* oo, const char* key, struct c8obj* value);
+void c8map_set_obj(struct c8map* oo, const struct c8obj* key,
+                   struct c8obj* value);
+
+/** Functions
+ * Methods giving the number of entries (size) and a copy of the value for a
+ * key (get).
+ */
+struct c8obj* c8map_length(struct c8list* args);
+struct c8obj* c8map_get(struct c8list* args);
@@ -0,0 +1,244 @@
+/** c8memo - memo caches for integer sequences
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8memo.h"
+#include "c8prod.h"
+
+#include <gmp.h>
+#include <assert.h>
+
+// Values held per sequence
+#define C8MEMO_ENTRIES 32
+
+// Values smaller than this are quick to compute and not worth holding
+#define C8MEMO_MIN_LIMBS 16
+
+// Default limit on limb bytes held
+#define C8MEMO_LIMIT (64 << 20)
+
+// A cached value is extended to n if it is within n / C8MEMO_REACH
+#define C8MEMO_REACH 4
+
+struct c8memo_entry {
+  unsigned long n;
+  mpz_t v[2];
+  unsigned long used; // Tick of last use
+};
+
+struct c8memo_seq {
+  struct c8memo_stats stats;
+  int nvals; // Values held per entry
+  int n;
+  struct c8memo_entry e[C8MEMO_ENTRIES];
+};
+
+// Fibonacci entries hold F(n) and F(n-1), factorial entries just n!
+static struct c8memo_seq c8memo_seqs[] = {
+  {{"fib", 0, 0, 0, 0, 0, 0}, 2, 0},
+  {{"factorial", 0, 0, 0, 0, 0, 0}, 1, 0},
+};
+#define C8MEMO_SEQS (int)(sizeof(c8memo_seqs) / sizeof(c8memo_seqs[0]))
+
+static struct c8memo_seq* const c8memo_fibs = &c8memo_seqs[0];
+static struct c8memo_seq* const c8memo_facs = &c8memo_seqs[1];
+
+static size_t c8memo_max = C8MEMO_LIMIT;
+static size_t c8memo_total = 0;
+static unsigned long c8memo_tick = 0;
+
+static size_t c8memo_entry_bytes(const struct c8memo_seq* s,
+                                 const struct c8memo_entry* e)
+{
+  size_t b = 0;
+  for (int i=0; i<s->nvals; ++i) b += e->v[i]->_mp_alloc * sizeof(mp_limb_t);
+  return b;
+}
+
+static void c8memo_remove(struct c8memo_seq* s, int i)
+{
+  struct c8memo_entry* e = &s->e[i];
+  size_t b = c8memo_entry_bytes(s, e);
+  s->stats.limb_bytes -= b;
+  c8memo_total -= b;
+  for (int j=0; j<s->nvals; ++j) mpz_clear(e->v[j]);
+  s->e[i] = s->e[--s->n];
+  --s->stats.entries;
+}
+
+// Drop least recently used entries until there are at most limit bytes
+static void c8memo_evict(size_t limit)
+{
+  while (c8memo_total > limit) {
+    struct c8memo_seq* ls = 0;
+    int li = 0;
+    for (int k=0; k<C8MEMO_SEQS; ++k) {
+      struct c8memo_seq* s = &c8memo_seqs[k];
+      for (int i=0; i<s->n; ++i) {
+        if (!ls || s->e[i].used < ls->e[li].used) {
+          ls = s;
+          li = i;
+        }
+      }
+    }
+    assert(ls);
+    c8memo_remove(ls, li);
+    ++ls->stats.evictions;
+  }
+}
+
+// The cached entry nearest to n, if it is within reach
+static struct c8memo_entry* c8memo_find(struct c8memo_seq* s, unsigned long n,
+                                        int below)
+{
+  struct c8memo_entry* best = 0;
+  unsigned long bd = n / C8MEMO_REACH;
+  for (int i=0; i<s->n; ++i) {
+    struct c8memo_entry* e = &s->e[i];
+    if (below && e->n > n) continue;
+    unsigned long d = e->n > n ? e->n - n : n - e->n;
+    if (d <= bd) {
+      best = e;
+      bd = d;
+    }
+  }
+  if (best) best->used = ++c8memo_tick;
+  return best;
+}
+
+static void c8memo_store(struct c8memo_seq* s, unsigned long n,
+                         mpz_srcptr a, mpz_srcptr b)
+{
+  if (mpz_size(a) < C8MEMO_MIN_LIMBS) return;
+  struct c8memo_entry* e = &s->e[s->n];
+  for (int j=0; j<s->nvals; ++j) mpz_init_set(e->v[j], j ? b : a);
+  size_t bytes = c8memo_entry_bytes(s, e);
+  if (bytes > c8memo_max / 2) {
+    // Would displace too much of everything else
+    for (int j=0; j<s->nvals; ++j) mpz_clear(e->v[j]);
+    return;
+  }
+  e->n = n;
+  e->used = ++c8memo_tick;
+  ++s->n;
+  ++s->stats.entries;
+  s->stats.limb_bytes += bytes;
+  c8memo_total += bytes;
+
+  if (s->n == C8MEMO_ENTRIES) {
+    // Make room for the next, dropping the least recently used
+    int li = 0;
+    for (int i=1; i<s->n; ++i) if (s->e[i].used < s->e[li].used) li = i;
+    c8memo_remove(s, li);
+    ++s->stats.evictions;
+  }
+  c8memo_evict(c8memo_max);
+}
+
+void c8memo_fib(mpz_ptr r, unsigned long n)
+{
+  struct c8memo_seq* s = c8memo_fibs;
+  mpz_t r1;
+  mpz_init(r1);
+  struct c8memo_entry* e = n ? c8memo_find(s, n, 1) : 0;
+  if (e && e->n == n) {
+    ++s->stats.hits;
+    mpz_set(r, e->v[0]);
+    mpz_clear(r1);
+    return;
+  }
+
+  if (e) {
+    // With m = n - k, F(n) = F(k)F(m+1) + F(k-1)F(m)
+    // and F(n-1) = F(k)F(m) + F(k-1)F(m-1)
+    ++s->stats.extends;
+    unsigned long m = n - e->n;
+    mpz_t f1, f0, t;
+    mpz_inits(f1, f0, t, NULL);
+    mpz_fib2_ui(f1, f0, m + 1);
+    mpz_mul(r, e->v[0], f1);
+    mpz_addmul(r, e->v[1], f0);
+    mpz_sub(t, f1, f0);
+    mpz_mul(r1, e->v[0], f0);
+    mpz_addmul(r1, e->v[1], t);
+    mpz_clears(f1, f0, t, NULL);
+  } else {
+    ++s->stats.misses;
+    if (n) mpz_fib2_ui(r, r1, n);
+    else mpz_set_ui(r, 0);
+  }
+  if (n) c8memo_store(s, n, r, r1);
+  mpz_clear(r1);
+}
+
+void c8memo_factorial(mpz_ptr r, unsigned long n)
+{
+  struct c8memo_seq* s = c8memo_facs;
+  struct c8memo_entry* e = c8memo_find(s, n, 0);
+  if (e && e->n == n) {
+    ++s->stats.hits;
+    mpz_set(r, e->v[0]);
+    return;
+  }
+
+  if (e) {
+    // Multiply up, or divide down, by the factors in between
+    ++s->stats.extends;
+    mpz_t t;
+    mpz_init(t);
+    if (e->n < n) {
+      c8prod_range(t, e->n + 1, n);
+      mpz_mul(r, e->v[0], t);
+    } else {
+      c8prod_range(t, n + 1, e->n);
+      mpz_divexact(r, e->v[0], t);
+    }
+    mpz_clear(t);
+  } else {
+    ++s->stats.misses;
+    c8prod_factorial(r, n);
+  }
+  c8memo_store(s, n, r, 0);
+}
+
+size_t c8memo_limit()
+{
+  return c8memo_max;
+}
+
+void c8memo_set_limit(size_t bytes)
+{
+  c8memo_max = bytes;
+  c8memo_evict(bytes);
+}
+
+int c8memo_stats(struct c8memo_stats* stats, int max)
+{
+  int n = 0;
+  for (; n<C8MEMO_SEQS && n<max; ++n) stats[n] = c8memo_seqs[n].stats;
+  return n;
+}
+
+void c8memo_clear()
+{
+  for (int k=0; k<C8MEMO_SEQS; ++k) {
+    struct c8memo_seq* s = &c8memo_seqs[k];
+    while (s->n) c8memo_remove(s, s->n - 1);
+  }
+}
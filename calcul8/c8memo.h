@@ -0,0 +1,59 @@
+/** c8memo - memo caches for integer sequences
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gmp.h>
+#include <stddef.h>
+
+/** Statistics for the cache of one sequence
+ */
+struct c8memo_stats {
+  const char* name;
+  long entries; // Values held
+  size_t limb_bytes; // Bytes of GMP limbs held
+  long hits; // Values found in the cache
+  long extends; // Values computed from a nearby cached value
+  long misses; // Values computed from scratch
+  long evictions; // Values dropped to keep within the limit
+};
+
+/** Fibonacci number F(n), using and updating the cache
+ */
+void c8memo_fib(mpz_ptr r, unsigned long n);
+
+/** Factorial n!, using and updating the cache
+ */
+void c8memo_factorial(mpz_ptr r, unsigned long n);
+
+/** Limit on the limb bytes held by all caches together, evicting the
+ * least recently used values to keep within it
+ */
+size_t c8memo_limit();
+void c8memo_set_limit(size_t bytes);
+
+/** Get statistics for each sequence
+ * Fills in up to max sequences and returns the number filled in.
+ */
+int c8memo_stats(struct c8memo_stats* stats, int max);
+
+/** Empty all caches
+ */
+void c8memo_clear();
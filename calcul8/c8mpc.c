@@ -20,6 +20,9 @@
 
 #include "c8mpc.h"
 #include "c8mpfr.h"
+#include "c8mpz.h"
+#include "c8mpq.h"
+#include "c8f64.h"
 #include "c8obj.h"
 #include "c8ops.h"
 #include "c8bool.h"
@@ -30,37 +33,106 @@
 #include "c8buf.h"
 #include "c8num.h"
 #include "c8numimp.h"
+#include "c8heap.h"
 
 #include <mpc.h>
 #include <mpfr.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <limits.h>
+
+// Value storage, shared between copies until one of them is modified.
+// Each object embeds storage for its own value. The real and imaginary
+// parts are allocated by MPC, which may swap or resize them internally.
+struct c8mpc_value {
+  int refs;
+  int embedded; // 1 if embedded in an object, -1 once that is destroyed
+  mpc_t value;
+};
 
 struct c8mpc {
   struct c8num base;
-  mpc_t value;
+  struct c8mpc_value* v;
+  struct c8mpc_value own;
 };
 
-static mpc_rnd_t rnd = MPC_RNDNN;
-static mpfr_rnd_t mpfr_rnd = MPFR_RNDN;
-static int dp = 0;
+// Rounding mode of the working context, for both parts
+#define C8MPC_RND MPC_RND(c8num_rnd(), c8num_rnd())
+#define C8MPC_MPFR_RND ((mpfr_rnd_t)c8num_rnd())
 
 struct c8mpc* c8mpc_create_mpc(const mpc_t value);
+static struct c8mpc* c8mpc_create_shared(const struct c8mpc* np);
+
+static void c8mpc_value_init(struct c8mpc_value* v, int embedded,
+                             mpfr_prec_t prec_re, mpfr_prec_t prec_im)
+{
+  v->refs = 1;
+  v->embedded = embedded;
+  mpc_init3(v->value, prec_re, prec_im);
+}
+
+static void c8mpc_value_unref(struct c8mpc_value* v)
+{
+  assert(v->refs > 0);
+  if (--v->refs) return;
+  mpc_clear(v->value);
+  if (v->embedded == 0) {
+    free(v);
+  } else if (v->embedded < 0) {
+    // Last user of a destroyed object's value, so free the object
+    c8heap_free((char*)v - offsetof(struct c8mpc, own));
+  }
+}
+
+// Make this object share the value of np
+static void c8mpc_share(struct c8mpc* oo, const struct c8mpc* np)
+{
+  ++np->v->refs;
+  c8mpc_value_unref(oo->v);
+  oo->v = np->v;
+}
+
+// Get the value for modification, copying it first if it is shared
+static mpc_ptr c8mpc_own(struct c8mpc* oo)
+{
+  struct c8mpc_value* v = oo->v;
+  if (v->refs > 1) {
+    struct c8mpc_value* nv = &oo->own;
+    mpfr_prec_t prec_re = mpfr_get_prec(mpc_realref(v->value));
+    mpfr_prec_t prec_im = mpfr_get_prec(mpc_imagref(v->value));
+    if (nv->refs == 0) {
+      c8mpc_value_init(nv, 1, prec_re, prec_im);
+    } else {
+      nv = malloc(sizeof(struct c8mpc_value));
+      assert(nv);
+      c8mpc_value_init(nv, 0, prec_re, prec_im);
+    }
+    mpc_set(nv->value, v->value, C8MPC_RND);
+    --v->refs;
+    oo->v = nv;
+  }
+  return oo->v->value;
+}
 
 static void c8mpc_destroy(struct c8obj* o)
 {
   struct c8mpc* oo = to_c8mpc(o);
   assert(oo);
-  mpc_clear(oo->value);
-  free(oo);
+  // If copies still share the embedded value, the last of them frees this
+  struct c8mpc_value* v = oo->v;
+  int unused = (v != &oo->own && oo->own.refs == 0);
+  oo->own.embedded = -1;
+  c8mpc_value_unref(v);
+  if (unused) c8heap_free(oo);
 }
 
 static struct c8obj* c8mpc_copy(const struct c8obj* o)
 {
   const struct c8mpc* oo = to_const_c8mpc(o);
   assert(oo);
-  return (struct c8obj*)c8mpc_create_mpc(oo->value);
+  return (struct c8obj*)c8mpc_create_shared(oo);
 }
 
 static int c8mpc_int(const struct c8obj* o)
@@ -68,8 +140,8 @@ static int c8mpc_int(const struct c8obj* o)
   const struct c8mpc* oo = to_const_c8mpc(o);
   assert(oo);
   mpfr_t a; mpfr_init(a);
-  mpc_abs(a, oo->value, mpfr_rnd);
-  int ret = (int)mpfr_get_si(a, mpfr_rnd);
+  mpc_abs(a, oo->v->value, C8MPC_MPFR_RND);
+  int ret = (int)mpfr_get_si(a, C8MPC_MPFR_RND);
   mpfr_clear(a);
   return ret;
 }
@@ -79,10 +151,11 @@ static void c8mpc_str(const struct c8obj* o, struct c8buf* buf, int f)
   const struct c8mpc* oo = to_const_c8mpc(o);
   assert(oo);
 
-  if (dp == 0) {
-    // Convert bit precision to decimal places
-    dp = (unsigned int)(53 * 0.301); // log(2)
-  }
+  // Convert bit precision to decimal places, enough for either part
+  mpfr_prec_t prec = mpfr_get_prec(mpc_realref(oo->v->value));
+  if (mpfr_get_prec(mpc_imagref(oo->v->value)) > prec)
+    prec = mpfr_get_prec(mpc_imagref(oo->v->value));
+  int dp = (int)(prec * 0.301); // log(2)
 
   int base = 10;
   char* cs = 0;
@@ -101,7 +174,7 @@ static void c8mpc_str(const struct c8obj* o, struct c8buf* buf, int f)
       break;
   }
 
-  cs = mpc_get_str(base, dp, oo->value, rnd);
+  cs = mpc_get_str(base, dp, oo->v->value, C8MPC_RND);
   c8buf_append_str(buf, cs);
   mpc_free_str(cs);
 }
@@ -112,71 +185,237 @@ static struct c8obj* c8mpc_binary_op(struct c8mpc* oo, int op,
   switch (op) {
     case C8_OP_ADD: {
       struct c8mpc* nr = c8mpc_create();
-      mpc_add(nr->value, oo->value, np->value, rnd);
+      mpc_add(nr->v->value, oo->v->value, np->v->value, C8MPC_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_SUBTRACT: {
       struct c8mpc* nr = c8mpc_create();
-      mpc_sub(nr->value, oo->value, np->value, rnd);
+      mpc_sub(nr->v->value, oo->v->value, np->v->value, C8MPC_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_MULTIPLY: {
       struct c8mpc* nr = c8mpc_create();
-      mpc_mul(nr->value, oo->value, np->value, rnd);
+      mpc_mul(nr->v->value, oo->v->value, np->v->value, C8MPC_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_DIVIDE: {
       struct c8mpc* nr = c8mpc_create();
-      mpc_div(nr->value, oo->value, np->value, rnd);
+      mpc_div(nr->v->value, oo->v->value, np->v->value, C8MPC_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_POWER: {
       struct c8mpc* nr = c8mpc_create();
-      mpc_pow(nr->value, oo->value, np->value, rnd);
+      mpc_pow(nr->v->value, oo->v->value, np->v->value, C8MPC_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_EQUALITY:
       return (struct c8obj*)
-        c8bool_create(mpc_cmp(oo->value, np->value) == 0);
+        c8bool_create(mpc_cmp(oo->v->value, np->v->value) == 0);
     case C8_OP_INEQUALITY:
       return (struct c8obj*)
-        c8bool_create(mpc_cmp(oo->value, np->value) != 0);
+        c8bool_create(mpc_cmp(oo->v->value, np->v->value) != 0);
     case C8_OP_GREATER:
       return (struct c8obj*)
-        c8bool_create(mpc_cmp_abs(oo->value, np->value) > 0);
+        c8bool_create(mpc_cmp_abs(oo->v->value, np->v->value) > 0);
     case C8_OP_LESS:
       return (struct c8obj*)
-        c8bool_create(mpc_cmp_abs(oo->value, np->value) < 0);
+        c8bool_create(mpc_cmp_abs(oo->v->value, np->v->value) < 0);
     case C8_OP_GREATER_OR_EQUAL:
       return (struct c8obj*)
-        c8bool_create(mpc_cmp_abs(oo->value, np->value) >= 0);
+        c8bool_create(mpc_cmp_abs(oo->v->value, np->v->value) >= 0);
     case C8_OP_LESS_OR_EQUAL:
       return (struct c8obj*)
-        c8bool_create(mpc_cmp_abs(oo->value, np->value) <= 0);
+        c8bool_create(mpc_cmp_abs(oo->v->value, np->v->value) <= 0);
     case C8_OP_ASSIGN: {
-      mpc_set(oo->value, np->value, rnd);
+      c8mpc_share(oo, np);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_ADD_ASSIGN: {
-      mpc_add(oo->value, oo->value, np->value, rnd);
+      mpc_ptr r = c8mpc_own(oo);
+      mpc_add(r, r, np->v->value, C8MPC_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_SUBTRACT_ASSIGN: {
-      mpc_sub(oo->value, oo->value, np->value, rnd);
+      mpc_ptr r = c8mpc_own(oo);
+      mpc_sub(r, r, np->v->value, C8MPC_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_MULTIPLY_ASSIGN: {
-      mpc_mul(oo->value, oo->value, np->value, rnd);
+      mpc_ptr r = c8mpc_own(oo);
+      mpc_mul(r, r, np->v->value, C8MPC_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_DIVIDE_ASSIGN: {
-      mpc_div(oo->value, oo->value, np->value, rnd);
+      mpc_ptr r = c8mpc_own(oo);
+      mpc_div(r, r, np->v->value, C8MPC_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
   }
   return 0;
 }
 
+static const int c8mpc_kernel_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8mpc_kernel(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpc_binary_op((struct c8mpc*)o, op, (struct c8mpc*)p);
+}
+
+// Where to put a result: in oo itself for assignments, otherwise in a new
+// object, which is returned in nr either way
+static mpc_ptr c8mpc_result(struct c8mpc* oo, int op, struct c8mpc** nr)
+{
+  switch (op) {
+    case C8_OP_ADD_ASSIGN:
+    case C8_OP_SUBTRACT_ASSIGN:
+    case C8_OP_MULTIPLY_ASSIGN:
+    case C8_OP_DIVIDE_ASSIGN:
+      *nr = (struct c8mpc*)c8obj_ref((struct c8obj*)oo);
+      return c8mpc_own(oo);
+  }
+  *nr = c8mpc_create();
+  return (*nr)->v->value;
+}
+
+// Operations with a real operand, which avoid converting it to complex.
+// If rev is set the real is the left operand.
+static struct c8obj* c8mpc_binary_op_fr(struct c8mpc* oo, int op,
+                                        mpfr_srcptr f, int rev)
+{
+  int (*fn)(mpc_ptr, mpc_srcptr, mpfr_srcptr, mpc_rnd_t) = 0;
+  int (*rfn)(mpc_ptr, mpfr_srcptr, mpc_srcptr, mpc_rnd_t) = 0;
+  switch (op) {
+    case C8_OP_EQUALITY:
+    case C8_OP_INEQUALITY: {
+      int eq = mpfr_equal_p(mpc_realref(oo->v->value), f) &&
+        mpfr_zero_p(mpc_imagref(oo->v->value));
+      return (struct c8obj*)c8bool_create(C8_OP_EQUALITY == op ? eq : !eq);
+    }
+    case C8_OP_ASSIGN:
+      mpc_set_fr(c8mpc_own(oo), f, C8MPC_RND);
+      return c8obj_ref((struct c8obj*)oo);
+    case C8_OP_ADD: case C8_OP_ADD_ASSIGN:
+      fn = mpc_add_fr;
+      break;
+    case C8_OP_SUBTRACT: case C8_OP_SUBTRACT_ASSIGN:
+      fn = mpc_sub_fr; rfn = mpc_fr_sub;
+      break;
+    case C8_OP_MULTIPLY: case C8_OP_MULTIPLY_ASSIGN:
+      fn = mpc_mul_fr;
+      break;
+    case C8_OP_DIVIDE: case C8_OP_DIVIDE_ASSIGN:
+      fn = mpc_div_fr; rfn = mpc_fr_div;
+      break;
+    case C8_OP_POWER:
+      if (!rev) fn = mpc_pow_fr;
+      break;
+  }
+  if (!fn) return 0;
+
+  struct c8mpc* nr;
+  mpc_ptr r = c8mpc_result(oo, op, &nr);
+  if (rev && rfn) rfn(r, f, oo->v->value, C8MPC_RND);
+  else fn(r, oo->v->value, f, C8MPC_RND);
+  return (struct c8obj*)nr;
+}
+
+// Operations with an integer operand, using the functions for small
+// integers where there are any, otherwise converting it to an exact real.
+// If rev is set the integer is the left operand.
+static struct c8obj* c8mpc_binary_op_z(struct c8mpc* oo, int op,
+                                       mpz_srcptr z, int rev)
+{
+  int sgn = mpz_sgn(z);
+  int small = mpz_cmpabs_ui(z, ULONG_MAX) <= 0;
+  unsigned long u = mpz_get_ui(z); // Magnitude, if small
+  struct c8mpc* nr = 0;
+  switch (op) {
+    case C8_OP_POWER:
+      if (rev) return 0;
+      nr = c8mpc_create();
+      mpc_pow_z(nr->v->value, oo->v->value, z, C8MPC_RND);
+      return (struct c8obj*)nr;
+    case C8_OP_MULTIPLY: case C8_OP_MULTIPLY_ASSIGN:
+      if (mpz_fits_slong_p(z)) {
+        mpc_ptr r = c8mpc_result(oo, op, &nr);
+        mpc_mul_si(r, oo->v->value, mpz_get_si(z), C8MPC_RND);
+        return (struct c8obj*)nr;
+      }
+      break;
+    case C8_OP_ADD: case C8_OP_ADD_ASSIGN:
+    case C8_OP_SUBTRACT: case C8_OP_SUBTRACT_ASSIGN:
+      if (small && !(rev && (C8_OP_SUBTRACT == op))) {
+        int add = (sgn >= 0) == (C8_OP_ADD == op || C8_OP_ADD_ASSIGN == op);
+        mpc_ptr r = c8mpc_result(oo, op, &nr);
+        if (add) mpc_add_ui(r, oo->v->value, u, C8MPC_RND);
+        else mpc_sub_ui(r, oo->v->value, u, C8MPC_RND);
+        return (struct c8obj*)nr;
+      }
+      break;
+    case C8_OP_DIVIDE: case C8_OP_DIVIDE_ASSIGN:
+      if (small && sgn > 0 && !rev) {
+        mpc_ptr r = c8mpc_result(oo, op, &nr);
+        mpc_div_ui(r, oo->v->value, u, C8MPC_RND);
+        return (struct c8obj*)nr;
+      }
+      break;
+  }
+
+  mpfr_t f;
+  size_t bits = mpz_sizeinbase(z, 2);
+  mpfr_init2(f, bits < MPFR_PREC_MIN ? MPFR_PREC_MIN : bits);
+  mpfr_set_z(f, z, MPFR_RNDN);
+  struct c8obj* ret = c8mpc_binary_op_fr(oo, op, f, rev);
+  mpfr_clear(f);
+  return ret;
+}
+
+static const int c8mpc_kernel_real_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+// With the real on the left, which only makes a new complex
+static const int c8mpc_kernel_real_rev_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8mpc_kernel_fr(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpc_binary_op_fr((struct c8mpc*)o, op,
+                            c8mpfr_value((struct c8mpfr*)p), 0);
+}
+
+static struct c8obj* c8mpc_kernel_fr_rev(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpc_binary_op_fr((struct c8mpc*)p, op,
+                            c8mpfr_value((struct c8mpfr*)o), 1);
+}
+
+static struct c8obj* c8mpc_kernel_z(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpc_binary_op_z((struct c8mpc*)o, op,
+                           c8mpz_value((struct c8mpz*)p), 0);
+}
+
+static struct c8obj* c8mpc_kernel_z_rev(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpc_binary_op_z((struct c8mpc*)p, op,
+                           c8mpz_value((struct c8mpz*)o), 1);
+}
+
 static struct c8obj* c8mpc_lookup(struct c8obj* o, const char* name)
 {
   if (strcmp("log", name)==0) return (struct c8obj*)c8func_create_method(c8mpc_log, o);
@@ -207,35 +446,36 @@ static struct c8obj* c8mpc_op(struct c8obj* o, int op, struct c8obj* p)
       c8buf_clear(&nb);
       return ret;
     }
-    case C8_OP_POSITIVE: {
-      struct c8mpc* nr = c8mpc_create();
-      mpc_set(nr->value, oo->value, rnd);
-      return (struct c8obj*)nr;
-    }
+    case C8_OP_POSITIVE:
+      return c8mpc_copy(o);
     case C8_OP_NEGATIVE: {
       struct c8mpc* nr = c8mpc_create();
-      mpc_neg(nr->value, oo->value, rnd);
+      mpc_neg(nr->v->value, oo->v->value, C8MPC_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_PRE_INC: {
-      mpc_add_ui(oo->value, oo->value, 1, rnd);
+      mpc_ptr r = c8mpc_own(oo);
+      mpc_add_ui(r, r, 1, C8MPC_RND);
       c8obj_ref(o);
       return o;
     }
     case C8_OP_PRE_DEC: {
-      mpc_sub_ui(oo->value, oo->value, 1, rnd);
+      mpc_ptr r = c8mpc_own(oo);
+      mpc_sub_ui(r, r, 1, C8MPC_RND);
       c8obj_ref(o);
       return o;
     }
     case C8_OP_POST_INC: {
-      struct c8mpc* nr = c8mpc_create_mpc(oo->value);
-      mpc_add_ui(oo->value, oo->value, 1, rnd);
-      return (struct c8obj*)nr;
+      struct c8obj* nr = c8mpc_copy(o);
+      mpc_ptr r = c8mpc_own(oo);
+      mpc_add_ui(r, r, 1, C8MPC_RND);
+      return nr;
     }
     case C8_OP_POST_DEC: {
-      struct c8mpc* nr = c8mpc_create_mpc(oo->value);
-      mpc_sub_ui(oo->value, oo->value, 1, rnd);
-      return (struct c8obj*)nr;
+      struct c8obj* nr = c8mpc_copy(o);
+      mpc_ptr r = c8mpc_own(oo);
+      mpc_sub_ui(r, r, 1, C8MPC_RND);
+      return nr;
     }
   }
 
@@ -244,10 +484,7 @@ static struct c8obj* c8mpc_op(struct c8obj* o, int op, struct c8obj* p)
 
   // Convert p to mpc and perform the op
   if (p) {
-    struct c8buf buf; c8buf_init(&buf);
-    c8obj_str(p, &buf, 0);
-    struct c8mpc* fo = c8mpc_create_str(c8buf_str(&buf));
-    c8buf_clear(&buf);
+    struct c8mpc* fo = c8mpc_create_c8obj(p);
     struct c8obj* r = c8mpc_binary_op(oo, op, fo);
     c8obj_unref((struct c8obj*)fo);
     return r;
@@ -256,12 +493,27 @@ static struct c8obj* c8mpc_op(struct c8obj* o, int op, struct c8obj* p)
   return 0;
 }
 
+static void c8mpc_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8mpc* oo = to_const_c8mpc(o);
+  assert(oo);
+  const struct c8mpc_value* v = oo->v;
+  size_t cell = (v == &oo->own) ? 0 : sizeof(struct c8mpc_value);
+  st->limb_bytes =
+    (mpfr_custom_get_size(mpfr_get_prec(mpc_realref(v->value))) +
+     mpfr_custom_get_size(mpfr_get_prec(mpc_imagref(v->value)))) / v->refs;
+  st->bytes = sizeof(struct c8mpc) + cell / v->refs + st->limb_bytes;
+}
+
 static const struct c8obj_imp c8mpc_imp = {
   c8mpc_destroy,
   c8mpc_copy,
   c8mpc_int,
   c8mpc_str,
-  c8mpc_op
+  c8mpc_op,
+  0,
+  c8mpc_stat,
+  "mpc"
 };
 
 const struct c8mpc* to_const_c8mpc(const struct c8obj* o)
@@ -276,26 +528,44 @@ struct c8mpc* to_c8mpc(struct c8obj* o)
   return (struct c8mpc*)to_const_c8mpc(o);
 }
 
-struct c8mpc* c8mpc_create()
+static struct c8mpc* c8mpc_alloc()
 {
-  struct c8mpc* oo = (struct c8mpc*)malloc(sizeof(struct c8mpc));
+  struct c8mpc* oo = (struct c8mpc*)c8heap_alloc(sizeof(struct c8mpc));
   assert(oo);
   c8num_init(&oo->base, &c8mpc_imp);
-  mpc_init2(oo->value, 53); // XXX default prec?
+  return oo;
+}
+
+struct c8mpc* c8mpc_create()
+{
+  struct c8mpc* oo = c8mpc_alloc();
+  c8mpc_value_init(&oo->own, 1, c8num_prec(), c8num_prec());
+  oo->v = &oo->own;
+  return oo;
+}
+
+static struct c8mpc* c8mpc_create_shared(const struct c8mpc* np)
+{
+  // The embedded value is left unused
+  struct c8mpc* oo = c8mpc_alloc();
+  oo->own.refs = 0;
+  oo->own.embedded = 1;
+  oo->v = np->v;
+  ++oo->v->refs;
   return oo;
 }
 
 struct c8mpc* c8mpc_create_int(int rvalue, int ivalue)
 {
   struct c8mpc* oo = c8mpc_create();
-  mpc_set_si_si(oo->value, rvalue, ivalue, rnd);
+  mpc_set_si_si(oo->v->value, rvalue, ivalue, C8MPC_RND);
   return oo;
 }
 
 struct c8mpc* c8mpc_create_double(long double rvalue, long double ivalue)
 {
   struct c8mpc* oo = c8mpc_create();
-  mpc_set_ld_ld(oo->value, rvalue, ivalue, rnd);
+  mpc_set_ld_ld(oo->v->value, rvalue, ivalue, C8MPC_RND);
   return oo;
 }
 
@@ -312,13 +582,39 @@ struct c8mpc* c8mpc_create_str(const char* str)
       case 'x': base = 16; str+=2; break;
     }
   }
-  mpc_set_str(oo->value, str, base, rnd);
+  mpc_set_str(oo->v->value, str, base, C8MPC_RND);
   return oo;
 }
 
 struct c8mpc* c8mpc_create_c8obj(const struct c8obj* obj)
 {
   assert(obj);
+  const struct c8mpc* co = to_const_c8mpc(obj);
+  if (co) return c8mpc_create_mpc(co->v->value);
+  const struct c8mpfr* fo = to_const_c8mpfr(obj);
+  if (fo) {
+    struct c8mpc* oo = c8mpc_create();
+    mpc_set_fr(oo->v->value, c8mpfr_value(fo), C8MPC_RND);
+    return oo;
+  }
+  const struct c8mpz* zo = to_const_c8mpz(obj);
+  if (zo) {
+    struct c8mpc* oo = c8mpc_create();
+    mpc_set_z(oo->v->value, c8mpz_value(zo), C8MPC_RND);
+    return oo;
+  }
+  const struct c8mpq* qo = to_const_c8mpq(obj);
+  if (qo) {
+    struct c8mpc* oo = c8mpc_create();
+    mpc_set_q(oo->v->value, c8mpq_value(qo), C8MPC_RND);
+    return oo;
+  }
+  const struct c8f64* ro = to_const_c8f64(obj);
+  if (ro) {
+    struct c8mpc* oo = c8mpc_create();
+    mpc_set_d(oo->v->value, c8f64_value(ro), C8MPC_RND);
+    return oo;
+  }
   struct c8buf buf; c8buf_init(&buf);
   c8obj_str(obj, &buf, 0);
   struct c8mpc* oo = c8mpc_create_str(c8buf_str(&buf));
@@ -326,62 +622,94 @@ struct c8mpc* c8mpc_create_c8obj(const struct c8obj* obj)
   return oo;
 }
 
+struct c8mpc* c8mpc_create_exact(mpc_srcptr value)
+{
+  struct c8mpc* oo = c8mpc_alloc();
+  c8mpc_value_init(&oo->own, 1, mpfr_get_prec(mpc_realref(value)),
+                   mpfr_get_prec(mpc_imagref(value)));
+  oo->v = &oo->own;
+  mpc_set(oo->v->value, value, MPC_RNDNN);
+  return oo;
+}
+
 struct c8mpc* c8mpc_create_mpc(const mpc_t value)
 {
   struct c8mpc* oo = c8mpc_create();
-  mpc_set(oo->value, value, rnd);
+  mpc_set(oo->v->value, value, C8MPC_RND);
   return oo;
 }
 
+mpc_srcptr c8mpc_value(const struct c8mpc* oo)
+{
+  assert(oo);
+  return oo->v->value;
+}
+
 static struct c8num* c8mpc_cplx_create(const char* str)
 {
   return (struct c8num*)c8mpc_create_str(str);
 }
 
+static struct c8num* c8mpc_cplx_convert(const struct c8obj* o)
+{
+  return (struct c8num*)c8mpc_create_c8obj(o);
+}
+
 void c8mpc_init_ctx(struct c8ctx* ctx)
 {
   //  mpc_set_default_prec(256);
-  
+  c8num_register_cplx_create(c8mpc_cplx_create);
+  int t = c8num_register_type(&c8mpc_imp, C8NUM_RANK_CPLX, c8mpc_cplx_convert);
+  c8num_register_kernel(t, t, c8mpc_kernel_ops, c8mpc_kernel);
+  int fr = c8num_type_id("mpfr");
+  c8num_register_kernel(t, fr, c8mpc_kernel_real_ops, c8mpc_kernel_fr);
+  c8num_register_kernel(fr, t, c8mpc_kernel_real_rev_ops, c8mpc_kernel_fr_rev);
+  int z = c8num_type_id("mpz");
+  c8num_register_kernel(t, z, c8mpc_kernel_real_ops, c8mpc_kernel_z);
+  c8num_register_kernel(z, t, c8mpc_kernel_real_rev_ops, c8mpc_kernel_z_rev);
+
   struct c8mpc* c = c8mpc_create_int(0, 1);
   c8ctx_add(ctx, "i", (struct c8obj*)c);
-  c8num_register_cplx_create(c8mpc_cplx_create);
 }
 
-static struct c8obj* c8mpc_single_arg(struct c8list* args)
+/* Get the single argument as a c8mpc, borrowed from the list if it already
+ * is one. Any new object (a conversion or an error) is also returned in owned,
+ * which the caller must unref.
+ */
+static struct c8obj* c8mpc_single_arg(struct c8list* args, struct c8obj** owned)
 {
+  *owned = 0;
   if (c8list_size(args) != 1)
-    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+    return *owned = (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* a = c8list_peek(args, 0);
   if (!a)
-    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8mpc* na = to_c8mpc(a);
-  if (na) return a;
-  na = c8mpc_create_c8obj(a);
-  c8obj_unref(a);
-  return (struct c8obj*)na;
+    return *owned = (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  if (to_c8mpc(a)) return a;
+  return *owned = (struct c8obj*)c8mpc_create_c8obj(a);
 }
 
 #define C8MPC_SINGLE_ARG_FN(name, code)             \
   struct c8obj* c8mpc_##name (struct c8list* args)  \
   {                                                 \
-    struct c8obj* a = c8mpc_single_arg(args);       \
+    struct c8obj* t;                                \
+    struct c8obj* a = c8mpc_single_arg(args, &t);  \
     struct c8mpc* na = to_c8mpc(a);                 \
     if (!na) return a;                              \
     struct c8mpc* nr = c8mpc_create();              \
     code;                                           \
-    c8obj_unref(a);                                 \
+    c8obj_unref(t);                                 \
     return (struct c8obj*)nr;                       \
   }
 
-C8MPC_SINGLE_ARG_FN(log, mpc_log(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(exp, mpc_exp(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(sqrt, mpc_sqrt(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(cos, mpc_cos(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(sin, mpc_sin(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(tan, mpc_tan(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(acos, mpc_acos(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(asin, mpc_asin(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(atan, mpc_atan(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(cosh, mpc_cosh(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(sinh, mpc_sinh(nr->value, na->value, rnd))
-C8MPC_SINGLE_ARG_FN(tanh, mpc_tanh(nr->value, na->value, rnd))
+C8MPC_SINGLE_ARG_FN(log, mpc_log(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(exp, mpc_exp(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(sqrt, mpc_sqrt(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(cos, mpc_cos(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(sin, mpc_sin(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(tan, mpc_tan(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(acos, mpc_acos(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(asin, mpc_asin(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(atan, mpc_atan(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(cosh, mpc_cosh(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(sinh, mpc_sinh(nr->v->value, na->v->value, C8MPC_RND))
+C8MPC_SINGLE_ARG_FN(tanh, mpc_tanh(nr->v->value, na->v->value, C8MPC_RND))
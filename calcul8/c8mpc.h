@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <mpc.h>
+
 struct c8mpc;
 struct c8obj;
 struct c8ctx;
@@ -38,6 +40,15 @@ struct c8mpc* c8mpc_create_double(long double rvalue, long double ivalue);
 struct c8mpc* c8mpc_create_str(const char* str);
 struct c8mpc* c8mpc_create_c8obj(const struct c8obj* obj);
 
+/** Create a c8mpc object with the precisions as well as the value of an
+ * mpc, rather than at the working precision
+ */
+struct c8mpc* c8mpc_create_exact(mpc_srcptr value);
+
+/** Get the value, which must not be modified
+ */
+mpc_srcptr c8mpc_value(const struct c8mpc* oo);
+
 /** Add mpc functions to context
  */
 void c8mpc_init_ctx(struct c8ctx* ctx);
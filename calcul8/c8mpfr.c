@@ -19,6 +19,10 @@
  */
 
 #include "c8mpfr.h"
+#include "c8mpz.h"
+#include "c8mpq.h"
+#include "c8mpc.h"
+#include "c8f64.h"
 #include "c8obj.h"
 #include "c8ops.h"
 #include "c8bool.h"
@@ -29,42 +33,134 @@
 #include "c8buf.h"
 #include "c8num.h"
 #include "c8numimp.h"
+#include "c8heap.h"
+#include "c8fmt.h"
 
 #include <mpfr.h>
+#include <mpc.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+
+// Value storage, shared between copies until one of them is modified.
+// Each object embeds storage for its own value, including the significand
+// for precisions up to C8MPFR_INLINE_PREC using MPFR's custom interface,
+// so such a number is a single allocation.
+#define C8MPFR_INLINE_PREC 256
+
+struct c8mpfr_value {
+  int refs;
+  int embedded; // 1 if embedded in an object, -1 once that is destroyed
+  mpfr_t value;
+  mp_limb_t limbs[(C8MPFR_INLINE_PREC + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS];
+};
 
 struct c8mpfr {
   struct c8num base;
-  mpfr_t value;
+  struct c8mpfr_value* v;
+  struct c8mpfr_value own;
 };
 
-static mpfr_rnd_t rnd = GMP_RNDN;
-static int dp = 0;
+// Rounding mode of the working context
+#define C8MPFR_RND ((mpfr_rnd_t)c8num_rnd())
 
 struct c8mpfr* c8mpfr_create_mpfr(const mpfr_t value);
+static struct c8mpfr* c8mpfr_create_prec(mpfr_prec_t prec);
+static struct c8mpfr* c8mpfr_create_shared(const struct c8mpfr* np);
+
+static void c8mpfr_value_init(struct c8mpfr_value* v, int embedded,
+                              mpfr_prec_t prec)
+{
+  v->refs = 1;
+  v->embedded = embedded;
+  if (prec <= C8MPFR_INLINE_PREC) {
+    mpfr_custom_init(v->limbs, prec);
+    mpfr_custom_init_set(v->value, MPFR_ZERO_KIND, 0, prec, v->limbs);
+  } else {
+    mpfr_init2(v->value, prec);
+  }
+}
+
+static void c8mpfr_value_unref(struct c8mpfr_value* v)
+{
+  assert(v->refs > 0);
+  if (--v->refs) return;
+  if (mpfr_custom_get_significand(v->value) != v->limbs) mpfr_clear(v->value);
+  if (v->embedded == 0) {
+    free(v);
+  } else if (v->embedded < 0) {
+    // Last user of a destroyed object's value, so free the object
+    c8heap_free((char*)v - offsetof(struct c8mpfr, own));
+  }
+}
+
+// Get the value for modification, copying it first if it is shared
+static mpfr_ptr c8mpfr_own(struct c8mpfr* oo)
+{
+  struct c8mpfr_value* v = oo->v;
+  if (v->refs > 1) {
+    struct c8mpfr_value* nv = &oo->own;
+    mpfr_prec_t prec = mpfr_get_prec(v->value);
+    if (nv->refs == 0) {
+      c8mpfr_value_init(nv, 1, prec);
+    } else {
+      nv = malloc(sizeof(struct c8mpfr_value));
+      assert(nv);
+      c8mpfr_value_init(nv, 0, prec);
+    }
+    mpfr_set(nv->value, v->value, C8MPFR_RND);
+    --v->refs;
+    oo->v = nv;
+  }
+  return oo->v->value;
+}
+
+// Make this object take the value of np
+static void c8mpfr_share(struct c8mpfr* oo, const struct c8mpfr* np)
+{
+  if (oo->v == np->v) return;
+  if (mpfr_get_prec(np->v->value) <= C8MPFR_INLINE_PREC &&
+      mpfr_get_prec(np->v->value) == mpfr_get_prec(oo->v->value)) {
+    // Small values are copied, rather than tying the objects together
+    mpfr_set(c8mpfr_own(oo), np->v->value, C8MPFR_RND);
+  } else {
+    ++np->v->refs;
+    c8mpfr_value_unref(oo->v);
+    oo->v = np->v;
+  }
+}
 
 static void c8mpfr_destroy(struct c8obj* o)
 {
   struct c8mpfr* oo = to_c8mpfr(o);
   assert(oo);
-  mpfr_clear(oo->value);
-  free(oo);
+  // If copies still share the embedded value, the last of them frees this
+  struct c8mpfr_value* v = oo->v;
+  int unused = (v != &oo->own && oo->own.refs == 0);
+  oo->own.embedded = -1;
+  c8mpfr_value_unref(v);
+  if (unused) c8heap_free(oo);
 }
 
 static struct c8obj* c8mpfr_copy(const struct c8obj* o)
 {
   const struct c8mpfr* oo = to_const_c8mpfr(o);
   assert(oo);
-  return (struct c8obj*)c8mpfr_create_mpfr(oo->value);
+  mpfr_prec_t prec = mpfr_get_prec(oo->v->value);
+  if (prec > C8MPFR_INLINE_PREC) {
+    return (struct c8obj*)c8mpfr_create_shared(oo);
+  }
+  struct c8mpfr* nr = c8mpfr_create_prec(prec);
+  mpfr_set(nr->v->value, oo->v->value, C8MPFR_RND);
+  return (struct c8obj*)nr;
 }
 
 static int c8mpfr_int(const struct c8obj* o)
 {
   const struct c8mpfr* oo = to_const_c8mpfr(o);
   assert(oo);
-  return (int)mpfr_get_si(oo->value, rnd);
+  return (int)mpfr_get_si(oo->v->value, C8MPFR_RND);
 }
 
 static void c8mpfr_str(const struct c8obj* o, struct c8buf* buf, int f)
@@ -72,8 +168,8 @@ static void c8mpfr_str(const struct c8obj* o, struct c8buf* buf, int f)
   const struct c8mpfr* oo = to_const_c8mpfr(o);
   assert(oo);
 
-  if (!mpfr_number_p(oo->value)) {
-    if (mpfr_inf_p(oo->value)) {
+  if (!mpfr_number_p(oo->v->value)) {
+    if (mpfr_inf_p(oo->v->value)) {
       c8buf_append_str(buf, "Infinity");
     } else {
       c8buf_append_str(buf, "Not a number");
@@ -81,31 +177,20 @@ static void c8mpfr_str(const struct c8obj* o, struct c8buf* buf, int f)
     return;
   }
 
-  if (dp == 0) {
-    // Convert bit precision to decimal places
-    dp = (unsigned int)(mpfr_get_default_prec() * 0.301); // log(2)
-  }
+  // Convert bit precision to decimal places
+  int dp = (int)(mpfr_get_prec(oo->v->value) * 0.301); // log(2)
   
-  char* cs = 0;
+  const char* fmt = "%-.*Rg";
   switch (f & C8_FMT_MASK_BASE) {
-    case C8_FMT_BIN:
-      mpfr_asprintf(&cs, "%-.*Rb", dp, oo->value);
-      break;
-    case C8_FMT_HEX:
-      mpfr_asprintf(&cs, "%-.*Ra", dp, oo->value);
-      break;
-    case C8_FMT_SCI:
-      mpfr_asprintf(&cs, "%-.Re", oo->value);
-      break;
+    case C8_FMT_BIN: fmt = "%-.*Rb"; break;
+    case C8_FMT_HEX: fmt = "%-.*Ra"; break;
+    case C8_FMT_SCI: fmt = "%-Re"; break;
     case C8_FMT_FIX:
-      mpfr_asprintf(&cs, "%-.Rf", oo->value);
-      break;
-    default:
-      mpfr_asprintf(&cs, "%-.*Rg", dp, oo->value);
+      fmt = "%-.*Rf";
+      dp = c8fmt_mpfr_fix_dp(oo->v->value);
       break;
   }
-  c8buf_append_str(buf, cs);
-  mpfr_free_str(cs);
+  c8fmt_mpfr_append(buf, fmt, dp, oo->v->value);
 }
 
 static struct c8obj* c8mpfr_binary_op(struct c8mpfr* oo, int op,
@@ -114,78 +199,298 @@ static struct c8obj* c8mpfr_binary_op(struct c8mpfr* oo, int op,
   switch (op) {
     case C8_OP_ADD: {
       struct c8mpfr* nr = c8mpfr_create();
-      mpfr_add(nr->value, oo->value, np->value, rnd);
+      mpfr_add(nr->v->value, oo->v->value, np->v->value, C8MPFR_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_SUBTRACT: {
       struct c8mpfr* nr = c8mpfr_create();
-      mpfr_sub(nr->value, oo->value, np->value, rnd);
+      mpfr_sub(nr->v->value, oo->v->value, np->v->value, C8MPFR_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_MULTIPLY: {
       struct c8mpfr* nr = c8mpfr_create();
-      mpfr_mul(nr->value, oo->value, np->value, rnd);
+      mpfr_mul(nr->v->value, oo->v->value, np->v->value, C8MPFR_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_DIVIDE: {
       struct c8mpfr* nr = c8mpfr_create();
-      mpfr_div(nr->value, oo->value, np->value, rnd);
+      mpfr_div(nr->v->value, oo->v->value, np->v->value, C8MPFR_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_MODULUS: {
       struct c8mpfr* nr = c8mpfr_create();
-      mpfr_fmod(nr->value, oo->value, np->value, rnd);
+      mpfr_fmod(nr->v->value, oo->v->value, np->v->value, C8MPFR_RND);
+      return (struct c8obj*)nr;
+    }
+    case C8_OP_POWER: {
+      struct c8mpfr* nr = c8mpfr_create();
+      mpfr_pow(nr->v->value, oo->v->value, np->v->value, C8MPFR_RND);
+      return (struct c8obj*)nr;
+    }
+
+    case C8_OP_EQUALITY:
+      return (struct c8obj*)
+        c8bool_create(mpfr_equal_p(oo->v->value, np->v->value));
+    case C8_OP_INEQUALITY:
+      return (struct c8obj*)
+        c8bool_create(!mpfr_equal_p(oo->v->value, np->v->value));
+    case C8_OP_GREATER:
+      return (struct c8obj*)
+        c8bool_create(mpfr_greater_p(oo->v->value, np->v->value));
+    case C8_OP_LESS:
+      return (struct c8obj*)
+        c8bool_create(mpfr_less_p(oo->v->value, np->v->value));
+    case C8_OP_GREATER_OR_EQUAL:
+      return (struct c8obj*)
+        c8bool_create(mpfr_greaterequal_p(oo->v->value, np->v->value));
+    case C8_OP_LESS_OR_EQUAL:
+      return (struct c8obj*)
+        c8bool_create(mpfr_lessequal_p(oo->v->value, np->v->value));
+
+    case C8_OP_ASSIGN: {
+      c8mpfr_share(oo, np);
+      return c8obj_ref((struct c8obj*)oo);
+    }
+    case C8_OP_ADD_ASSIGN: {
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_add(r, r, np->v->value, C8MPFR_RND);
+      return c8obj_ref((struct c8obj*)oo);
+    }
+    case C8_OP_SUBTRACT_ASSIGN: {
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_sub(r, r, np->v->value, C8MPFR_RND);
+      return c8obj_ref((struct c8obj*)oo);
+    }
+    case C8_OP_MULTIPLY_ASSIGN: {
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_mul(r, r, np->v->value, C8MPFR_RND);
+      return c8obj_ref((struct c8obj*)oo);
+    }
+    case C8_OP_DIVIDE_ASSIGN: {
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_div(r, r, np->v->value, C8MPFR_RND);
+      return c8obj_ref((struct c8obj*)oo);
+    }
+  }
+  return 0;
+}
+
+// Operations with an integer operand, which avoid converting it. Returns 0
+// for anything else, which is then done with the operand converted.
+static struct c8obj* c8mpfr_binary_op_z(struct c8mpfr* oo, int op,
+                                        mpz_srcptr z)
+{
+  switch (op) {
+    case C8_OP_ADD: {
+      struct c8mpfr* nr = c8mpfr_create();
+      mpfr_add_z(nr->v->value, oo->v->value, z, C8MPFR_RND);
+      return (struct c8obj*)nr;
+    }
+    case C8_OP_SUBTRACT: {
+      struct c8mpfr* nr = c8mpfr_create();
+      mpfr_sub_z(nr->v->value, oo->v->value, z, C8MPFR_RND);
+      return (struct c8obj*)nr;
+    }
+    case C8_OP_MULTIPLY: {
+      struct c8mpfr* nr = c8mpfr_create();
+      mpfr_mul_z(nr->v->value, oo->v->value, z, C8MPFR_RND);
+      return (struct c8obj*)nr;
+    }
+    case C8_OP_DIVIDE: {
+      struct c8mpfr* nr = c8mpfr_create();
+      mpfr_div_z(nr->v->value, oo->v->value, z, C8MPFR_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_POWER: {
       struct c8mpfr* nr = c8mpfr_create();
-      mpfr_pow(nr->value, oo->value, np->value, rnd);
+      mpfr_pow_z(nr->v->value, oo->v->value, z, C8MPFR_RND);
       return (struct c8obj*)nr;
     }
 
     case C8_OP_EQUALITY:
       return (struct c8obj*)
-        c8bool_create(mpfr_equal_p(oo->value, np->value));
+        c8bool_create(!mpfr_nan_p(oo->v->value) && mpfr_cmp_z(oo->v->value, z) == 0);
     case C8_OP_INEQUALITY:
       return (struct c8obj*)
-        c8bool_create(!mpfr_equal_p(oo->value, np->value));
+        c8bool_create(mpfr_nan_p(oo->v->value) || mpfr_cmp_z(oo->v->value, z) != 0);
     case C8_OP_GREATER:
       return (struct c8obj*)
-        c8bool_create(mpfr_greater_p(oo->value, np->value));
+        c8bool_create(!mpfr_nan_p(oo->v->value) && mpfr_cmp_z(oo->v->value, z) > 0);
     case C8_OP_LESS:
       return (struct c8obj*)
-        c8bool_create(mpfr_less_p(oo->value, np->value));
+        c8bool_create(!mpfr_nan_p(oo->v->value) && mpfr_cmp_z(oo->v->value, z) < 0);
     case C8_OP_GREATER_OR_EQUAL:
       return (struct c8obj*)
-        c8bool_create(mpfr_greaterequal_p(oo->value, np->value));
+        c8bool_create(!mpfr_nan_p(oo->v->value) && mpfr_cmp_z(oo->v->value, z) >= 0);
     case C8_OP_LESS_OR_EQUAL:
       return (struct c8obj*)
-        c8bool_create(mpfr_lessequal_p(oo->value, np->value));
+        c8bool_create(!mpfr_nan_p(oo->v->value) && mpfr_cmp_z(oo->v->value, z) <= 0);
 
     case C8_OP_ASSIGN: {
-      mpfr_set(oo->value, np->value, rnd);
+      mpfr_set_z(c8mpfr_own(oo), z, C8MPFR_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_ADD_ASSIGN: {
-      mpfr_add(oo->value, oo->value, np->value, rnd);
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_add_z(r, r, z, C8MPFR_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_SUBTRACT_ASSIGN: {
-      mpfr_sub(oo->value, oo->value, np->value, rnd);
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_sub_z(r, r, z, C8MPFR_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_MULTIPLY_ASSIGN: {
-      mpfr_mul(oo->value, oo->value, np->value, rnd);
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_mul_z(r, r, z, C8MPFR_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_DIVIDE_ASSIGN: {
-      mpfr_div(oo->value, oo->value, np->value, rnd);
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_div_z(r, r, z, C8MPFR_RND);
       return c8obj_ref((struct c8obj*)oo);
     }
   }
   return 0;
 }
 
+// Operations with a rational operand, which avoid rounding it first
+static struct c8obj* c8mpfr_binary_op_q(struct c8mpfr* oo, int op,
+                                        mpq_srcptr q)
+{
+  int (*f)(mpfr_ptr, mpfr_srcptr, mpq_srcptr, mpfr_rnd_t) = 0;
+  switch (op) {
+    case C8_OP_ADD: case C8_OP_ADD_ASSIGN: f = mpfr_add_q; break;
+    case C8_OP_SUBTRACT: case C8_OP_SUBTRACT_ASSIGN: f = mpfr_sub_q; break;
+    case C8_OP_MULTIPLY: case C8_OP_MULTIPLY_ASSIGN: f = mpfr_mul_q; break;
+    case C8_OP_DIVIDE: case C8_OP_DIVIDE_ASSIGN: f = mpfr_div_q; break;
+
+    case C8_OP_EQUALITY:
+    case C8_OP_INEQUALITY:
+    case C8_OP_GREATER:
+    case C8_OP_LESS:
+    case C8_OP_GREATER_OR_EQUAL:
+    case C8_OP_LESS_OR_EQUAL: {
+      if (mpfr_nan_p(oo->v->value)) {
+        return (struct c8obj*)c8bool_create(C8_OP_INEQUALITY == op);
+      }
+      int c = mpfr_cmp_q(oo->v->value, q);
+      int r = 0;
+      switch (op) {
+        case C8_OP_EQUALITY: r = (c == 0); break;
+        case C8_OP_INEQUALITY: r = (c != 0); break;
+        case C8_OP_GREATER: r = (c > 0); break;
+        case C8_OP_LESS: r = (c < 0); break;
+        case C8_OP_GREATER_OR_EQUAL: r = (c >= 0); break;
+        case C8_OP_LESS_OR_EQUAL: r = (c <= 0); break;
+      }
+      return (struct c8obj*)c8bool_create(r);
+    }
+
+    case C8_OP_ASSIGN: {
+      mpfr_set_q(c8mpfr_own(oo), q, C8MPFR_RND);
+      return c8obj_ref((struct c8obj*)oo);
+    }
+  }
+  if (!f) return 0;
+  switch (op) {
+    case C8_OP_ADD_ASSIGN:
+    case C8_OP_SUBTRACT_ASSIGN:
+    case C8_OP_MULTIPLY_ASSIGN:
+    case C8_OP_DIVIDE_ASSIGN: {
+      mpfr_ptr r = c8mpfr_own(oo);
+      f(r, r, q, C8MPFR_RND);
+      return c8obj_ref((struct c8obj*)oo);
+    }
+  }
+  struct c8mpfr* nr = c8mpfr_create();
+  f(nr->v->value, oo->v->value, q, C8MPFR_RND);
+  return (struct c8obj*)nr;
+}
+
+static const int c8mpfr_kernel_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_MODULUS,
+  C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8mpfr_kernel(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpfr_binary_op((struct c8mpfr*)o, op, (struct c8mpfr*)p);
+}
+
+// All but modulus, which is done by converting the integer
+static const int c8mpfr_kernel_z_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8mpfr_kernel_z(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpfr_binary_op_z((struct c8mpfr*)o, op,
+                            c8mpz_value((struct c8mpz*)p));
+}
+
+static struct c8obj* c8mpfr_fma(struct c8obj* a, struct c8obj* b,
+                                struct c8obj* c, int form)
+{
+  mpfr_srcptr av = ((struct c8mpfr*)a)->v->value;
+  mpfr_srcptr bv = ((struct c8mpfr*)b)->v->value;
+  struct c8mpfr* nr = (struct c8mpfr*)c;
+  mpfr_ptr r = 0;
+  if (C8NUM_FMA_ASSIGN == form || C8NUM_FNMA_ASSIGN == form) {
+    c8obj_ref(c);
+    r = c8mpfr_own(nr);
+  } else {
+    nr = c8mpfr_create();
+    r = nr->v->value;
+  }
+  mpfr_srcptr cv = ((struct c8mpfr*)c)->v->value;
+  switch (form) {
+    case C8NUM_FMA:
+    case C8NUM_FMA_ASSIGN:
+      mpfr_fma(r, av, bv, cv, C8MPFR_RND);
+      break;
+    case C8NUM_FMS:
+      mpfr_fms(r, av, bv, cv, C8MPFR_RND);
+      break;
+    case C8NUM_FNMA:
+    case C8NUM_FNMA_ASSIGN: {
+      // c - a*b is -(a*b - c), rounded the opposite way
+      mpfr_rnd_t rnd = C8MPFR_RND;
+      if (MPFR_RNDU == rnd) rnd = MPFR_RNDD;
+      else if (MPFR_RNDD == rnd) rnd = MPFR_RNDU;
+      mpfr_fms(r, av, bv, cv, rnd);
+      mpfr_neg(r, r, rnd);
+      break;
+    }
+  }
+  return (struct c8obj*)nr;
+}
+
+static const int c8mpfr_kernel_q_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8mpfr_kernel_q(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpfr_binary_op_q((struct c8mpfr*)o, op,
+                            c8mpq_value((struct c8mpq*)p));
+}
+
 static struct c8obj* c8mpfr_lookup(struct c8obj* o, const char* name)
 {
   if (strcmp("abs", name)==0) return (struct c8obj*)c8func_create_method(c8mpfr_abs, o);
@@ -222,55 +527,59 @@ static struct c8obj* c8mpfr_op(struct c8obj* o, int op, struct c8obj* p)
       c8buf_clear(&nb);
       return ret;
     }
-    case C8_OP_POSITIVE: {
-      struct c8mpfr* nr = c8mpfr_create();
-      mpfr_set(nr->value, oo->value, rnd);
-      return (struct c8obj*)nr;
-    }
+    case C8_OP_POSITIVE:
+      return c8mpfr_copy(o);
     case C8_OP_NEGATIVE: {
       struct c8mpfr* nr = c8mpfr_create();
-      mpfr_neg(nr->value, oo->value, rnd);
+      mpfr_neg(nr->v->value, oo->v->value, C8MPFR_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_PRE_INC: {
-      mpfr_add_ui(oo->value, oo->value, 1, rnd);
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_add_ui(r, r, 1, C8MPFR_RND);
       c8obj_ref(o);
       return o;
     }
     case C8_OP_PRE_DEC: {
-      mpfr_sub_ui(oo->value, oo->value, 1, rnd);
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_sub_ui(r, r, 1, C8MPFR_RND);
       c8obj_ref(o);
       return o;
     }
     case C8_OP_FACTORIAL: {
-      if (!mpfr_integer_p(oo->value)) {
+      if (!mpfr_integer_p(oo->v->value)) {
         return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
       }
       struct c8mpfr* nr = c8mpfr_create();
-      mpfr_fac_ui(nr->value, mpfr_get_ui(oo->value, rnd), rnd);
+      mpfr_fac_ui(nr->v->value, mpfr_get_ui(oo->v->value, C8MPFR_RND), C8MPFR_RND);
       return (struct c8obj*)nr;
     }
     case C8_OP_POST_INC: {
-      struct c8mpfr* nr = c8mpfr_create_mpfr(oo->value);
-      mpfr_add_ui(oo->value, oo->value, 1, rnd);
-      return (struct c8obj*)nr;
+      struct c8obj* nr = c8mpfr_copy(o);
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_add_ui(r, r, 1, C8MPFR_RND);
+      return nr;
     }
     case C8_OP_POST_DEC: {
-      struct c8mpfr* nr = c8mpfr_create_mpfr(oo->value);
-      mpfr_sub_ui(oo->value, oo->value, 1, rnd);
-      return (struct c8obj*)nr;
+      struct c8obj* nr = c8mpfr_copy(o);
+      mpfr_ptr r = c8mpfr_own(oo);
+      mpfr_sub_ui(r, r, 1, C8MPFR_RND);
+      return nr;
     }
   }
 
   struct c8mpfr* np = to_c8mpfr(p);
   if (np) return c8mpfr_binary_op(oo, op, np);
 
+  struct c8mpz* zp = to_c8mpz(p);
+  if (zp) {
+    struct c8obj* r = c8mpfr_binary_op_z(oo, op, c8mpz_value(zp));
+    if (r) return r;
+  }
+
   // Convert p to mpfr and perform the op
   if (p) {
-    struct c8buf buf; c8buf_init(&buf);
-    c8obj_str(p, &buf, 0);
-    struct c8mpfr* fo = c8mpfr_create_str(c8buf_str(&buf));
-    c8buf_clear(&buf);
+    struct c8mpfr* fo = c8mpfr_create_c8obj(p);
     struct c8obj* r = c8mpfr_binary_op(oo, op, fo);
     c8obj_unref((struct c8obj*)fo);
     return r;
@@ -279,12 +588,27 @@ static struct c8obj* c8mpfr_op(struct c8obj* o, int op, struct c8obj* p)
   return 0;
 }
 
+static void c8mpfr_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8mpfr* oo = to_const_c8mpfr(o);
+  assert(oo);
+  const struct c8mpfr_value* v = oo->v;
+  size_t cell = (v == &oo->own) ? 0 : sizeof(struct c8mpfr_value);
+  if (mpfr_custom_get_significand(v->value) != v->limbs) {
+    st->limb_bytes = mpfr_custom_get_size(mpfr_get_prec(v->value)) / v->refs;
+  }
+  st->bytes = sizeof(struct c8mpfr) + cell / v->refs + st->limb_bytes;
+}
+
 static const struct c8obj_imp c8mpfr_imp = {
   c8mpfr_destroy,
   c8mpfr_copy,
   c8mpfr_int,
   c8mpfr_str,
-  c8mpfr_op
+  c8mpfr_op,
+  0,
+  c8mpfr_stat,
+  "mpfr"
 };
 
 const struct c8mpfr* to_const_c8mpfr(const struct c8obj* o)
@@ -299,26 +623,49 @@ struct c8mpfr* to_c8mpfr(struct c8obj* o)
   return (struct c8mpfr*)to_const_c8mpfr(o);
 }
 
-struct c8mpfr* c8mpfr_create()
+static struct c8mpfr* c8mpfr_alloc()
 {
-  struct c8mpfr* oo = (struct c8mpfr*)malloc(sizeof(struct c8mpfr));
+  struct c8mpfr* oo = (struct c8mpfr*)c8heap_alloc(sizeof(struct c8mpfr));
   assert(oo);
   c8num_init(&oo->base, &c8mpfr_imp);
-  mpfr_init(oo->value);
   return oo;
 }
 
+static struct c8mpfr* c8mpfr_create_prec(mpfr_prec_t prec)
+{
+  struct c8mpfr* oo = c8mpfr_alloc();
+  c8mpfr_value_init(&oo->own, 1, prec);
+  oo->v = &oo->own;
+  return oo;
+}
+
+static struct c8mpfr* c8mpfr_create_shared(const struct c8mpfr* np)
+{
+  // The embedded value is left unused
+  struct c8mpfr* oo = c8mpfr_alloc();
+  oo->own.refs = 0;
+  oo->own.embedded = 1;
+  oo->v = np->v;
+  ++oo->v->refs;
+  return oo;
+}
+
+struct c8mpfr* c8mpfr_create()
+{
+  return c8mpfr_create_prec(c8num_prec());
+}
+
 struct c8mpfr* c8mpfr_create_int(int value)
 {
   struct c8mpfr* oo = c8mpfr_create();
-  mpfr_set_si(oo->value, value, rnd);
+  mpfr_set_si(oo->v->value, value, C8MPFR_RND);
   return oo;
 }
 
 struct c8mpfr* c8mpfr_create_double(long double value)
 {
   struct c8mpfr* oo = c8mpfr_create();
-  mpfr_set_ld(oo->value, value, rnd);
+  mpfr_set_ld(oo->v->value, value, C8MPFR_RND);
   return oo;
 }
 
@@ -335,13 +682,35 @@ struct c8mpfr* c8mpfr_create_str(const char* str)
       case 'x': base = 16; str+=2; break;
     }
   }
-  mpfr_set_str(oo->value, str, base, rnd);
+  mpfr_set_str(oo->v->value, str, base, C8MPFR_RND);
   return oo;
 }
 
 struct c8mpfr* c8mpfr_create_c8obj(const struct c8obj* obj)
 {
   assert(obj);
+  const struct c8mpfr* fo = to_const_c8mpfr(obj);
+  if (fo) return c8mpfr_create_mpfr(fo->v->value);
+  const struct c8mpz* zo = to_const_c8mpz(obj);
+  if (zo) {
+    struct c8mpfr* oo = c8mpfr_create();
+    mpfr_set_z(oo->v->value, c8mpz_value(zo), C8MPFR_RND);
+    return oo;
+  }
+  const struct c8mpq* qo = to_const_c8mpq(obj);
+  if (qo) {
+    struct c8mpfr* oo = c8mpfr_create();
+    mpfr_set_q(oo->v->value, c8mpq_value(qo), C8MPFR_RND);
+    return oo;
+  }
+  const struct c8mpc* co = to_const_c8mpc(obj);
+  if (co) return c8mpfr_create_mpfr(mpc_realref(c8mpc_value(co)));
+  const struct c8f64* ro = to_const_c8f64(obj);
+  if (ro) {
+    struct c8mpfr* oo = c8mpfr_create();
+    mpfr_set_d(oo->v->value, c8f64_value(ro), C8MPFR_RND);
+    return oo;
+  }
   struct c8buf buf; c8buf_init(&buf);
   c8obj_str(obj, &buf, 0);
   struct c8mpfr* oo = c8mpfr_create_str(c8buf_str(&buf));
@@ -349,100 +718,200 @@ struct c8mpfr* c8mpfr_create_c8obj(const struct c8obj* obj)
   return oo;
 }
 
+struct c8mpfr* c8mpfr_create_exact(mpfr_srcptr value)
+{
+  struct c8mpfr* oo = c8mpfr_create_prec(mpfr_get_prec(value));
+  mpfr_set(oo->v->value, value, MPFR_RNDN);
+  return oo;
+}
+
 struct c8mpfr* c8mpfr_create_mpfr(const mpfr_t value)
 {
   struct c8mpfr* oo = c8mpfr_create();
-  mpfr_set(oo->value, value, rnd);
+  mpfr_set(oo->v->value, value, C8MPFR_RND);
   return oo;
 }
 
+mpfr_srcptr c8mpfr_value(const struct c8mpfr* oo)
+{
+  assert(oo);
+  return oo->v->value;
+}
+
 static struct c8num* c8mpfr_real_create(const char* str)
 {
   return (struct c8num*)c8mpfr_create_str(str);
 }
 
+static struct c8num* c8mpfr_real_convert(const struct c8obj* o)
+{
+  return (struct c8num*)c8mpfr_create_c8obj(o);
+}
+
+static int c8mpfr_const_e(mpfr_ptr r, mpfr_rnd_t rnd)
+{
+  mpfr_set_ui(r, 1, rnd);
+  return mpfr_exp(r, r, rnd);
+}
+
+// Mathematical constants, computed when first used at each precision.
+// Each keeps the most precise value computed so far, which lower precisions
+// are rounded from when the result is known to be correctly rounded, and
+// the last value given out.
+struct c8mpfr_const {
+  const char* name;
+  int (*f)(mpfr_ptr r, mpfr_rnd_t rnd);
+  mpfr_t best; // rounded to nearest
+  int have_best;
+  struct c8mpfr* last;
+  mpfr_rnd_t last_rnd;
+};
+
+static struct c8mpfr_const c8mpfr_consts[] = {
+  { "PI", mpfr_const_pi },
+  { "e", c8mpfr_const_e },
+  { "LN2", mpfr_const_log2 },
+  { "CATALAN", mpfr_const_catalan },
+  { "EULER", mpfr_const_euler },
+  { 0 }
+};
+
+// Get a constant at the working precision and rounding
+static struct c8mpfr* c8mpfr_const_value(struct c8mpfr_const* c)
+{
+  mpfr_prec_t prec = c8num_prec();
+  mpfr_rnd_t rnd = C8MPFR_RND;
+  if (c->last && mpfr_get_prec(c->last->v->value) == prec &&
+      c->last_rnd == rnd) {
+    return (struct c8mpfr*)c8mpfr_copy((struct c8obj*)c->last);
+  }
+
+  struct c8mpfr* nr = c8mpfr_create_prec(prec);
+  mpfr_prec_t bp = c->have_best ? mpfr_get_prec(c->best) : 0;
+  if (bp > prec &&
+      mpfr_can_round(c->best, bp - 1, MPFR_RNDN, MPFR_RNDZ,
+                     prec + (MPFR_RNDN == rnd))) {
+    mpfr_set(nr->v->value, c->best, rnd);
+  } else {
+    (c->f)(nr->v->value, rnd);
+    if (bp < prec) {
+      if (!c->have_best) mpfr_init2(c->best, prec);
+      else mpfr_set_prec(c->best, prec);
+      c->have_best = 1;
+      if (MPFR_RNDN == rnd) mpfr_set(c->best, nr->v->value, MPFR_RNDN);
+      else (c->f)(c->best, MPFR_RNDN);
+    }
+  }
+
+  if (c->last) c8obj_unref((struct c8obj*)c->last);
+  c->last = nr;
+  c->last_rnd = rnd;
+  return (struct c8mpfr*)c8mpfr_copy((struct c8obj*)nr);
+}
+
+struct c8obj* c8mpfr_const(const char* name)
+{
+  for (struct c8mpfr_const* c = c8mpfr_consts; c->name; ++c) {
+    if (strcmp(c->name, name) == 0) {
+      if (!c8num_settings()->interval) {
+        return (struct c8obj*)c8mpfr_const_value(c);
+      }
+      // Bounded by the values rounded down and up
+      int rnd = c8num_rnd();
+      c8num_set_rnd(C8NUM_RND_DOWN);
+      struct c8obj* lo = (struct c8obj*)c8mpfr_const_value(c);
+      c8num_set_rnd(C8NUM_RND_UP);
+      struct c8obj* hi = (struct c8obj*)c8mpfr_const_value(c);
+      c8num_set_rnd(rnd);
+      struct c8obj* r = c8num_interval(lo, hi);
+      c8obj_unref(hi);
+      if (!r) return lo;
+      c8obj_unref(lo);
+      return r;
+    }
+  }
+  return 0;
+}
+
 void c8mpfr_init_ctx(struct c8ctx* ctx)
 {
   //  mpfr_set_default_prec(256);
   c8num_register_real_create(c8mpfr_real_create);
-
-  struct c8mpfr* c = c8mpfr_create();
-  mpfr_const_pi(c->value, rnd);
-  c8ctx_add(ctx, "PI", (struct c8obj*)c);
-  
-  c = c8mpfr_create_int(1);
-  mpfr_exp(c->value, c->value, rnd);
-  c8ctx_add(ctx, "e", (struct c8obj*)c);
+  int t = c8num_register_type(&c8mpfr_imp, C8NUM_RANK_REAL, c8mpfr_real_convert);
+  c8num_register_kernel(t, t, c8mpfr_kernel_ops, c8mpfr_kernel);
+  c8num_register_fma(t, c8mpfr_fma);
+  c8num_register_kernel(t, c8num_type_id("mpz"), c8mpfr_kernel_z_ops, c8mpfr_kernel_z);
+  c8num_register_kernel(t, c8num_type_id("mpq"), c8mpfr_kernel_q_ops, c8mpfr_kernel_q);
+
+  for (struct c8mpfr_const* c = c8mpfr_consts; c->name; ++c) {
+    c8ctx_add_lazy(ctx, c->name, c8mpfr_const);
+  }
 }
 
-static struct c8obj* c8mpfr_single_arg(struct c8list* args)
+/* Get the single argument as a c8mpfr, borrowed from the list if it already
+ * is one. Any new object (a conversion or an error) is also returned in owned,
+ * which the caller must unref.
+ */
+static struct c8obj* c8mpfr_single_arg(struct c8list* args, struct c8obj** owned)
 {
+  *owned = 0;
   if (c8list_size(args) != 1)
-    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+    return *owned = (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* a = c8list_peek(args, 0);
   if (!a)
-    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8mpfr* na = to_c8mpfr(a);
-  if (na) return a;
-  na = c8mpfr_create_c8obj(a);
-  c8obj_unref(a);
-  return (struct c8obj*)na;
+    return *owned = (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  if (to_c8mpfr(a)) return a;
+  return *owned = (struct c8obj*)c8mpfr_create_c8obj(a);
 }
 
 #define C8MPFR_SINGLE_ARG_FN(name, code)            \
   struct c8obj* c8mpfr_##name (struct c8list* args) \
   {                                                 \
-    struct c8obj* a = c8mpfr_single_arg(args);      \
+    struct c8obj* t;                                \
+    struct c8obj* a = c8mpfr_single_arg(args, &t);  \
     struct c8mpfr* na = to_c8mpfr(a);               \
     if (!na) return a;                              \
     struct c8mpfr* nr = c8mpfr_create();            \
     code;                                           \
-    c8obj_unref(a);                                 \
+    c8obj_unref(t);                                 \
     return (struct c8obj*)nr;                       \
   }
 
-C8MPFR_SINGLE_ARG_FN(abs, mpfr_abs(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(ceil, mpfr_ceil(nr->value, na->value))
-C8MPFR_SINGLE_ARG_FN(floor, mpfr_floor(nr->value, na->value))
-C8MPFR_SINGLE_ARG_FN(trunc, mpfr_trunc(nr->value, na->value))
-C8MPFR_SINGLE_ARG_FN(log, mpfr_log(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(exp, mpfr_exp(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(sqrt, mpfr_sqrt(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(cos, mpfr_cos(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(sin, mpfr_sin(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(tan, mpfr_tan(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(acos, mpfr_acos(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(asin, mpfr_asin(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(atan, mpfr_atan(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(cosh, mpfr_cosh(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(sinh, mpfr_sinh(nr->value, na->value, rnd))
-C8MPFR_SINGLE_ARG_FN(tanh, mpfr_tanh(nr->value, na->value, rnd))
+C8MPFR_SINGLE_ARG_FN(abs, mpfr_abs(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(ceil, mpfr_ceil(nr->v->value, na->v->value))
+C8MPFR_SINGLE_ARG_FN(floor, mpfr_floor(nr->v->value, na->v->value))
+C8MPFR_SINGLE_ARG_FN(trunc, mpfr_trunc(nr->v->value, na->v->value))
+C8MPFR_SINGLE_ARG_FN(log, mpfr_log(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(exp, mpfr_exp(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(sqrt, mpfr_sqrt(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(cos, mpfr_cos(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(sin, mpfr_sin(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(tan, mpfr_tan(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(acos, mpfr_acos(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(asin, mpfr_asin(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(atan, mpfr_atan(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(cosh, mpfr_cosh(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(sinh, mpfr_sinh(nr->v->value, na->v->value, C8MPFR_RND))
+C8MPFR_SINGLE_ARG_FN(tanh, mpfr_tanh(nr->v->value, na->v->value, C8MPFR_RND))
 
 struct c8obj* c8mpfr_atan2(struct c8list* args)
 {
   if (c8list_size(args) != 2)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* y = c8list_at(args, 0);
-  struct c8obj* x = c8list_at(args, 1);
-  if (!y || !x) {
-    c8obj_unref(y);
-    c8obj_unref(x);
+  struct c8obj* y = c8list_peek(args, 0);
+  struct c8obj* x = c8list_peek(args, 1);
+  if (!y || !x)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  }
+  struct c8mpfr* ty = 0;
   struct c8mpfr* ny = to_c8mpfr(y);
-  if (!ny) {
-    ny = c8mpfr_create_c8obj(y);
-    c8obj_unref(y);
-  }
+  if (!ny) ny = ty = c8mpfr_create_c8obj(y);
+  struct c8mpfr* tx = 0;
   struct c8mpfr* nx = to_c8mpfr(x);
-  if (!nx) {
-    nx = c8mpfr_create_c8obj(x);
-    c8obj_unref(x);
-  }
+  if (!nx) nx = tx = c8mpfr_create_c8obj(x);
   struct c8mpfr* nr = c8mpfr_create();
-  mpfr_atan2(nr->value, ny->value, nx->value, rnd);
-  c8obj_unref((struct c8obj*)ny);
-  c8obj_unref((struct c8obj*)nx);
+  mpfr_atan2(nr->v->value, ny->v->value, nx->v->value, C8MPFR_RND);
+  c8obj_unref((struct c8obj*)ty);
+  c8obj_unref((struct c8obj*)tx);
   return (struct c8obj*)nr;
 }
 
@@ -454,17 +923,14 @@ struct c8obj* c8mpfr_mean(struct c8list* args)
   struct c8mpfr* nr = c8mpfr_create_int(0);
 
   for (int i=0; i<n; ++i) {
-    struct c8obj* a = c8list_at(args, i);
+    struct c8obj* a = c8list_peek(args, i);
     if (!a) continue;
+    struct c8mpfr* ta = 0;
     struct c8mpfr* na = to_c8mpfr(a);
-    if (!na) {
-      na = c8mpfr_create_c8obj(a);
-      c8obj_unref(a);
-      a = (struct c8obj*)na;
-    }
-    mpfr_add(nr->value, nr->value, na->value, rnd);
-    c8obj_unref(a);
+    if (!na) na = ta = c8mpfr_create_c8obj(a);
+    mpfr_add(nr->v->value, nr->v->value, na->v->value, C8MPFR_RND);
+    c8obj_unref((struct c8obj*)ta);
   }
-  mpfr_div_ui(nr->value, nr->value, n, rnd);
+  mpfr_div_ui(nr->v->value, nr->v->value, n, C8MPFR_RND);
   return (struct c8obj*)nr;
 }
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <mpfr.h>
+
 struct c8mpfr;
 struct c8obj;
 struct c8ctx;
@@ -38,7 +40,21 @@ struct c8mpfr* c8mpfr_create_double(long double value);
 struct c8mpfr* c8mpfr_create_str(const char* str);
 struct c8mpfr* c8mpfr_create_c8obj(const struct c8obj* obj);
 
-/** Add mpfr functions to context
+/** Create a c8mpfr object with the precision as well as the value of an
+ * mpfr, rather than at the working precision
+ */
+struct c8mpfr* c8mpfr_create_exact(mpfr_srcptr value);
+
+/** Get the value, which must not be modified
+ */
+mpfr_srcptr c8mpfr_value(const struct c8mpfr* oo);
+
+/** Get a named mathematical constant at the working precision, or 0 if
+ * there is no such constant
+ */
+struct c8obj* c8mpfr_const(const char* name);
+
+/** Add mpfr functions and constants to context
  */
 void c8mpfr_init_ctx(struct c8ctx* ctx);
 
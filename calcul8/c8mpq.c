@@ -0,0 +1,566 @@
+/** c8mpq - numeric object using GNU mpq
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8mpq.h"
+#include "c8mpz.h"
+#include "c8mpfr.h"
+#include "c8mpc.h"
+#include "c8f64.h"
+#include "c8obj.h"
+#include "c8buf.h"
+#include "c8num.h"
+#include "c8numimp.h"
+#include "c8ops.h"
+#include "c8bool.h"
+#include "c8list.h"
+#include "c8func.h"
+#include "c8ctx.h"
+#include "c8error.h"
+#include "c8heap.h"
+#include "c8fmt.h"
+
+#include <gmp.h>
+#include <mpfr.h>
+#include <mpc.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Results are only reduced to lowest terms when compared or output, or
+// once their denominators reach this size
+#define C8MPQ_LAZY_LIMBS 4
+
+struct c8mpq {
+  struct c8num base;
+  mpq_t value;
+  int canonical; // 1 if known to be in lowest terms
+};
+
+// Reduce to lowest terms. This doesn't change the value, so is done in
+// place even on a const object.
+static mpq_srcptr c8mpq_canonical(const struct c8mpq* oo)
+{
+  struct c8mpq* mo = (struct c8mpq*)oo;
+  if (!mo->canonical) {
+    mpq_canonicalize(mo->value);
+    mo->canonical = 1;
+  }
+  return mo->value;
+}
+
+// View an integer as a rational without copying it, for operations
+// between the two. The view must not be modified or referenced.
+static void c8mpq_view_mpz(struct c8mpq* view, mpz_srcptr z,
+                           const mp_limb_t* one)
+{
+  *mpq_numref(view->value) = *z;
+  mpz_roinit_n(mpq_denref(view->value), one, 1);
+  view->canonical = 1;
+}
+
+// Finish a new result, reducing it if it has grown, and returning an
+// integer instead if it is one
+static struct c8obj* c8mpq_result(struct c8mpq* nr)
+{
+  if (!nr->canonical && mpz_size(mpq_denref(nr->value)) >= C8MPQ_LAZY_LIMBS) {
+    c8mpq_canonical(nr);
+  }
+  if (mpz_cmp_ui(mpq_denref(nr->value), 1) == 0) {
+    struct c8mpz* nz = c8mpz_create_mpz(mpq_numref(nr->value));
+    c8obj_unref((struct c8obj*)nr);
+    return (struct c8obj*)nz;
+  }
+  return (struct c8obj*)nr;
+}
+
+// r = a op b for add, subtract, multiply and divide, without reducing.
+// r may be the same as a or b, and b must not be zero when dividing.
+static void c8mpq_arith(mpq_ptr r, mpq_srcptr a, int op, mpq_srcptr b)
+{
+  mpz_ptr rn = mpq_numref(r);
+  mpz_ptr rd = mpq_denref(r);
+  mpz_srcptr an = mpq_numref(a);
+  mpz_srcptr ad = mpq_denref(a);
+  mpz_srcptr bn = mpq_numref(b);
+  mpz_srcptr bd = mpq_denref(b);
+
+  switch (op) {
+    case C8_OP_ADD:
+    case C8_OP_SUBTRACT: {
+      if (mpz_cmp(ad, bd) == 0) {
+        if (C8_OP_ADD == op) mpz_add(rn, an, bn);
+        else mpz_sub(rn, an, bn);
+        mpz_set(rd, ad);
+        break;
+      }
+      mpz_t t;
+      mpz_init(t);
+      mpz_mul(t, bn, ad);
+      mpz_mul(rn, an, bd);
+      if (C8_OP_ADD == op) mpz_add(rn, rn, t);
+      else mpz_sub(rn, rn, t);
+      mpz_mul(rd, ad, bd);
+      mpz_clear(t);
+      break;
+    }
+    case C8_OP_MULTIPLY:
+      mpz_mul(rn, an, bn);
+      mpz_mul(rd, ad, bd);
+      break;
+    case C8_OP_DIVIDE: {
+      mpz_t t;
+      mpz_init_set(t, bn);
+      mpz_mul(rn, an, bd);
+      mpz_mul(rd, ad, t);
+      if (mpz_sgn(rd) < 0) {
+        mpz_neg(rn, rn);
+        mpz_neg(rd, rd);
+      }
+      mpz_clear(t);
+      break;
+    }
+  }
+}
+
+static void c8mpq_destroy(struct c8obj* o)
+{
+  struct c8mpq* oo = to_c8mpq(o);
+  assert(oo);
+  mpq_clear(oo->value);
+  c8heap_free(oo);
+}
+
+static struct c8obj* c8mpq_copy(const struct c8obj* o)
+{
+  const struct c8mpq* oo = to_const_c8mpq(o);
+  assert(oo);
+  struct c8mpq* nr = c8mpq_create();
+  mpq_set(nr->value, oo->value);
+  nr->canonical = oo->canonical;
+  return (struct c8obj*)nr;
+}
+
+static int c8mpq_int(const struct c8obj* o)
+{
+  const struct c8mpq* oo = to_const_c8mpq(o);
+  assert(oo);
+  mpz_t t;
+  mpz_init(t);
+  mpz_tdiv_q(t, mpq_numref(oo->value), mpq_denref(oo->value));
+  int ret = (int)mpz_get_si(t);
+  mpz_clear(t);
+  return ret;
+}
+
+static void c8mpq_str(const struct c8obj* o, struct c8buf* buf, int f)
+{
+  const struct c8mpq* oo = to_const_c8mpq(o);
+  assert(oo);
+  mpq_srcptr q = c8mpq_canonical(oo);
+
+  int base = 10;
+  const char* prefix = "";
+  switch (f & C8_FMT_MASK_BASE) {
+    case C8_FMT_BIN: base = 2; prefix = "0b"; break;
+    case C8_FMT_OCT: base = 8; prefix = "0o"; break;
+    case C8_FMT_HEX: base = 16; prefix = "0x"; break;
+    case C8_FMT_SCI:
+    case C8_FMT_FIX: {
+      // Show the nearest real
+      struct c8obj* fo = (struct c8obj*)c8mpfr_create_c8obj(o);
+      c8obj_str(fo, buf, f);
+      c8obj_unref(fo);
+      return;
+    }
+  }
+
+  // Written as a division, which reads back as the same value
+  c8buf_append_str(buf, prefix);
+  c8fmt_mpz_append(buf, mpq_numref(q), base);
+  if (mpz_cmp_ui(mpq_denref(q), 1) != 0) {
+    c8buf_append_str(buf, "/");
+    c8buf_append_str(buf, prefix);
+    c8fmt_mpz_append(buf, mpq_denref(q), base);
+  }
+}
+
+static struct c8obj* c8mpq_pow(struct c8mpq* oo, struct c8obj* p,
+                               const struct c8mpq* np)
+{
+  mpq_srcptr e = c8mpq_canonical(np);
+  if (mpz_cmp_ui(mpq_denref(e), 1) != 0 ||
+      !mpz_fits_slong_p(mpq_numref(e)) ||
+      (mpz_sgn(mpq_numref(e)) < 0 && mpq_sgn(oo->value) == 0)) {
+    // Not exact as a rational
+    return c8num_op_real((struct c8obj*)oo, C8_OP_POWER, p);
+  }
+  long n = mpz_get_si(mpq_numref(e));
+  unsigned long un = (n < 0) ? -(unsigned long)n : (unsigned long)n;
+  struct c8mpq* nr = c8mpq_create();
+  mpz_ptr rn = mpq_numref(nr->value);
+  mpz_ptr rd = mpq_denref(nr->value);
+  if (n < 0) {
+    mpz_pow_ui(rn, mpq_denref(oo->value), un);
+    mpz_pow_ui(rd, mpq_numref(oo->value), un);
+    if (mpz_sgn(rd) < 0) {
+      mpz_neg(rn, rn);
+      mpz_neg(rd, rd);
+    }
+  } else {
+    mpz_pow_ui(rn, mpq_numref(oo->value), un);
+    mpz_pow_ui(rd, mpq_denref(oo->value), un);
+  }
+  // Powers of a reduced fraction are also reduced
+  nr->canonical = oo->canonical;
+  return c8mpq_result(nr);
+}
+
+static struct c8obj* c8mpq_binary_op(struct c8mpq* oo, int op,
+                                     struct c8obj* p, const struct c8mpq* np)
+{
+  switch (op) {
+    case C8_OP_DIVIDE:
+      if (mpq_sgn(np->value) == 0) {
+        return c8num_op_real((struct c8obj*)oo, op, p);
+      }
+      // Fall through
+    case C8_OP_ADD:
+    case C8_OP_SUBTRACT:
+    case C8_OP_MULTIPLY: {
+      struct c8mpq* nr = c8mpq_create();
+      c8mpq_arith(nr->value, oo->value, op, np->value);
+      nr->canonical = 0;
+      return c8mpq_result(nr);
+    }
+    case C8_OP_POWER:
+      return c8mpq_pow(oo, p, np);
+
+    case C8_OP_EQUALITY:
+      return (struct c8obj*)
+        c8bool_create(mpq_equal(c8mpq_canonical(oo), c8mpq_canonical(np)));
+    case C8_OP_INEQUALITY:
+      return (struct c8obj*)
+        c8bool_create(!mpq_equal(c8mpq_canonical(oo), c8mpq_canonical(np)));
+    case C8_OP_GREATER:
+      return (struct c8obj*)
+        c8bool_create(mpq_cmp(c8mpq_canonical(oo), c8mpq_canonical(np)) > 0);
+    case C8_OP_LESS:
+      return (struct c8obj*)
+        c8bool_create(mpq_cmp(c8mpq_canonical(oo), c8mpq_canonical(np)) < 0);
+    case C8_OP_GREATER_OR_EQUAL:
+      return (struct c8obj*)
+        c8bool_create(mpq_cmp(c8mpq_canonical(oo), c8mpq_canonical(np)) >= 0);
+    case C8_OP_LESS_OR_EQUAL:
+      return (struct c8obj*)
+        c8bool_create(mpq_cmp(c8mpq_canonical(oo), c8mpq_canonical(np)) <= 0);
+
+    case C8_OP_ASSIGN:
+      if (oo != np) {
+        mpq_set(oo->value, np->value);
+        oo->canonical = np->canonical;
+      }
+      return c8obj_ref((struct c8obj*)oo);
+    case C8_OP_DIVIDE_ASSIGN:
+      if (mpq_sgn(np->value) == 0) {
+        return c8num_op_real((struct c8obj*)oo, op, p);
+      }
+      // Fall through
+    case C8_OP_ADD_ASSIGN:
+    case C8_OP_SUBTRACT_ASSIGN:
+    case C8_OP_MULTIPLY_ASSIGN: {
+      int aop = C8_OP_ADD;
+      switch (op) {
+        case C8_OP_SUBTRACT_ASSIGN: aop = C8_OP_SUBTRACT; break;
+        case C8_OP_MULTIPLY_ASSIGN: aop = C8_OP_MULTIPLY; break;
+        case C8_OP_DIVIDE_ASSIGN: aop = C8_OP_DIVIDE; break;
+      }
+      c8mpq_arith(oo->value, oo->value, aop, np->value);
+      oo->canonical = 0;
+      if (mpz_size(mpq_denref(oo->value)) >= C8MPQ_LAZY_LIMBS) {
+        c8mpq_canonical(oo);
+      }
+      return c8obj_ref((struct c8obj*)oo);
+    }
+  }
+  return 0;
+}
+
+static const int c8mpq_kernel_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8mpq_kernel(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpq_binary_op((struct c8mpq*)o, op, p, (struct c8mpq*)p);
+}
+
+static struct c8obj* c8mpq_kernel_z(struct c8obj* o, int op, struct c8obj* p)
+{
+  struct c8mpq view;
+  const mp_limb_t one = 1;
+  c8mpq_view_mpz(&view, c8mpz_value((struct c8mpz*)p), &one);
+  return c8mpq_binary_op((struct c8mpq*)o, op, p, &view);
+}
+
+// Operations with an integer on the left, which aren't done in place
+static const int c8mpq_kernel_zq_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_POWER,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8mpq_kernel_zq(struct c8obj* o, int op, struct c8obj* p)
+{
+  struct c8mpq* no = c8mpq_create_c8obj(o);
+  struct c8obj* r = c8mpq_binary_op(no, op, p, (struct c8mpq*)p);
+  c8obj_unref((struct c8obj*)no);
+  return r;
+}
+
+static struct c8obj* c8mpq_lookup(struct c8obj* o, const char* name)
+{
+  if (strcmp("abs", name)==0) return (struct c8obj*)c8func_create_method(c8mpq_abs, o);
+  if (strcmp("num", name)==0) return (struct c8obj*)c8func_create_method(c8mpq_num, o);
+  if (strcmp("den", name)==0) return (struct c8obj*)c8func_create_method(c8mpq_den, o);
+  return 0;
+}
+
+static struct c8obj* c8mpq_op(struct c8obj* o, int op, struct c8obj* p)
+{
+  struct c8mpq* oo = to_c8mpq(o);
+  assert(oo);
+
+  switch (op) {
+    case C8_OP_LOOKUP: {
+      struct c8buf nb; c8buf_init(&nb);
+      c8obj_str(p, &nb, 0);
+      struct c8obj* ret = c8mpq_lookup(o, c8buf_str(&nb));
+      c8buf_clear(&nb);
+      // Other methods are those of the nearest real
+      if (!ret) ret = c8num_op_real(o, op, p);
+      return ret;
+    }
+    case C8_OP_POSITIVE:
+      return c8mpq_copy(o);
+    case C8_OP_NEGATIVE: {
+      struct c8mpq* nr = (struct c8mpq*)c8mpq_copy(o);
+      mpq_neg(nr->value, nr->value);
+      return (struct c8obj*)nr;
+    }
+    case C8_OP_PRE_INC:
+    case C8_OP_PRE_DEC:
+    case C8_OP_POST_INC:
+    case C8_OP_POST_DEC: {
+      struct c8obj* nr = 0;
+      if (C8_OP_POST_INC == op || C8_OP_POST_DEC == op) nr = c8mpq_copy(o);
+      mpz_ptr n = mpq_numref(oo->value);
+      if (C8_OP_PRE_INC == op || C8_OP_POST_INC == op) {
+        mpz_add(n, n, mpq_denref(oo->value));
+      } else {
+        mpz_sub(n, n, mpq_denref(oo->value));
+      }
+      return nr ? nr : c8obj_ref(o);
+    }
+    case C8_OP_FACTORIAL: {
+      mpq_srcptr q = c8mpq_canonical(oo);
+      if (mpz_cmp_ui(mpq_denref(q), 1) != 0) {
+        return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+      }
+      struct c8obj* nz = (struct c8obj*)c8mpz_create_mpz(mpq_numref(q));
+      struct c8obj* r = c8obj_op(nz, op, 0);
+      c8obj_unref(nz);
+      return r;
+    }
+  }
+
+  // Anything else is done as a real
+  return c8num_op_real(o, op, p);
+}
+
+static void c8mpq_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8mpq* oo = to_const_c8mpq(o);
+  assert(oo);
+  st->limb_bytes = (mpq_numref(oo->value)->_mp_alloc +
+                    mpq_denref(oo->value)->_mp_alloc) * sizeof(mp_limb_t);
+  st->bytes = sizeof(struct c8mpq) + st->limb_bytes;
+}
+
+static const struct c8obj_imp c8mpq_imp = {
+  c8mpq_destroy,
+  c8mpq_copy,
+  c8mpq_int,
+  c8mpq_str,
+  c8mpq_op,
+  0,
+  c8mpq_stat,
+  "mpq"
+};
+
+const struct c8mpq* to_const_c8mpq(const struct c8obj* o)
+{
+  const struct c8num* on = to_const_c8num(o);
+  return (on && on->imp && on->imp == &c8mpq_imp) ?
+    (const struct c8mpq*)o : 0;
+}
+
+struct c8mpq* to_c8mpq(struct c8obj* o)
+{
+  return (struct c8mpq*)to_const_c8mpq(o);
+}
+
+struct c8mpq* c8mpq_create()
+{
+  struct c8mpq* oo = (struct c8mpq*)c8heap_alloc(sizeof(struct c8mpq));
+  assert(oo);
+  c8num_init(&oo->base, &c8mpq_imp);
+  mpq_init(oo->value);
+  oo->canonical = 1;
+  return oo;
+}
+
+struct c8mpq* c8mpq_create_mpq(mpq_srcptr value)
+{
+  assert(mpz_sgn(mpq_denref(value)) > 0);
+  struct c8mpq* oo = c8mpq_create();
+  mpq_set(oo->value, value);
+  oo->canonical = 0;
+  return oo;
+}
+
+struct c8mpq* c8mpq_create_str(const char* str)
+{
+  struct c8mpq* oo = c8mpq_create();
+  int len = strlen(str);
+  int base = 10;
+  if (len > 2 && str[0] == '0') {
+    switch (str[1]) {
+      case 'b': base = 2; str+=2; break;
+      case 'o': base = 8; str+=2; break;
+      case 'd': base = 10; str+=2; break;
+      case 'x': base = 16; str+=2; break;
+    }
+  }
+  if (mpq_set_str(oo->value, str, base) != 0 ||
+      mpz_sgn(mpq_denref(oo->value)) == 0) {
+    mpq_set_ui(oo->value, 0, 1);
+  }
+  mpq_canonicalize(oo->value);
+  return oo;
+}
+
+// Convert an mpfr value exactly
+static struct c8mpq* c8mpq_create_mpfr(mpfr_srcptr value)
+{
+  struct c8mpq* oo = c8mpq_create();
+  if (mpfr_number_p(value)) mpfr_get_q(oo->value, value);
+  return oo;
+}
+
+struct c8mpq* c8mpq_create_c8obj(const struct c8obj* obj)
+{
+  assert(obj);
+  const struct c8mpq* qo = to_const_c8mpq(obj);
+  if (qo) return (struct c8mpq*)c8mpq_copy(obj);
+  const struct c8mpz* zo = to_const_c8mpz(obj);
+  if (zo) {
+    struct c8mpq* oo = c8mpq_create();
+    mpz_set(mpq_numref(oo->value), c8mpz_value(zo));
+    return oo;
+  }
+  const struct c8mpfr* fo = to_const_c8mpfr(obj);
+  if (fo) return c8mpq_create_mpfr(c8mpfr_value(fo));
+  const struct c8mpc* co = to_const_c8mpc(obj);
+  if (co) return c8mpq_create_mpfr(mpc_realref(c8mpc_value(co)));
+  const struct c8f64* ro = to_const_c8f64(obj);
+  if (ro) {
+    struct c8mpq* oo = c8mpq_create();
+    double d = c8f64_value(ro);
+    if (isfinite(d)) mpq_set_d(oo->value, d);
+    return oo;
+  }
+  struct c8buf buf; c8buf_init(&buf);
+  c8obj_str(obj, &buf, C8_FMT_DEC);
+  struct c8mpq* oo = c8mpq_create_str(c8buf_len(&buf) ? c8buf_str(&buf) : "");
+  c8buf_clear(&buf);
+  return oo;
+}
+
+mpq_srcptr c8mpq_value(const struct c8mpq* oo)
+{
+  assert(oo);
+  return oo->value;
+}
+
+static struct c8num* c8mpq_rational_convert(const struct c8obj* o)
+{
+  return (struct c8num*)c8mpq_create_c8obj(o);
+}
+
+void c8mpq_init_ctx(struct c8ctx* ctx)
+{
+  int t = c8num_register_type(&c8mpq_imp, C8NUM_RANK_RATIONAL,
+                              c8mpq_rational_convert);
+  c8num_register_kernel(t, t, c8mpq_kernel_ops, c8mpq_kernel);
+  int z = c8num_type_id("mpz");
+  c8num_register_kernel(t, z, c8mpq_kernel_ops, c8mpq_kernel_z);
+  c8num_register_kernel(z, t, c8mpq_kernel_zq_ops, c8mpq_kernel_zq);
+}
+
+/* Get the single argument, which must be a c8mpq
+ */
+static struct c8mpq* c8mpq_single_arg(struct c8list* args)
+{
+  if (c8list_size(args) != 1) return 0;
+  return to_c8mpq(c8list_peek(args, 0));
+}
+
+struct c8obj* c8mpq_abs(struct c8list* args)
+{
+  struct c8mpq* na = c8mpq_single_arg(args);
+  if (!na)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8mpq* nr = (struct c8mpq*)c8mpq_copy((struct c8obj*)na);
+  mpq_abs(nr->value, nr->value);
+  return (struct c8obj*)nr;
+}
+
+struct c8obj* c8mpq_num(struct c8list* args)
+{
+  struct c8mpq* na = c8mpq_single_arg(args);
+  if (!na)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  return (struct c8obj*)c8mpz_create_mpz(mpq_numref(c8mpq_canonical(na)));
+}
+
+struct c8obj* c8mpq_den(struct c8list* args)
+{
+  struct c8mpq* na = c8mpq_single_arg(args);
+  if (!na)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  return (struct c8obj*)c8mpz_create_mpz(mpq_denref(c8mpq_canonical(na)));
+}
@@ -0,0 +1,59 @@
+/** c8mpq - numeric object using GNU mpq
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gmp.h>
+
+struct c8mpq;
+struct c8obj;
+struct c8ctx;
+struct c8list;
+
+/** Safe casts from c8obj
+ */
+const struct c8mpq* to_const_c8mpq(const struct c8obj* o);
+struct c8mpq* to_c8mpq(struct c8obj* o);
+
+/** Create a c8mpq object
+ */
+struct c8mpq* c8mpq_create();
+struct c8mpq* c8mpq_create_str(const char* str);
+struct c8mpq* c8mpq_create_c8obj(const struct c8obj* obj);
+
+/** Create a c8mpq object from a value with a positive denominator, which
+ * need not be in lowest terms
+ */
+struct c8mpq* c8mpq_create_mpq(mpq_srcptr value);
+
+/** Get the value, which must not be modified. It may not be in lowest
+ * terms, but the denominator is always positive.
+ */
+mpq_srcptr c8mpq_value(const struct c8mpq* oo);
+
+/** Add mpq functions to context
+ */
+void c8mpq_init_ctx(struct c8ctx* ctx);
+
+/** Functions
+ */
+struct c8obj* c8mpq_abs(struct c8list* args);
+struct c8obj* c8mpq_num(struct c8list* args);
+struct c8obj* c8mpq_den(struct c8list* args);
@@ -27,44 +27,159 @@
 #include "c8bool.h"
 #include "c8list.h"
 #include "c8func.h"
+#include "c8mpq.h"
 #include "c8mpfr.h"
+#include "c8mpc.h"
+#include "c8f64.h"
 #include "c8ctx.h"
 #include "c8list.h"
 #include "c8error.h"
+#include "c8heap.h"
+#include "c8prod.h"
+#include "c8memo.h"
+#include "c8fmt.h"
+#include "c8map.h"
 
 #include <gmp.h>
+#include <mpfr.h>
+#include <mpc.h>
+#include <math.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stddef.h>
+
+// Value storage, shared between copies until one of them is modified.
+// Small values keep their limbs inline, spilling to limbs managed by GMP
+// when they grow. Each object embeds storage for its own value, so a small
+// number is a single allocation.
+#define C8MPZ_INLINE_LIMBS 4
+
+// Room to request for results of unknown size, which GMP then grows
+#define C8MPZ_GROW (C8MPZ_INLINE_LIMBS + 1)
+
+struct c8mpz_value {
+  int refs;
+  int embedded; // 1 if embedded in an object, -1 once that is destroyed
+  mpz_t value;
+  mp_limb_t limbs[C8MPZ_INLINE_LIMBS];
+};
 
 struct c8mpz {
   struct c8num base;
-  mpz_t value;
+  struct c8mpz_value* v;
+  struct c8mpz_value own;
 };
 
-struct c8mpz* c8mpz_create_mpz(const mpz_t value);
+static void c8mpz_value_init(struct c8mpz_value* v, int embedded)
+{
+  v->refs = 1;
+  v->embedded = embedded;
+  v->value->_mp_alloc = C8MPZ_INLINE_LIMBS;
+  v->value->_mp_size = 0;
+  v->value->_mp_d = v->limbs;
+}
+
+static struct c8mpz_value* c8mpz_value_create()
+{
+  struct c8mpz_value* v = malloc(sizeof(struct c8mpz_value));
+  assert(v);
+  c8mpz_value_init(v, 0);
+  return v;
+}
+
+static void c8mpz_value_unref(struct c8mpz_value* v)
+{
+  assert(v->refs > 0);
+  if (--v->refs) return;
+  if (v->value->_mp_d != v->limbs) mpz_clear(v->value);
+  if (v->embedded == 0) {
+    free(v);
+  } else if (v->embedded < 0) {
+    // Last user of a destroyed object's value, so free the object
+    c8heap_free((char*)v - offsetof(struct c8mpz, own));
+  }
+}
+
+// Ensure there is room for n limbs, which GMP must not need to exceed
+// while the limbs are inline
+static mpz_ptr c8mpz_value_reserve(struct c8mpz_value* v, size_t n)
+{
+  if (v->value->_mp_d == v->limbs && n > C8MPZ_INLINE_LIMBS) {
+    mpz_t t;
+    mpz_init2(t, n * GMP_NUMB_BITS);
+    mpz_set(t, v->value);
+    mpz_swap(t, v->value); // t now refers to the inline limbs
+  }
+  return v->value;
+}
+
+// Get the value of a new object for writing a result of up to n limbs
+static mpz_ptr c8mpz_reserve(struct c8mpz* oo, size_t n)
+{
+  return c8mpz_value_reserve(oo->v, n);
+}
+
+// Get the value for modification, copying it first if it is shared
+static mpz_ptr c8mpz_own(struct c8mpz* oo, size_t n)
+{
+  struct c8mpz_value* v = oo->v;
+  if (v->refs > 1) {
+    struct c8mpz_value* nv = &oo->own;
+    if (nv->refs == 0) {
+      c8mpz_value_init(nv, 1);
+    } else {
+      nv = c8mpz_value_create();
+    }
+    mpz_set(c8mpz_value_reserve(nv, mpz_size(v->value)), v->value);
+    --v->refs;
+    oo->v = nv;
+  }
+  return c8mpz_value_reserve(oo->v, n);
+}
+
+// Make this object take the value of np
+static void c8mpz_share(struct c8mpz* oo, const struct c8mpz* np)
+{
+  if (oo->v == np->v) return;
+  size_t n = mpz_size(np->v->value);
+  if (n <= C8MPZ_INLINE_LIMBS) {
+    // Small values are copied, rather than tying the objects together
+    mpz_set(c8mpz_own(oo, n), np->v->value);
+  } else {
+    ++np->v->refs;
+    c8mpz_value_unref(oo->v);
+    oo->v = np->v;
+  }
+}
 
 static void c8mpz_destroy(struct c8obj* o)
 {
   struct c8mpz* oo = to_c8mpz(o);
   assert(oo);
-  mpz_clear(oo->value);
-  free(oo);
+  // If copies still share the embedded value, the last of them frees this
+  struct c8mpz_value* v = oo->v;
+  int unused = (v != &oo->own && oo->own.refs == 0);
+  oo->own.embedded = -1;
+  c8mpz_value_unref(v);
+  if (unused) c8heap_free(oo);
 }
 
 static struct c8obj* c8mpz_copy(const struct c8obj* o)
 {
   const struct c8mpz* oo = to_const_c8mpz(o);
   assert(oo);
-  return (struct c8obj*)c8mpz_create_mpz(oo->value);
+  struct c8mpz* nr = c8mpz_create();
+  c8mpz_share(nr, oo);
+  return (struct c8obj*)nr;
 }
 
 static int c8mpz_int(const struct c8obj* o)
 {
   const struct c8mpz* oo = to_const_c8mpz(o);
   assert(oo);
-  return (int)mpz_get_si(oo->value);
+  return (int)mpz_get_si(oo->v->value);
 }
 
 static void c8mpz_str(const struct c8obj* o, struct c8buf* buf, int f)
@@ -78,124 +193,327 @@ static void c8mpz_str(const struct c8obj* o, struct c8buf* buf, int f)
     case C8_FMT_HEX: base = 16; break;
   }
 
-  char* cs = mpz_get_str(0, base, oo->value);
-  if (cs) {
-    switch (base) {
-      case 2: c8buf_append_str(buf, "0b"); break;
-      case 8: c8buf_append_str(buf, "0o"); break;
-      case 16: c8buf_append_str(buf, "0x"); break;
-    }
-    c8buf_append_str(buf, cs);
-    free(cs);
+  switch (base) {
+    case 2: c8buf_append_str(buf, "0b"); break;
+    case 8: c8buf_append_str(buf, "0o"); break;
+    case 16: c8buf_append_str(buf, "0x"); break;
   }
+  c8fmt_mpz_append(buf, oo->v->value, base);
 }
 
 static struct c8obj* c8mpz_binary_op(struct c8mpz* oo, int op,
                                      struct c8mpz* np)
 {
+  size_t us = mpz_size(oo->v->value);
+  size_t vs = mpz_size(np->v->value);
+  size_t ms = (us > vs ? us : vs) + 1;
+
   switch (op) {
     case C8_OP_ADD: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_add(nr->value, oo->value, np->value);
+      mpz_add(c8mpz_reserve(nr, ms), oo->v->value, np->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_SUBTRACT: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_sub(nr->value, oo->value, np->value);
+      mpz_sub(c8mpz_reserve(nr, ms), oo->v->value, np->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_MULTIPLY: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_mul(nr->value, oo->value, np->value);
+      mpz_mul(c8mpz_reserve(nr, us + vs), oo->v->value, np->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_DIVIDE: {
-      if (mpz_divisible_p(oo->value, np->value)) {
+      if (mpz_sgn(np->v->value) == 0) {
+        return c8num_op_real((struct c8obj*)oo, op, (struct c8obj*)np);
+      }
+      if (mpz_divisible_p(oo->v->value, np->v->value)) {
         struct c8mpz* nr = c8mpz_create();
-        mpz_tdiv_q(nr->value, oo->value, np->value);
+        mpz_tdiv_q(c8mpz_reserve(nr, us + 1), oo->v->value, np->v->value);
         return (struct c8obj*)nr;
       }
-      return (struct c8obj*)c8error_create(C8_ERROR_PRECISION_REAL);
+      return c8num_op_rank(C8NUM_RANK_RATIONAL, (struct c8obj*)oo, op, (struct c8obj*)np);
     }
     case C8_OP_MODULUS: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_tdiv_r(nr->value, oo->value, np->value);
+      mpz_tdiv_r(c8mpz_reserve(nr, ms), oo->v->value, np->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_POWER: {
+      if (mpz_sgn(np->v->value) < 0) {
+        return c8num_op_rank(C8NUM_RANK_RATIONAL, (struct c8obj*)oo, op, (struct c8obj*)np);
+      }
       struct c8mpz* nr = c8mpz_create();
-      mpz_pow_ui(nr->value, oo->value, mpz_get_ui(np->value));
+      mpz_pow_ui(c8mpz_reserve(nr, C8MPZ_GROW), oo->v->value, mpz_get_ui(np->v->value));
       return (struct c8obj*)nr;
     }
     case C8_OP_BIT_OR: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_ior(nr->value, oo->value, np->value);
+      mpz_ior(c8mpz_reserve(nr, ms), oo->v->value, np->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_BIT_XOR: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_xor(nr->value, oo->value, np->value);
+      mpz_xor(c8mpz_reserve(nr, ms), oo->v->value, np->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_BIT_AND: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_and(nr->value, oo->value, np->value);
+      mpz_and(c8mpz_reserve(nr, ms), oo->v->value, np->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_SHIFT_LEFT: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_mul_2exp(nr->value, oo->value, mpz_get_si(np->value));
+      mpz_mul_2exp(c8mpz_reserve(nr, C8MPZ_GROW), oo->v->value, mpz_get_si(np->v->value));
       return (struct c8obj*)nr;
     }
     case C8_OP_SHIFT_RIGHT: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_tdiv_q_2exp(nr->value, oo->value, mpz_get_si(np->value));
+      mpz_tdiv_q_2exp(c8mpz_reserve(nr, us + 1), oo->v->value, mpz_get_si(np->v->value));
       return (struct c8obj*)nr;
     }
 
     case C8_OP_EQUALITY:
-      return (struct c8obj*)c8bool_create(mpz_cmp(oo->value, np->value) == 0);
+      return (struct c8obj*)c8bool_create(mpz_cmp(oo->v->value, np->v->value) == 0);
     case C8_OP_INEQUALITY:
-      return (struct c8obj*)c8bool_create(mpz_cmp(oo->value, np->value) != 0);
+      return (struct c8obj*)c8bool_create(mpz_cmp(oo->v->value, np->v->value) != 0);
     case C8_OP_GREATER:
-      return (struct c8obj*)c8bool_create(mpz_cmp(oo->value, np->value) > 0);
+      return (struct c8obj*)c8bool_create(mpz_cmp(oo->v->value, np->v->value) > 0);
     case C8_OP_LESS:
-      return (struct c8obj*)c8bool_create(mpz_cmp(oo->value, np->value) < 0);
+      return (struct c8obj*)c8bool_create(mpz_cmp(oo->v->value, np->v->value) < 0);
     case C8_OP_GREATER_OR_EQUAL:
-      return (struct c8obj*)c8bool_create(mpz_cmp(oo->value, np->value) >= 0);
+      return (struct c8obj*)c8bool_create(mpz_cmp(oo->v->value, np->v->value) >= 0);
     case C8_OP_LESS_OR_EQUAL:
-      return (struct c8obj*)c8bool_create(mpz_cmp(oo->value, np->value) <= 0);
+      return (struct c8obj*)c8bool_create(mpz_cmp(oo->v->value, np->v->value) <= 0);
 
     case C8_OP_ASSIGN: {
-      mpz_set(oo->value, np->value);
+      c8mpz_share(oo, np);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_ADD_ASSIGN: {
-      mpz_add(oo->value, oo->value, np->value);
+      mpz_ptr r = c8mpz_own(oo, ms);
+      mpz_add(r, r, np->v->value);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_SUBTRACT_ASSIGN: {
-      mpz_sub(oo->value, oo->value, np->value);
+      mpz_ptr r = c8mpz_own(oo, ms);
+      mpz_sub(r, r, np->v->value);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_MULTIPLY_ASSIGN: {
-      mpz_mul(oo->value, oo->value, np->value);
+      mpz_ptr r = c8mpz_own(oo, us + vs);
+      mpz_mul(r, r, np->v->value);
       return c8obj_ref((struct c8obj*)oo);
     }
     case C8_OP_DIVIDE_ASSIGN: {
-      mpz_tdiv_q(oo->value, oo->value, np->value);
+      mpz_ptr r = c8mpz_own(oo, us + 1);
+      mpz_tdiv_q(r, r, np->v->value);
       return c8obj_ref((struct c8obj*)oo);
     }
   }
   return 0;
 }
 
+static const int c8mpz_kernel_ops[] = {
+  C8_OP_ADD, C8_OP_SUBTRACT, C8_OP_MULTIPLY, C8_OP_DIVIDE, C8_OP_MODULUS,
+  C8_OP_POWER, C8_OP_BIT_OR, C8_OP_BIT_XOR, C8_OP_BIT_AND,
+  C8_OP_SHIFT_LEFT, C8_OP_SHIFT_RIGHT,
+  C8_OP_EQUALITY, C8_OP_INEQUALITY, C8_OP_GREATER, C8_OP_LESS,
+  C8_OP_GREATER_OR_EQUAL, C8_OP_LESS_OR_EQUAL,
+  C8_OP_ASSIGN, C8_OP_ADD_ASSIGN, C8_OP_SUBTRACT_ASSIGN,
+  C8_OP_MULTIPLY_ASSIGN, C8_OP_DIVIDE_ASSIGN,
+  C8_OP_UNKNOWN
+};
+
+static struct c8obj* c8mpz_kernel(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8mpz_binary_op((struct c8mpz*)o, op, (struct c8mpz*)p);
+}
+
+static struct c8obj* c8mpz_fma(struct c8obj* a, struct c8obj* b,
+                               struct c8obj* c, int form)
+{
+  mpz_srcptr av = ((struct c8mpz*)a)->v->value;
+  mpz_srcptr bv = ((struct c8mpz*)b)->v->value;
+  struct c8mpz* oc = (struct c8mpz*)c;
+  size_t ps = mpz_size(av) + mpz_size(bv);
+  size_t cs = mpz_size(oc->v->value);
+  size_t ms = (ps > cs ? ps : cs) + 1;
+
+  struct c8mpz* nr = oc;
+  if (C8NUM_FMA_ASSIGN == form || C8NUM_FNMA_ASSIGN == form) {
+    c8obj_ref(c);
+  } else {
+    nr = c8mpz_create();
+    mpz_set(c8mpz_reserve(nr, ms), oc->v->value);
+  }
+  mpz_ptr r = c8mpz_own(nr, ms);
+  switch (form) {
+    case C8NUM_FMS:
+      mpz_neg(r, r);
+      // Fall through
+    case C8NUM_FMA:
+    case C8NUM_FMA_ASSIGN:
+      mpz_addmul(r, av, bv);
+      break;
+    case C8NUM_FNMA:
+    case C8NUM_FNMA_ASSIGN:
+      mpz_submul(r, av, bv);
+      break;
+  }
+  return (struct c8obj*)nr;
+}
+
+// Contexts for recently used moduli. A base which is used again with the
+// same large modulus gets a table of its powers, after which exponentiation
+// needs about bits/w + 2^w multiplications rather than bits squarings.
+#define C8MPZ_MOD_CTXS 4
+#define C8MPZ_FIXED_BASE_BITS 1024
+
+struct c8mpz_modctx {
+  mpz_t mod;
+  mpz_t base;
+  int base_uses;
+  mpz_t* table; // base^(2^(w*i)) mod m
+  int len;
+  int w;
+};
+
+static struct c8mpz_modctx c8mpz_modctxs[C8MPZ_MOD_CTXS];
+static int c8mpz_nmodctxs = 0;
+static int c8mpz_next_modctx = 0;
+
+static void c8mpz_modctx_clear_table(struct c8mpz_modctx* c)
+{
+  for (int i=0; i<c->len; ++i) mpz_clear(c->table[i]);
+  free(c->table);
+  c->table = 0;
+  c->len = 0;
+}
+
+// Get the context for a modulus, which must be positive
+static struct c8mpz_modctx* c8mpz_modctx(mpz_srcptr m)
+{
+  for (int i=0; i<c8mpz_nmodctxs; ++i) {
+    if (mpz_cmp(c8mpz_modctxs[i].mod, m) == 0) return &c8mpz_modctxs[i];
+  }
+  struct c8mpz_modctx* c = &c8mpz_modctxs[c8mpz_next_modctx];
+  c8mpz_next_modctx = (c8mpz_next_modctx + 1) % C8MPZ_MOD_CTXS;
+  if (c8mpz_nmodctxs < C8MPZ_MOD_CTXS) {
+    ++c8mpz_nmodctxs;
+    mpz_init(c->mod);
+    mpz_init(c->base);
+  } else {
+    c8mpz_modctx_clear_table(c);
+  }
+  mpz_set(c->mod, m);
+  mpz_set_ui(c->base, 0);
+  c->base_uses = 0;
+  return c;
+}
+
+// Build the table of powers of b for exponents of up to bits
+static void c8mpz_modctx_build(struct c8mpz_modctx* c, mpz_srcptr b,
+                               mp_bitcnt_t bits)
+{
+  c8mpz_modctx_clear_table(c);
+  long best = 0;
+  for (int w=1; w<=8; ++w) {
+    long cost = (long)((bits + w - 1) / w) + (1L << w);
+    if (!best || cost < best) { best = cost; c->w = w; }
+  }
+  c->len = (bits + c->w - 1) / c->w;
+  c->table = malloc(c->len * sizeof(mpz_t));
+  assert(c->table);
+  mpz_init(c->table[0]);
+  mpz_mod(c->table[0], b, c->mod);
+  for (int i=1; i<c->len; ++i) {
+    mpz_init(c->table[i]);
+    mpz_powm_ui(c->table[i], c->table[i-1], 1UL << c->w, c->mod);
+  }
+}
+
+// r = b^e mod m for e >= 0, using the context's table if there is one for b
+static void c8mpz_modctx_powm(struct c8mpz_modctx* c, mpz_ptr r,
+                              mpz_srcptr b, mpz_srcptr e)
+{
+  mp_bitcnt_t bits = mpz_sizeinbase(e, 2);
+  if (mpz_sizeinbase(c->mod, 2) >= C8MPZ_FIXED_BASE_BITS) {
+    if (mpz_cmp(c->base, b) != 0) {
+      mpz_set(c->base, b);
+      c->base_uses = 0;
+      c8mpz_modctx_clear_table(c);
+    }
+    if (++c->base_uses == 2 || (c->table && bits > (mp_bitcnt_t)c->len * c->w)) {
+      mp_bitcnt_t mbits = mpz_sizeinbase(c->mod, 2);
+      c8mpz_modctx_build(c, b, bits > mbits ? bits : mbits);
+    }
+  }
+  if (!c->table || mpz_cmp(c->base, b) != 0) {
+    mpz_powm(r, b, e, c->mod);
+    return;
+  }
+
+  // Digits of e in base 2^w
+  unsigned char* d = malloc(c->len);
+  assert(d);
+  for (int i=0; i<c->len; ++i) {
+    d[i] = 0;
+    for (int j=0; j<c->w; ++j) d[i] |= mpz_tstbit(e, (mp_bitcnt_t)i*c->w + j) << j;
+  }
+  // The product of table[i]^d[i], as the product over j of the product of
+  // table[i] with d[i] >= j
+  mpz_t a;
+  mpz_init_set_ui(a, 1);
+  mpz_set_ui(r, 1);
+  for (int j=(1 << c->w)-1; j>=1; --j) {
+    for (int i=0; i<c->len; ++i) {
+      if (d[i] != j) continue;
+      mpz_mul(a, a, c->table[i]);
+      mpz_mod(a, a, c->mod);
+    }
+    mpz_mul(r, r, a);
+    mpz_mod(r, r, c->mod);
+  }
+  mpz_mod(r, r, c->mod);
+  mpz_clear(a);
+  free(d);
+}
+
+// (b ^ e) % m for the evaluator, keeping the sign of a truncating modulus
+static struct c8obj* c8mpz_powmod_op(struct c8obj* b, struct c8obj* e,
+                                     struct c8obj* m)
+{
+  mpz_srcptr bv = ((struct c8mpz*)b)->v->value;
+  mpz_srcptr ev = ((struct c8mpz*)e)->v->value;
+  mpz_srcptr mv = ((struct c8mpz*)m)->v->value;
+  if (mpz_sgn(ev) < 0 || mpz_sgn(mv) == 0) return 0;
+
+  mpz_t am;
+  mpz_init(am);
+  mpz_abs(am, mv);
+  struct c8mpz* nr = c8mpz_create();
+  mpz_t t;
+  mpz_init(t);
+  c8mpz_modctx_powm(c8mpz_modctx(am), t, bv, ev);
+  if (mpz_sgn(bv) < 0 && mpz_odd_p(ev) && mpz_sgn(t) != 0) mpz_sub(t, t, am);
+  mpz_set(c8mpz_reserve(nr, mpz_size(t)), t);
+  mpz_clear(t);
+  mpz_clear(am);
+  return (struct c8obj*)nr;
+}
+
 static struct c8obj* c8mpz_lookup(struct c8obj* o, const char* name)
 {
   if (strcmp("abs", name)==0) return (struct c8obj*)c8func_create_method(c8mpz_abs, o);
   if (strcmp("gcd", name)==0) return (struct c8obj*)c8func_create_method(c8mpz_gcd, o);
   if (strcmp("lcm", name)==0) return (struct c8obj*)c8func_create_method(c8mpz_lcm, o);
   if (strcmp("fib", name)==0) return (struct c8obj*)c8func_create_method(c8mpz_fib, o);
+  if (strcmp("binomial", name)==0) return (struct c8obj*)c8func_create_method(c8mpz_binomial, o);
+  if (strcmp("primorial", name)==0) return (struct c8obj*)c8func_create_method(c8mpz_primorial, o);
+  if (strcmp("powmod", name)==0) return (struct c8obj*)c8func_create_method(c8mpz_powmod, o);
+  if (strcmp("invmod", name)==0) return (struct c8obj*)c8func_create_method(c8mpz_invmod, o);
   return 0;
 }
 
@@ -212,53 +530,65 @@ static struct c8obj* c8mpz_op(struct c8obj* o, int op, struct c8obj* p)
       c8buf_clear(&nb);
       return ret;
     }
-    case C8_OP_POSITIVE: {
-      struct c8mpz* nr = c8mpz_create();
-      mpz_set(nr->value, oo->value);
-      return (struct c8obj*)nr;
-    }
+    case C8_OP_POSITIVE:
+      return c8mpz_copy(o);
     case C8_OP_NEGATIVE: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_neg(nr->value, oo->value);
+      mpz_neg(c8mpz_reserve(nr, mpz_size(oo->v->value)), oo->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_BIT_NOT: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_com(nr->value, oo->value);
+      mpz_com(c8mpz_reserve(nr, mpz_size(oo->v->value) + 1), oo->v->value);
       return (struct c8obj*)nr;
     }
     case C8_OP_PRE_INC: {
-      mpz_add_ui(oo->value, oo->value, 1);
+      mpz_ptr r = c8mpz_own(oo, mpz_size(oo->v->value) + 1);
+      mpz_add_ui(r, r, 1);
       c8obj_ref(o);
       return o;
     }
     case C8_OP_PRE_DEC: {
-      mpz_sub_ui(oo->value, oo->value, 1);
+      mpz_ptr r = c8mpz_own(oo, mpz_size(oo->v->value) + 1);
+      mpz_sub_ui(r, r, 1);
       c8obj_ref(o);
       return o;
     }
     case C8_OP_FACTORIAL: {
       struct c8mpz* nr = c8mpz_create();
-      mpz_fac_ui(nr->value, mpz_get_ui(oo->value));
+      c8memo_factorial(c8mpz_reserve(nr, C8MPZ_GROW), mpz_get_ui(oo->v->value));
       return (struct c8obj*)nr;
     }
     case C8_OP_POST_INC: {
-      struct c8mpz* nr = c8mpz_create_mpz(oo->value);
-      mpz_add_ui(oo->value, oo->value, 1);
-      return (struct c8obj*)nr;
+      struct c8obj* nr = c8mpz_copy(o);
+      mpz_ptr r = c8mpz_own(oo, mpz_size(oo->v->value) + 1);
+      mpz_add_ui(r, r, 1);
+      return nr;
     }
     case C8_OP_POST_DEC: {
-      struct c8mpz* nr = c8mpz_create_mpz(oo->value);
-      mpz_sub_ui(oo->value, oo->value, 1);
-      return (struct c8obj*)nr;
+      struct c8obj* nr = c8mpz_copy(o);
+      mpz_ptr r = c8mpz_own(oo, mpz_size(oo->v->value) + 1);
+      mpz_sub_ui(r, r, 1);
+      return nr;
     }
   }
 
   struct c8mpz* np = to_c8mpz(p);
   if (np) return c8mpz_binary_op(oo, op, np);
 
-  return (struct c8obj*)c8error_create(C8_ERROR_PRECISION_REAL);
-  //  return c8mpz_op_mpfr(oo, op, p);
+  return c8num_op_real(o, op, p);
+}
+
+static void c8mpz_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8mpz* oo = to_const_c8mpz(o);
+  assert(oo);
+  const struct c8mpz_value* v = oo->v;
+  size_t cell = (v == &oo->own) ? 0 : sizeof(struct c8mpz_value);
+  if (v->value->_mp_d != v->limbs) {
+    st->limb_bytes = v->value->_mp_alloc * sizeof(mp_limb_t) / v->refs;
+  }
+  st->bytes = sizeof(struct c8mpz) + cell / v->refs + st->limb_bytes;
 }
 
 static const struct c8obj_imp c8mpz_imp = {
@@ -266,7 +596,10 @@ static const struct c8obj_imp c8mpz_imp = {
   c8mpz_copy,
   c8mpz_int,
   c8mpz_str,
-  c8mpz_op
+  c8mpz_op,
+  0,
+  c8mpz_stat,
+  "mpz"
 };
 
 const struct c8mpz* to_const_c8mpz(const struct c8obj* o)
@@ -283,31 +616,32 @@ struct c8mpz* to_c8mpz(struct c8obj* o)
 
 struct c8mpz* c8mpz_create()
 {
-  struct c8mpz* oo = (struct c8mpz*)malloc(sizeof(struct c8mpz));
+  struct c8mpz* oo = (struct c8mpz*)c8heap_alloc(sizeof(struct c8mpz));
   assert(oo);
   c8num_init(&oo->base, &c8mpz_imp);
-  mpz_init(oo->value);
+  c8mpz_value_init(&oo->own, 1);
+  oo->v = &oo->own;
   return oo;
 }
 
 struct c8mpz* c8mpz_create_mpz(const mpz_t value)
 {
   struct c8mpz* oo = c8mpz_create();
-  mpz_set(oo->value, value);
+  mpz_set(c8mpz_reserve(oo, mpz_size(value)), value);
   return oo;
 }
 
 struct c8mpz* c8mpz_create_int(int value)
 {
   struct c8mpz* oo = c8mpz_create();
-  mpz_set_si(oo->value, value);
+  mpz_set_si(c8mpz_reserve(oo, 1), value);
   return oo;
 }
 
 struct c8mpz* c8mpz_create_double(double value)
 {
   struct c8mpz* oo = c8mpz_create();
-  mpz_set_d(oo->value, value);
+  mpz_set_d(c8mpz_reserve(oo, value > -1e18 && value < 1e18 ? 3 : C8MPZ_GROW), value);
   return oo;
 }
 
@@ -324,35 +658,100 @@ struct c8mpz* c8mpz_create_str(const char* str)
       case 'x': base = 16; str+=2; break;
     }
   }
-  mpz_set_str(oo->value, str, base);
+  mpz_set_str(c8mpz_reserve(oo, len / 16 + 3), str, base);
+  return oo;
+}
+
+// Convert an mpfr value, truncating towards zero
+static struct c8mpz* c8mpz_create_mpfr(mpfr_srcptr value)
+{
+  if (!mpfr_number_p(value)) return c8mpz_create_int(0);
+  if (mpfr_fits_slong_p(value, MPFR_RNDZ)) {
+    struct c8mpz* oo = c8mpz_create();
+    mpz_set_si(c8mpz_reserve(oo, 1), mpfr_get_si(value, MPFR_RNDZ));
+    return oo;
+  }
+  // MPFR reallocates the result itself, so it can't use inline limbs
+  mpz_t t;
+  mpz_init(t);
+  mpfr_get_z(t, value, MPFR_RNDZ);
+  struct c8mpz* oo = c8mpz_create_mpz(t);
+  mpz_clear(t);
+  return oo;
+}
+
+struct c8mpz* c8mpz_create_c8obj(const struct c8obj* obj)
+{
+  assert(obj);
+  const struct c8mpz* zo = to_const_c8mpz(obj);
+  if (zo) return c8mpz_create_mpz(zo->v->value);
+  const struct c8mpq* qo = to_const_c8mpq(obj);
+  if (qo) {
+    mpq_srcptr q = c8mpq_value(qo);
+    struct c8mpz* oo = c8mpz_create();
+    mpz_tdiv_q(c8mpz_reserve(oo, mpz_size(mpq_numref(q)) + 1),
+               mpq_numref(q), mpq_denref(q));
+    return oo;
+  }
+  const struct c8mpfr* fo = to_const_c8mpfr(obj);
+  if (fo) return c8mpz_create_mpfr(c8mpfr_value(fo));
+  const struct c8mpc* co = to_const_c8mpc(obj);
+  if (co) return c8mpz_create_mpfr(mpc_realref(c8mpc_value(co)));
+  const struct c8f64* ro = to_const_c8f64(obj);
+  if (ro) {
+    double d = c8f64_value(ro);
+    return c8mpz_create_double(isfinite(d) ? d : 0);
+  }
+  struct c8buf buf; c8buf_init(&buf);
+  c8obj_str(obj, &buf, C8_FMT_DEC);
+  struct c8mpz* oo = c8mpz_create_str(c8buf_len(&buf) ? c8buf_str(&buf) : "");
+  c8buf_clear(&buf);
   return oo;
 }
 
+mpz_srcptr c8mpz_value(const struct c8mpz* oo)
+{
+  assert(oo);
+  return oo->v->value;
+}
+
 static struct c8num* c8mpz_int_create(const char* str)
 {
   return (struct c8num*)c8mpz_create_str(str);
 }
 
+static struct c8num* c8mpz_int_convert(const struct c8obj* o)
+{
+  return (struct c8num*)c8mpz_create_c8obj(o);
+}
+
 void c8mpz_init_ctx(struct c8ctx* ctx)
 {
   c8num_register_int_create(c8mpz_int_create);
+  int t = c8num_register_type(&c8mpz_imp, C8NUM_RANK_INT, c8mpz_int_convert);
+  c8num_register_kernel(t, t, c8mpz_kernel_ops, c8mpz_kernel);
+  c8num_register_fma(t, c8mpz_fma);
+  c8num_register_powmod(t, c8mpz_powmod_op);
+
+  c8ctx_add(ctx, "product", (struct c8obj*)c8func_create(c8mpz_product));
+  c8ctx_add(ctx, "threads", (struct c8obj*)c8func_create(c8mpz_threads));
+  c8ctx_add(ctx, "memostats", (struct c8obj*)c8func_create(c8mpz_memostats));
+  c8ctx_add(ctx, "memolimit", (struct c8obj*)c8func_create(c8mpz_memolimit));
 }
 
 struct c8obj* c8mpz_abs(struct c8list* args)
 {
   if (c8list_size(args) != 1)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
   if (!a)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
   struct c8mpz* na = to_c8mpz(a);
-  struct c8mpz* nr = 0;
   if (na) {
-    nr = c8mpz_create();
-    mpz_abs(nr->value, na->value);
+    struct c8mpz* nr = c8mpz_create();
+    mpz_abs(c8mpz_reserve(nr, mpz_size(na->v->value)), na->v->value);
+    return (struct c8obj*)nr;
   }
-  c8obj_unref(a);
-  if (nr) return (struct c8obj*)nr;
   
   return c8mpfr_abs(args); // Go on to try the mpfr version
 }
@@ -362,24 +761,16 @@ struct c8obj* c8mpz_gcd(struct c8list* args)
   int n = c8list_size(args);
   if (n == 0)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
-  if (!a)
+  struct c8mpz* na = to_c8mpz(c8list_peek(args, 0));
+  if (!na)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8mpz* na = to_c8mpz(a);
-  struct c8mpz* nr = c8mpz_create_mpz(na->value);
+  struct c8mpz* nr = c8mpz_create_mpz(na->v->value);
   
   for (int i=1; i<n; ++i) {
-    struct c8obj* b = c8list_at(args, i);
-    if (a && b) {
-      struct c8mpz* nb = to_c8mpz(b);
-      if (nb) mpz_gcd(nr->value, nr->value, nb->value);
-      na = nb;
-    }
-    c8obj_unref(a);
-    a = b;
+    struct c8mpz* nb = to_c8mpz(c8list_peek(args, i));
+    if (nb) mpz_gcd(c8mpz_reserve(nr, C8MPZ_GROW), nr->v->value, nb->v->value);
   }
   
-  c8obj_unref(a);
   return (struct c8obj*)nr;
 }
 
@@ -388,24 +779,16 @@ struct c8obj* c8mpz_lcm(struct c8list* args)
   int n = c8list_size(args);
   if (n == 0)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
-  if (!a)
+  struct c8mpz* na = to_c8mpz(c8list_peek(args, 0));
+  if (!na)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8mpz* na = to_c8mpz(a);
-  struct c8mpz* nr = c8mpz_create_mpz(na->value);
+  struct c8mpz* nr = c8mpz_create_mpz(na->v->value);
   
   for (int i=1; i<n; ++i) {
-    struct c8obj* b = c8list_at(args, i);
-    if (a && b) {
-      struct c8mpz* nb = to_c8mpz(b);
-      if (nb) mpz_lcm(nr->value, nr->value, nb->value);
-      na = nb;
-    }
-    c8obj_unref(a);
-    a = b;
+    struct c8mpz* nb = to_c8mpz(c8list_peek(args, i));
+    if (nb) mpz_lcm(c8mpz_reserve(nr, C8MPZ_GROW), nr->v->value, nb->v->value);
   }
   
-  c8obj_unref(a);
   return (struct c8obj*)nr;
 }
 
@@ -413,15 +796,185 @@ struct c8obj* c8mpz_fib(struct c8list* args)
 {
   if (c8list_size(args) != 1)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
   if (!a)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
   struct c8mpz* na = to_c8mpz(a);
   struct c8mpz* nr = 0;
   if (na) {
     nr = c8mpz_create();
-    mpz_fib_ui(nr->value, mpz_get_ui(na->value));
+    c8memo_fib(c8mpz_reserve(nr, C8MPZ_GROW), mpz_get_ui(na->v->value));
+  }
+  return (struct c8obj*)nr;
+}
+
+struct c8obj* c8mpz_binomial(struct c8list* args)
+{
+  if (c8list_size(args) != 2)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8mpz* nn = to_c8mpz(c8list_peek(args, 0));
+  struct c8mpz* nk = to_c8mpz(c8list_peek(args, 1));
+  if (!nn || !nk || !mpz_fits_ulong_p(nn->v->value) || !mpz_fits_ulong_p(nk->v->value))
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8mpz* nr = c8mpz_create();
+  c8prod_binomial(c8mpz_reserve(nr, C8MPZ_GROW),
+                  mpz_get_ui(nn->v->value), mpz_get_ui(nk->v->value));
+  return (struct c8obj*)nr;
+}
+
+struct c8obj* c8mpz_primorial(struct c8list* args)
+{
+  if (c8list_size(args) != 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8mpz* na = to_c8mpz(c8list_peek(args, 0));
+  if (!na || !mpz_fits_ulong_p(na->v->value))
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8mpz* nr = c8mpz_create();
+  c8prod_primorial(c8mpz_reserve(nr, C8MPZ_GROW), mpz_get_ui(na->v->value));
+  return (struct c8obj*)nr;
+}
+
+struct c8obj* c8mpz_product(struct c8list* args)
+{
+  // Either a single list, or the arguments themselves
+  struct c8list* l = args;
+  if (c8list_size(args) == 1 && to_c8list(c8list_peek(args, 0)))
+    l = to_c8list(c8list_peek(args, 0));
+  int n = c8list_size(l);
+
+  // Integers go to the product tree
+  mpz_srcptr* v = malloc((n + 1) * sizeof(mpz_srcptr));
+  assert(v);
+  int i = 0;
+  for (; i<n; ++i) {
+    struct c8mpz* ni = to_c8mpz(c8list_peek(l, i));
+    if (!ni) break;
+    v[i] = ni->v->value;
+  }
+  struct c8mpz* nr = c8mpz_create();
+  mpz_t t;
+  mpz_init(t);
+  c8prod_mpz(t, v, i);
+  mpz_set(c8mpz_reserve(nr, mpz_size(t)), t);
+  mpz_clear(t);
+  free(v);
+
+  // Anything else is multiplied in order
+  struct c8obj* r = (struct c8obj*)nr;
+  for (; i<n && r; ++i) {
+    struct c8obj* x = c8obj_op(r, C8_OP_MULTIPLY, c8list_peek(l, i));
+    c8obj_unref(r);
+    r = x;
+  }
+  if (!r) return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  return r;
+}
+
+struct c8obj* c8mpz_threads(struct c8list* args)
+{
+  int n = c8list_size(args);
+  if (n > 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  if (n == 1) {
+    struct c8obj* a = c8list_peek(args, 0);
+    if (!a || c8obj_int(a) < 1)
+      return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+    c8prod_set_threads(c8obj_int(a));
+  }
+  return (struct c8obj*)c8mpz_create_int(c8prod_threads());
+}
+
+static void c8mpz_map_set(struct c8map* m, const char* key, double value)
+{
+  struct c8obj* v = (struct c8obj*)c8mpz_create_double(value);
+  c8map_set(m, key, v);
+  c8obj_unref(v);
+}
+
+struct c8obj* c8mpz_memostats(struct c8list* args)
+{
+  if (c8list_size(args) != 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8memo_stats stats[8];
+  int n = c8memo_stats(stats, 8);
+  struct c8map* m = c8map_create();
+  for (int i=0; i<n; ++i) {
+    struct c8map* ms = c8map_create();
+    c8mpz_map_set(ms, "entries", stats[i].entries);
+    c8mpz_map_set(ms, "limbs", stats[i].limb_bytes);
+    c8mpz_map_set(ms, "hits", stats[i].hits);
+    c8mpz_map_set(ms, "extends", stats[i].extends);
+    c8mpz_map_set(ms, "misses", stats[i].misses);
+    c8mpz_map_set(ms, "evictions", stats[i].evictions);
+    c8map_set(m, stats[i].name, (struct c8obj*)ms);
+    c8obj_unref((struct c8obj*)ms);
+  }
+  c8mpz_map_set(m, "limit", c8memo_limit());
+  return (struct c8obj*)m;
+}
+
+struct c8obj* c8mpz_memolimit(struct c8list* args)
+{
+  int n = c8list_size(args);
+  if (n > 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  if (n == 1) {
+    struct c8mpz* na = to_c8mpz(c8list_peek(args, 0));
+    if (!na || mpz_sgn(na->v->value) < 0 || !mpz_fits_ulong_p(na->v->value))
+      return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+    c8memo_set_limit(mpz_get_ui(na->v->value));
+  }
+  return (struct c8obj*)c8mpz_create_double(c8memo_limit());
+}
+
+struct c8obj* c8mpz_powmod(struct c8list* args)
+{
+  if (c8list_size(args) != 3)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8mpz* nb = to_c8mpz(c8list_peek(args, 0));
+  struct c8mpz* ne = to_c8mpz(c8list_peek(args, 1));
+  struct c8mpz* nm = to_c8mpz(c8list_peek(args, 2));
+  if (!nb || !ne || !nm || mpz_sgn(nm->v->value) == 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+
+  mpz_t am, b, e;
+  mpz_init(am);
+  mpz_abs(am, nm->v->value);
+  mpz_init_set(b, nb->v->value);
+  mpz_init_set(e, ne->v->value);
+  if (mpz_sgn(e) < 0) {
+    // A negative power of the inverse
+    if (!mpz_invert(b, b, am)) {
+      mpz_clears(am, b, e, NULL);
+      return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+    }
+    mpz_neg(e, e);
+  }
+  mpz_mod(b, b, am);
+  struct c8mpz* nr = c8mpz_create();
+  mpz_t t;
+  mpz_init(t);
+  c8mpz_modctx_powm(c8mpz_modctx(am), t, b, e);
+  mpz_set(c8mpz_reserve(nr, mpz_size(t)), t);
+  mpz_clears(am, b, e, t, NULL);
+  return (struct c8obj*)nr;
+}
+
+struct c8obj* c8mpz_invmod(struct c8list* args)
+{
+  if (c8list_size(args) != 2)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8mpz* na = to_c8mpz(c8list_peek(args, 0));
+  struct c8mpz* nm = to_c8mpz(c8list_peek(args, 1));
+  if (!na || !nm || mpz_sgn(nm->v->value) == 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  mpz_t t;
+  mpz_init(t);
+  if (!mpz_invert(t, na->v->value, nm->v->value)) {
+    mpz_clear(t);
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
   }
-  c8obj_unref(a);
+  struct c8mpz* nr = c8mpz_create_mpz(t);
+  mpz_clear(t);
   return (struct c8obj*)nr;
 }
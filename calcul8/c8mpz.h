@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <gmp.h>
+
 struct c8mpz;
 struct c8obj;
 struct cbbuf;
@@ -34,9 +36,15 @@ struct c8mpz* to_c8mpz(struct c8obj* o);
 /** Create a c8mpz object
  */
 struct c8mpz* c8mpz_create();
+struct c8mpz* c8mpz_create_mpz(const mpz_t value);
 struct c8mpz* c8mpz_create_int(int value);
 struct c8mpz* c8mpz_create_double(double value);
 struct c8mpz* c8mpz_create_str(const char* str);
+struct c8mpz* c8mpz_create_c8obj(const struct c8obj* obj);
+
+/** Get the value, which must not be modified
+ */
+mpz_srcptr c8mpz_value(const struct c8mpz* oo);
 
 /** Add mpz functions to context
  */
@@ -48,3 +56,11 @@ struct c8obj* c8mpz_abs(struct c8list* args);
 struct c8obj* c8mpz_gcd(struct c8list* args);
 struct c8obj* c8mpz_lcm(struct c8list* args);
 struct c8obj* c8mpz_fib(struct c8list* args);
+struct c8obj* c8mpz_binomial(struct c8list* args);
+struct c8obj* c8mpz_primorial(struct c8list* args);
+struct c8obj* c8mpz_product(struct c8list* args);
+struct c8obj* c8mpz_threads(struct c8list* args);
+struct c8obj* c8mpz_memostats(struct c8list* args);
+struct c8obj* c8mpz_memolimit(struct c8list* args);
+struct c8obj* c8mpz_powmod(struct c8list* args);
+struct c8obj* c8mpz_invmod(struct c8list* args);
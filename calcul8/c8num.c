@@ -28,16 +28,68 @@
 #include "c8ctx.h"
 #include "c8list.h"
 #include "c8buf.h"
+#include "c8string.h"
+#include "c8map.h"
 #include "c8debug.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <mpfr.h>
 
 static c8num_type_create_func c8num_int_create_func = 0;
 static c8num_type_create_func c8num_real_create_func = 0;
 static c8num_type_create_func c8num_cplx_create_func = 0;
+static c8num_type_create_func c8num_fast_create_func = 0;
+static c8num_type_create_func c8num_interval_create_func = 0;
+static c8num_interval_bounds_func c8num_interval_bounds = 0;
+static c8num_interval_narrow_func c8num_interval_narrow = 0;
+
+// Settings used when no evaluation is in progress, which new evaluators
+// start from
+static struct c8num_settings c8num_default_settings = {
+  C8NUM_PREC_DEFAULT, C8NUM_RND_NEAREST, 1, 0
+};
+static struct c8num_settings* c8num_current = &c8num_default_settings;
+
+static const char* c8num_rnd_names[] = {
+  "nearest", "zero", "up", "down", "away", 0
+};
+
+#define C8NUM_MAX_TYPES 8
+#define C8NUM_MAX_OP (C8_OP_LOOKUP + 1)
+
+struct c8num_type {
+  const char* name;
+  const struct c8obj_imp* imp;
+  int rank;
+  c8num_type_convert_func convert;
+  c8num_fma_func fma;
+  c8num_powmod_func powmod;
+};
+
+static struct c8num_type c8num_types[C8NUM_MAX_TYPES];
+static int c8num_ntypes = 0;
+
+// The type produced by conversions to each rank
+static int c8num_rank_types[C8NUM_RANKS] = { -1, -1, -1, -1 };
+
+// The fast real type, used in place of the real rank's type if enabled
+static int c8num_fast_type = -1;
+
+// The interval type, used in place of the real rank's type if enabled
+static int c8num_interval_type = -1;
+
+// Counts uses of intervals where a single value was needed
+static unsigned long c8num_doubts = 0;
+
+// Kernels for binary operators by left type, right type and operator
+static c8num_kernel_func c8num_kernels
+[C8NUM_MAX_TYPES][C8NUM_MAX_TYPES][C8NUM_MAX_OP];
+
+static struct c8obj* c8num_promote(struct c8obj* o, int op, struct c8obj* p);
 
 static void c8num_destroy(struct c8obj* o)
 {
@@ -71,28 +123,21 @@ static struct c8obj* c8num_op(struct c8obj* o, int op, struct c8obj* p)
 {
   struct c8num* oo = to_c8num(o);
   assert(oo);
-
-  struct c8obj* r = (oo->imp->op)(o, op, p);
-  struct c8error* re = to_c8error(r);
-  if (re) {
-    if (c8error_code(re) == C8_ERROR_PRECISION_REAL) {
-      struct c8buf buf; c8buf_init(&buf);
-      c8obj_str(o, &buf, 0);
-      struct c8obj* or = (struct c8obj*)c8num_real_create_func(c8buf_str(&buf));
-      c8buf_clear(&buf);
-      struct c8obj* pr = 0;
-      if (p) {
-        c8obj_str(p, &buf, 0);
-        pr = (struct c8obj*)c8num_real_create_func(c8buf_str(&buf));
-        c8buf_clear(&buf);
-      }
-      c8obj_unref(r);
-      r = c8obj_op(or, op, pr);
-      c8obj_unref(or);
-      c8obj_unref(pr);
-    }
+  const struct c8num* np = to_const_c8num(p);
+  if (np && oo->type >= 0 && np->type >= 0 && op < C8NUM_MAX_OP) {
+    c8num_kernel_func f = c8num_kernels[oo->type][np->type][op];
+    if (f) return f(o, op, p);
+    if (oo->type != np->type) return c8num_promote(o, op, p);
   }
-  return r;
+  return (oo->imp->op)(o, op, p);
+}
+
+static void c8num_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8num* oo = to_const_c8num(o);
+  assert(oo);
+  st->type = oo->imp->type;
+  (oo->imp->stat)(o, st);
 }
 
 static const struct c8obj_imp c8num_imp = {
@@ -100,13 +145,176 @@ static const struct c8obj_imp c8num_imp = {
   c8num_copy,
   c8num_int,
   c8num_str,
-  c8num_op
+  c8num_op,
+  0,
+  c8num_stat,
+  "num"
 };
 
 void c8num_init(struct c8num* oo, const struct c8obj_imp* imp)
 {
-  c8obj_init(&oo->base, &c8num_imp);
+  // Initialise as the numeric type, so it's counted as one
+  c8obj_init(&oo->base, imp);
+  oo->base.imp = &c8num_imp;
   oo->imp = imp;
+  oo->type = -1;
+  for (int i=0; i<c8num_ntypes; ++i) {
+    if (c8num_types[i].imp == imp) {
+      oo->type = i;
+      break;
+    }
+  }
+}
+
+int c8num_type_id(const char* name)
+{
+  assert(name);
+  for (int i=0; i<c8num_ntypes; ++i) {
+    if (strcmp(c8num_types[i].name, name) == 0) return i;
+  }
+  assert(c8num_ntypes < C8NUM_MAX_TYPES);
+  struct c8num_type* t = &c8num_types[c8num_ntypes];
+  t->name = name;
+  t->imp = 0;
+  t->rank = -1;
+  t->convert = 0;
+  t->fma = 0;
+  t->powmod = 0;
+  return c8num_ntypes++;
+}
+
+int c8num_register_type(const struct c8obj_imp* imp, int rank,
+                        c8num_type_convert_func convert)
+{
+  assert(imp && convert);
+  assert(rank >= 0 && rank < C8NUM_RANKS);
+  int id = c8num_type_id(imp->type);
+  struct c8num_type* t = &c8num_types[id];
+  t->imp = imp;
+  t->rank = rank;
+  t->convert = convert;
+  c8num_rank_types[rank] = id;
+  return id;
+}
+
+int c8num_register_fast_real(const struct c8obj_imp* imp,
+                             c8num_type_create_func create,
+                             c8num_type_convert_func convert)
+{
+  assert(imp && create && convert);
+  int id = c8num_type_id(imp->type);
+  struct c8num_type* t = &c8num_types[id];
+  t->imp = imp;
+  t->rank = C8NUM_RANK_REAL;
+  t->convert = convert;
+  c8num_fast_type = id;
+  c8num_fast_create_func = create;
+  return id;
+}
+
+int c8num_register_interval_real(const struct c8obj_imp* imp,
+                                 c8num_type_create_func create,
+                                 c8num_type_convert_func convert,
+                                 c8num_interval_bounds_func bounds,
+                                 c8num_interval_narrow_func narrow)
+{
+  assert(imp && create && convert && bounds && narrow);
+  int id = c8num_type_id(imp->type);
+  struct c8num_type* t = &c8num_types[id];
+  t->imp = imp;
+  t->rank = C8NUM_RANK_REAL;
+  t->convert = convert;
+  c8num_interval_type = id;
+  c8num_interval_create_func = create;
+  c8num_interval_bounds = bounds;
+  c8num_interval_narrow = narrow;
+  return id;
+}
+
+struct c8obj* c8num_interval(const struct c8obj* lo, const struct c8obj* hi)
+{
+  assert(lo && hi);
+  if (!c8num_interval_bounds) return 0;
+  return (struct c8obj*)c8num_interval_bounds(lo, hi);
+}
+
+void c8num_doubt()
+{
+  ++c8num_doubts;
+}
+
+void c8num_register_kernel(int ltype, int rtype, const int* ops,
+                           c8num_kernel_func f)
+{
+  assert(ltype >= 0 && ltype < c8num_ntypes);
+  assert(rtype >= 0 && rtype < c8num_ntypes);
+  for (; *ops != C8_OP_UNKNOWN; ++ops) {
+    assert(*ops < C8NUM_MAX_OP);
+    c8num_kernels[ltype][rtype][*ops] = f;
+  }
+}
+
+void c8num_register_fma(int type, c8num_fma_func f)
+{
+  assert(type >= 0 && type < c8num_ntypes);
+  c8num_types[type].fma = f;
+}
+
+void c8num_register_powmod(int type, c8num_powmod_func f)
+{
+  assert(type >= 0 && type < c8num_ntypes);
+  c8num_types[type].powmod = f;
+}
+
+// Perform an arithmetic operation in place on n, which must be a new object
+static struct c8obj* c8num_op_new(struct c8obj* n, int op, struct c8obj* p)
+{
+  int aop = op;
+  switch (op) {
+    case C8_OP_ADD: aop = C8_OP_ADD_ASSIGN; break;
+    case C8_OP_SUBTRACT: aop = C8_OP_SUBTRACT_ASSIGN; break;
+    case C8_OP_MULTIPLY: aop = C8_OP_MULTIPLY_ASSIGN; break;
+    case C8_OP_DIVIDE: aop = C8_OP_DIVIDE_ASSIGN; break;
+  }
+  struct c8obj* r = c8obj_op(n, aop, p);
+  c8obj_unref(n);
+  return r;
+}
+
+// Perform an operation between two types with no kernel for the pair, by
+// converting the operand of lower rank to the other's type. Operands of the
+// same rank are done in the left operand's type.
+static struct c8obj* c8num_promote(struct c8obj* o, int op, struct c8obj* p)
+{
+  const struct c8num_type* lt = &c8num_types[to_c8num(o)->type];
+  const struct c8num_type* rt = &c8num_types[to_c8num(p)->type];
+  if (lt->rank >= rt->rank) {
+    struct c8obj* np = (struct c8obj*)(lt->convert)(p);
+    struct c8obj* r = c8obj_op(o, op, np);
+    c8obj_unref(np);
+    return r;
+  }
+  return c8num_op_new((struct c8obj*)(rt->convert)(o), op, p);
+}
+
+// The type for a rank under the current settings, or -1 if none
+static int c8num_rank_type(int rank)
+{
+  if (rank == C8NUM_RANK_REAL && c8num_interval_type >= 0 &&
+      c8num_current->interval)
+    return c8num_interval_type;
+  if (rank == C8NUM_RANK_REAL && c8num_fast_type >= 0 && c8num_current->fast)
+    return c8num_fast_type;
+  return c8num_rank_types[rank];
+}
+
+// Convert to the type for a rank, or the next wider rank with a type
+static struct c8obj* c8num_convert(int rank, const struct c8obj* o)
+{
+  int id = c8num_rank_type(rank);
+  while (id < 0 && ++rank < C8NUM_RANKS) id = c8num_rank_type(rank);
+  if (id < 0) return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  return (struct c8obj*)(c8num_types[id].convert)(o);
 }
 
 const struct c8num* to_const_c8num(const struct c8obj* o)
@@ -120,6 +328,79 @@ struct c8num* to_c8num(struct c8obj* o)
   return (struct c8num*)to_const_c8num(o);
 }
 
+struct c8obj* c8num_op_rank(int rank, struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8num_op_new(c8num_convert(rank, o), op, p);
+}
+
+struct c8obj* c8num_op_real(struct c8obj* o, int op, struct c8obj* p)
+{
+  return c8num_op_rank(C8NUM_RANK_REAL, o, op, p);
+}
+
+struct c8obj* c8num_fma(struct c8obj* a, struct c8obj* b, struct c8obj* c,
+                        int form)
+{
+  struct c8obj* ops[3] = { a, b, c };
+  int t = -1;
+  for (int i=0; i<3; ++i) {
+    const struct c8num* n = to_const_c8num(ops[i]);
+    if (!n || n->type < 0) { t = -1; break; }
+    if (t < 0 || c8num_types[n->type].rank > c8num_types[t].rank) t = n->type;
+  }
+  int assign = (C8NUM_FMA_ASSIGN == form || C8NUM_FNMA_ASSIGN == form);
+  c8num_fma_func f = (t >= 0) ? c8num_types[t].fma : 0;
+  if (f && (!assign || to_c8num(c)->type == t)) {
+    // Convert narrower operands to the widest type
+    struct c8obj* conv[3] = { 0, 0, 0 };
+    for (int i=0; i<3; ++i) {
+      int ti = to_c8num(ops[i])->type;
+      if (ti == t) continue;
+      if (c8num_types[ti].rank == c8num_types[t].rank) { f = 0; break; }
+      conv[i] = (struct c8obj*)(c8num_types[t].convert)(ops[i]);
+    }
+    struct c8obj* r = 0;
+    if (f) {
+      r = (f)(conv[0] ? conv[0] : a, conv[1] ? conv[1] : b,
+              conv[2] ? conv[2] : c, form);
+    }
+    for (int i=0; i<3; ++i) c8obj_unref(conv[i]);
+    if (f) return r;
+  }
+
+  // Multiply and add separately
+  struct c8obj* ab = c8obj_op(a, C8_OP_MULTIPLY, b);
+  struct c8obj* r = 0;
+  switch (form) {
+    case C8NUM_FMA: r = c8obj_op(ab, C8_OP_ADD, c); break;
+    case C8NUM_FMS: r = c8obj_op(ab, C8_OP_SUBTRACT, c); break;
+    case C8NUM_FNMA: r = c8obj_op(c, C8_OP_SUBTRACT, ab); break;
+    case C8NUM_FMA_ASSIGN: r = c8obj_op(c, C8_OP_ADD_ASSIGN, ab); break;
+    case C8NUM_FNMA_ASSIGN: r = c8obj_op(c, C8_OP_SUBTRACT_ASSIGN, ab); break;
+  }
+  c8obj_unref(ab);
+  return r;
+}
+
+struct c8obj* c8num_powmod(struct c8obj* b, struct c8obj* e, struct c8obj* m)
+{
+  const struct c8num* nb = to_const_c8num(b);
+  const struct c8num* ne = to_const_c8num(e);
+  const struct c8num* nm = to_const_c8num(m);
+  if (nb && ne && nm && nb->type >= 0 &&
+      nb->type == ne->type && nb->type == nm->type) {
+    c8num_powmod_func f = c8num_types[nb->type].powmod;
+    struct c8obj* r = f ? (f)(b, e, m) : 0;
+    if (r) return r;
+  }
+
+  // Raise to the power and reduce separately
+  struct c8obj* be = c8obj_op(b, C8_OP_POWER, e);
+  struct c8obj* r = c8obj_op(be, C8_OP_MODULUS, m);
+  c8obj_unref(be);
+  return r;
+}
+
 struct c8num* c8num_create_str(const char* str)
 {
   const char** c = &str;
@@ -176,7 +457,12 @@ struct c8num* c8num_parse(const char** c)
   c8buf_append_strn(&str, start, *c - start);
   struct c8num* oo = 0;
   if (ex || dd) {
-    oo = c8num_real_create_func(c8buf_str(&str));
+    c8num_type_create_func create = c8num_real_create_func;
+    if (c8num_interval_create_func && c8num_current->interval)
+      create = c8num_interval_create_func;
+    else if (c8num_fast_create_func && c8num_current->fast)
+      create = c8num_fast_create_func;
+    oo = create(c8buf_str(&str));
   } else {
     oo = c8num_int_create_func(c8buf_str(&str));
   }
@@ -188,58 +474,373 @@ struct c8obj* c8num_to_int(struct c8list* args)
 {
   if (c8list_size(args) != 1)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
   if (!a)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  
-  struct c8buf buf; c8buf_init(&buf);
-  c8obj_str(a, &buf, C8_FMT_DEC);
-  c8obj_unref(a);
+  return c8num_convert(C8NUM_RANK_INT, a);
+}
 
-  struct c8obj* o = (struct c8obj*)c8num_int_create_func(c8buf_str(&buf));
-  c8buf_clear(&buf);
-  return o;
+struct c8obj* c8num_to_rational(struct c8list* args)
+{
+  if (c8list_size(args) != 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* a = c8list_peek(args, 0);
+  if (!a)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  return c8num_convert(C8NUM_RANK_RATIONAL, a);
 }
 
 struct c8obj* c8num_to_real(struct c8list* args)
 {
   if (c8list_size(args) != 1)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
   if (!a)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  
-  struct c8buf buf; c8buf_init(&buf);
-  c8obj_str(a, &buf, C8_FMT_DEC);
-  c8obj_unref(a);
-  
-  struct c8obj* o = (struct c8obj*)c8num_real_create_func(c8buf_str(&buf));
-  c8buf_clear(&buf);
-  return o;
+  return c8num_convert(C8NUM_RANK_REAL, a);
 }
 
 struct c8obj* c8num_to_cplx(struct c8list* args)
 {
   if (c8list_size(args) != 1)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
   if (!a)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  
+  return c8num_convert(C8NUM_RANK_CPLX, a);
+}
+
+// Get a precision argument, which may be too large for an int
+static int c8num_prec_arg(const struct c8obj* a, long* bits)
+{
+  if (!a) return 0;
   struct c8buf buf; c8buf_init(&buf);
-  c8obj_str(a, &buf, C8_FMT_DEC);
-  c8obj_unref(a);
-  
-  struct c8obj* o = (struct c8obj*)c8num_cplx_create_func(c8buf_str(&buf));
+  c8obj_str(a, &buf, 0);
+  int ok = c8buf_len(&buf) && c8num_prec_parse(c8buf_str(&buf), bits);
   c8buf_clear(&buf);
-  return o;
+  return ok;
+}
+
+struct c8obj* c8num_precision(struct c8list* args)
+{
+  if (c8list_size(args) > 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  if (c8list_size(args) == 1) {
+    long bits = 0;
+    if (!c8num_prec_arg(c8list_peek(args, 0), &bits))
+      return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+    c8num_set_prec(bits);
+  }
+  struct c8buf buf; c8buf_init(&buf);
+  c8buf_append_fmt(&buf, "%ld", c8num_prec());
+  struct c8obj* r = (struct c8obj*)c8num_int_create_func(c8buf_str(&buf));
+  c8buf_clear(&buf);
+  return r;
+}
+
+struct c8obj* c8num_rounding(struct c8list* args)
+{
+  if (c8list_size(args) > 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  if (c8list_size(args) == 1) {
+    struct c8obj* a = c8list_peek(args, 0);
+    if (!a) return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+    struct c8buf buf; c8buf_init(&buf);
+    c8obj_str(a, &buf, 0);
+    const char* name = c8buf_len(&buf) ? c8buf_str(&buf) : "";
+    int rnd = -1;
+    for (int i=0; c8num_rnd_names[i]; ++i) {
+      if (strcmp(c8num_rnd_names[i], name) == 0) rnd = i;
+    }
+    c8buf_clear(&buf);
+    if (rnd < 0) return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+    c8num_set_rnd(rnd);
+  }
+  return (struct c8obj*)c8string_create_str(c8num_rnd_names[c8num_rnd()]);
+}
+
+struct c8obj* c8num_withprec(struct c8list* args)
+{
+  int n = c8list_size(args);
+  if (n < 2)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  long bits = 0;
+  struct c8obj* f = c8list_peek(args, 1);
+  if (!c8num_prec_arg(c8list_peek(args, 0), &bits) || !f)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+
+  // Call f with the remaining arguments at the given precision
+  struct c8list* fargs = c8list_create();
+  for (int i=2; i<n; ++i) c8list_push_back(fargs, c8list_peek(args, i));
+  long prec = c8num_prec();
+  c8num_set_prec(bits);
+  struct c8obj* r = c8obj_op(f, C8_OP_LIST, (struct c8obj*)fargs);
+  c8num_set_prec(prec);
+  c8obj_unref((struct c8obj*)fargs);
+  return r;
+}
+
+// Adaptive evaluation starts at double precision with some guard bits
+// beyond those the digits need, and doubles the precision for each retry
+#define C8NUM_ADAPT_GUARD 10
+#define C8NUM_ADAPT_LEVELS 8
+
+// Statistics by function, the last entry being shared once they are all used
+#define C8NUM_ADAPT_FUNCS 32
+#define C8NUM_ADAPT_NAME 48
+
+static struct c8num_adapt_entry {
+  char name[C8NUM_ADAPT_NAME];
+  struct c8num_adapt_stats st;
+} c8num_adapt_entries[C8NUM_ADAPT_FUNCS];
+static int c8num_adapt_nentries = 0;
+
+static struct c8num_adapt_stats* c8num_adapt_lookup(const struct c8obj* f)
+{
+  struct c8buf buf; c8buf_init(&buf);
+  c8obj_str(f, &buf, 0);
+  const char* name = c8buf_len(&buf) ? c8buf_str(&buf) : "";
+  struct c8num_adapt_entry* e = 0;
+  for (int i=0; i<c8num_adapt_nentries && !e; ++i) {
+    if (strncmp(c8num_adapt_entries[i].name, name, C8NUM_ADAPT_NAME-1) == 0)
+      e = &c8num_adapt_entries[i];
+  }
+  if (!e && c8num_adapt_nentries < C8NUM_ADAPT_FUNCS) {
+    e = &c8num_adapt_entries[c8num_adapt_nentries++];
+    if (c8num_adapt_nentries == C8NUM_ADAPT_FUNCS) name = "other";
+    strncpy(e->name, name, C8NUM_ADAPT_NAME-1);
+    e->st.name = e->name;
+  }
+  if (!e) e = &c8num_adapt_entries[C8NUM_ADAPT_FUNCS-1];
+  c8buf_clear(&buf);
+  return &e->st;
+}
+
+/* Get a result known to have the precision out, or 0 if it isn't known.
+ * Reals must be intervals which give a single value, unless keep is set to
+ * give the intervals themselves, and lists must only contain known results.
+ */
+static struct c8obj* c8num_adapt_verify(struct c8obj* v, long out, int keep)
+{
+  const struct c8num* nv = to_const_c8num(v);
+  struct c8list* lv = to_c8list(v);
+  if (nv && nv->type >= 0) {
+    int rank = c8num_types[nv->type].rank;
+    if (rank < C8NUM_RANK_REAL) return c8obj_ref(v);
+    // Complex results have no bounds to check
+    if (rank > C8NUM_RANK_REAL) return 0;
+    struct c8obj* iv = c8num_convert(C8NUM_RANK_REAL, v);
+    if (keep) return iv;
+    long p = c8num_current->prec;
+    c8num_current->prec = out;
+    struct c8obj* r = c8num_interval_narrow(iv);
+    c8num_current->prec = p;
+    c8obj_unref(iv);
+    return r;
+  }
+  if (lv) {
+    struct c8list* r = c8list_create();
+    for (int i=0; i<c8list_size(lv); ++i) {
+      struct c8obj* a = c8list_peek(lv, i);
+      struct c8obj* ra = a ? c8num_adapt_verify(a, out, keep) : 0;
+      if (a && !ra) {
+        c8obj_unref((struct c8obj*)r);
+        return 0;
+      }
+      c8list_push_back(r, ra);
+      c8obj_unref(ra);
+    }
+    return (struct c8obj*)r;
+  }
+  // Not a number, so there is nothing to check
+  return c8obj_ref(v);
+}
+
+struct c8obj* c8num_adaptive(long digits, struct c8obj* f, struct c8list* args)
+{
+  assert(digits > 0);
+  assert(f);
+  struct c8num_adapt_stats* st = c8num_adapt_lookup(f);
+  ++st->calls;
+
+  if (c8num_interval_type < 0) {
+    ++st->failures;
+    return (struct c8obj*)c8error_create(C8_ERROR_UNVERIFIED);
+  }
+
+  struct c8num_settings saved = *c8num_current;
+  unsigned long doubts = c8num_doubts;
+
+  // Precision whose output shows the digits (see c8mpfr_str)
+  long out = (long)(digits / 0.301) + 1;
+  long p = out + C8NUM_ADAPT_GUARD;
+  if (p < C8NUM_PREC_DEFAULT) p = C8NUM_PREC_DEFAULT;
+
+  // Evaluate with reals as intervals, which contain the exact result
+  // whatever the rounding, until the bounds are close enough to give it
+  c8num_current->fast = 0;
+  c8num_current->interval = 1;
+
+  struct c8obj* r = 0;
+  for (int level=0; !r; ++level) {
+    if (p > st->prec) st->prec = p;
+    c8num_current->prec = p;
+    c8num_current->rnd = C8NUM_RND_NEAREST;
+
+    // Real arguments become intervals at this precision, taking them to be
+    // exact
+    struct c8list* fargs = c8list_create();
+    for (int i=0; i<c8list_size(args); ++i) {
+      struct c8obj* a = c8list_peek(args, i);
+      const struct c8num* na = to_const_c8num(a);
+      if (na && na->type >= 0 && c8num_types[na->type].rank == C8NUM_RANK_REAL) {
+        struct c8obj* ca = c8num_convert(C8NUM_RANK_REAL, a);
+        c8list_push_back(fargs, ca);
+        c8obj_unref(ca);
+      } else {
+        c8list_push_back(fargs, a);
+      }
+    }
+
+    c8num_doubts = 0;
+    struct c8obj* v = c8obj_op(f, C8_OP_LIST, (struct c8obj*)fargs);
+    int doubted = c8num_doubts != 0;
+    c8obj_unref((struct c8obj*)fargs);
+
+    if (!doubted) r = c8num_adapt_verify(v, out, saved.interval);
+    c8obj_unref(v);
+
+    if (!r && level+1 == C8NUM_ADAPT_LEVELS) {
+      ++st->failures;
+      r = (struct c8obj*)c8error_create(C8_ERROR_UNVERIFIED);
+    } else if (!r) {
+      ++st->escalations;
+      p *= 2;
+    }
+  }
+
+  *c8num_current = saved;
+  c8num_doubts = doubts;
+  return r;
+}
+
+int c8num_adapt_stats(struct c8num_adapt_stats* stats, int n)
+{
+  int i = 0;
+  for (; i<n && i<c8num_adapt_nentries; ++i) {
+    stats[i] = c8num_adapt_entries[i].st;
+  }
+  return i;
+}
+
+struct c8obj* c8num_adapt(struct c8list* args)
+{
+  int n = c8list_size(args);
+  if (n < 2)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* a = c8list_peek(args, 0);
+  struct c8obj* f = c8list_peek(args, 1);
+  if (!a || !f || c8obj_int(a) < 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+
+  struct c8list* fargs = c8list_create();
+  for (int i=2; i<n; ++i) c8list_push_back(fargs, c8list_peek(args, i));
+  struct c8obj* r = c8num_adaptive(c8obj_int(a), f, fargs);
+  c8obj_unref((struct c8obj*)fargs);
+  return r;
+}
+
+static void c8num_map_set(struct c8map* m, const char* key, long value)
+{
+  struct c8buf buf; c8buf_init(&buf);
+  c8buf_append_fmt(&buf, "%ld", value);
+  struct c8obj* v = (struct c8obj*)c8num_int_create_func(c8buf_str(&buf));
+  c8buf_clear(&buf);
+  c8map_set(m, key, v);
+  c8obj_unref(v);
+}
+
+struct c8obj* c8num_adaptstats(struct c8list* args)
+{
+  if (c8list_size(args) != 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8num_adapt_stats stats[C8NUM_ADAPT_FUNCS];
+  int n = c8num_adapt_stats(stats, C8NUM_ADAPT_FUNCS);
+  struct c8map* m = c8map_create();
+  for (int i=0; i<n; ++i) {
+    struct c8map* ms = c8map_create();
+    c8num_map_set(ms, "calls", stats[i].calls);
+    c8num_map_set(ms, "escalations", stats[i].escalations);
+    c8num_map_set(ms, "failures", stats[i].failures);
+    c8num_map_set(ms, "prec", stats[i].prec);
+    c8map_set(m, stats[i].name, (struct c8obj*)ms);
+    c8obj_unref((struct c8obj*)ms);
+  }
+  return (struct c8obj*)m;
 }
 
 void c8num_init_ctx(struct c8ctx* ctx)
 {
   c8ctx_add(ctx, "int", (struct c8obj*)c8func_create(c8num_to_int));
+  c8ctx_add(ctx, "rational", (struct c8obj*)c8func_create(c8num_to_rational));
   c8ctx_add(ctx, "real", (struct c8obj*)c8func_create(c8num_to_real));
   c8ctx_add(ctx, "cplx", (struct c8obj*)c8func_create(c8num_to_cplx));
+  c8ctx_add(ctx, "prec", (struct c8obj*)c8func_create(c8num_precision));
+  c8ctx_add(ctx, "rounding", (struct c8obj*)c8func_create(c8num_rounding));
+  c8ctx_add(ctx, "withprec", (struct c8obj*)c8func_create(c8num_withprec));
+  c8ctx_add(ctx, "adaptive", (struct c8obj*)c8func_create(c8num_adapt));
+  c8ctx_add(ctx, "adaptstats", (struct c8obj*)c8func_create(c8num_adaptstats));
+}
+
+long c8num_prec()
+{
+  return c8num_current->prec;
+}
+
+void c8num_set_prec(long bits)
+{
+  assert(c8num_prec_valid(bits));
+  c8num_current->prec = bits;
+}
+
+int c8num_prec_valid(long bits)
+{
+  return bits >= C8NUM_PREC_MIN && bits <= MPFR_PREC_MAX;
+}
+
+int c8num_prec_parse(const char* str, long* bits)
+{
+  assert(str);
+  assert(bits);
+  char* end = 0;
+  errno = 0;
+  long v = strtol(str, &end, 10);
+  if (errno || end == str || *end || !c8num_prec_valid(v)) return 0;
+  *bits = v;
+  return 1;
+}
+
+struct c8num_settings* c8num_settings()
+{
+  return c8num_current;
+}
+
+struct c8num_settings* c8num_use_settings(struct c8num_settings* s)
+{
+  struct c8num_settings* prev = c8num_current;
+  c8num_current = s ? s : &c8num_default_settings;
+  return prev;
+}
+
+int c8num_rnd()
+{
+  return c8num_current->rnd;
+}
+
+void c8num_set_rnd(int rnd)
+{
+  assert(rnd >= C8NUM_RND_NEAREST && rnd <= C8NUM_RND_AWAY);
+  c8num_current->rnd = rnd;
 }
 
 void c8num_register_int_create(c8num_type_create_func f)
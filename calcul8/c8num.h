@@ -39,6 +39,106 @@ struct c8num* c8num_parse(const char** c);
  */
 void c8num_init_ctx(struct c8ctx* ctx);
 
+/** Working precision in bits and rounding mode, used for new real and
+ * complex values. Rounding modes match MPFR's. These are the current
+ * settings, see c8num_settings.
+ */
+#define C8NUM_RND_NEAREST 0
+#define C8NUM_RND_ZERO 1
+#define C8NUM_RND_UP 2
+#define C8NUM_RND_DOWN 3
+#define C8NUM_RND_AWAY 4
+
+#define C8NUM_PREC_MIN 2
+#define C8NUM_PREC_DEFAULT 53
+
+long c8num_prec();
+void c8num_set_prec(long bits);
+int c8num_rnd();
+void c8num_set_rnd(int rnd);
+
+/** Whether a precision is in range, from C8NUM_PREC_MIN to MPFR's maximum
+ */
+int c8num_prec_valid(long bits);
+
+/** Parse a precision in decimal, giving zero if it isn't valid
+ */
+int c8num_prec_parse(const char* str, long* bits);
+
+/** Numeric settings
+ * Each evaluator has its own, which are current while it evaluates and
+ * start as a copy of those current when it's created. The defaults are
+ * current when no evaluation is in progress.
+ */
+struct c8num_settings {
+  long prec;
+  int rnd;
+  int fast; // Use the fast real type for reals, if there is one
+  int interval; // Use the interval type for reals, see c8num_adaptive
+};
+
+struct c8num_settings* c8num_settings();
+
+/** Make settings current, or the defaults if s is null
+ * Returns the previous settings, to restore afterwards.
+ */
+struct c8num_settings* c8num_use_settings(struct c8num_settings* s);
+
+/** Fused multiply-add, giving a*b + c, a*b - c or c - a*b with a single
+ * rounding where the operand types allow it. The assign forms modify c in
+ * place.
+ */
+#define C8NUM_FMA 0
+#define C8NUM_FMS 1
+#define C8NUM_FNMA 2
+#define C8NUM_FMA_ASSIGN 3
+#define C8NUM_FNMA_ASSIGN 4
+
+struct c8obj* c8num_fma(struct c8obj* a, struct c8obj* b, struct c8obj* c,
+                        int form);
+
+/** Modular exponentiation, giving the same result as (b ^ e) % m without
+ * computing the full power where the operand types allow it
+ */
+struct c8obj* c8num_powmod(struct c8obj* b, struct c8obj* e, struct c8obj* m);
+
+/** Adaptive evaluation, calling f with args so that its result is known
+ * to the given number of significant digits. f is evaluated once at each
+ * level with reals as intervals rounded outwards, first at double
+ * precision, then at twice the precision each time until both bounds round
+ * to the same value at the precision the digits need, which is the result.
+ * Comparisons and conversions to integers which the intervals can't decide
+ * also cause a retry. Real arguments and variables from outside f are
+ * taken to be exact. Gives C8_ERROR_UNVERIFIED if the result is never
+ * known, or if there is no interval type.
+ */
+struct c8obj* c8num_adaptive(long digits, struct c8obj* f, struct c8list* args);
+
+/** Adaptive evaluation statistics for each function. Gets up to n entries,
+ * returning how many there are.
+ */
+struct c8num_adapt_stats {
+  const char* name;
+  unsigned long calls;
+  unsigned long escalations; // Retries at a higher precision
+  unsigned long failures; // Results which were never known
+  long prec; // Highest precision used
+};
+
+int c8num_adapt_stats(struct c8num_adapt_stats* stats, int n);
+
+/** Functions
+ */
+struct c8obj* c8num_to_int(struct c8list* args);
+struct c8obj* c8num_to_rational(struct c8list* args);
+struct c8obj* c8num_to_real(struct c8list* args);
+struct c8obj* c8num_to_cplx(struct c8list* args);
+struct c8obj* c8num_precision(struct c8list* args);
+struct c8obj* c8num_rounding(struct c8list* args);
+struct c8obj* c8num_withprec(struct c8list* args);
+struct c8obj* c8num_adapt(struct c8list* args);
+struct c8obj* c8num_adaptstats(struct c8list* args);
+
 /** Register implementations 
  */
 typedef struct c8num* (*c8num_type_create_func)
@@ -46,3 +146,9 @@ typedef struct c8num* (*c8num_type_create_func)
 void c8num_register_int_create(c8num_type_create_func f);
 void c8num_register_real_create(c8num_type_create_func f);
 void c8num_register_cplx_create(c8num_type_create_func f);
+
+/** Conversion from any object, which should convert other numeric types
+ * directly rather than through their string form
+ */
+typedef struct c8num* (*c8num_type_convert_func)
+(const struct c8obj* o);
@@ -25,6 +25,91 @@
 struct c8num {
   struct c8obj base;
   const struct c8obj_imp* imp;
+  int type; // registered type id, or -1
 };
 
-void c8num_init(struct c8num* oo, const struct c8obj_imp* imp);
\ No newline at end of file
+void c8num_init(struct c8num* oo, const struct c8obj_imp* imp);
+
+/** Promotion ranks, from narrowest to widest. Operations between types of
+ * different rank are done in the wider type, unless there is a kernel for
+ * the pair.
+ */
+#define C8NUM_RANK_INT 0
+#define C8NUM_RANK_RATIONAL 1
+#define C8NUM_RANK_REAL 2
+#define C8NUM_RANK_CPLX 3
+#define C8NUM_RANKS 4
+
+/** Get the id for a numeric type by name, which is reserved if the type
+ * isn't registered yet
+ */
+int c8num_type_id(const char* name);
+
+/** Register a numeric type, which becomes the type produced for its rank by
+ * conversions and promotions. Returns the type id.
+ */
+int c8num_register_type(const struct c8obj_imp* imp, int rank,
+                        c8num_type_convert_func convert);
+
+/** Register a fast real type, which is used for real literals and in
+ * place of the type for the real rank while the settings allow it (see
+ * c8num_settings). Returns the type id.
+ */
+int c8num_register_fast_real(const struct c8obj_imp* imp,
+                             c8num_type_create_func create,
+                             c8num_type_convert_func convert);
+
+/** Register an interval type, which is used for real literals and in
+ * place of the type for the real rank while the settings ask for it (see
+ * c8num_settings). bounds creates an interval from its bounds, and narrow
+ * gives the real at the working precision which both bounds round to
+ * nearest, or 0 if they don't. Returns the type id.
+ */
+typedef struct c8num* (*c8num_interval_bounds_func)
+(const struct c8obj* lo, const struct c8obj* hi);
+typedef struct c8obj* (*c8num_interval_narrow_func)
+(const struct c8obj* o);
+int c8num_register_interval_real(const struct c8obj_imp* imp,
+                                 c8num_type_create_func create,
+                                 c8num_type_convert_func convert,
+                                 c8num_interval_bounds_func bounds,
+                                 c8num_interval_narrow_func narrow);
+
+/** Create an interval from reals giving its bounds, or 0 if there is no
+ * interval type
+ */
+struct c8obj* c8num_interval(const struct c8obj* lo, const struct c8obj* hi);
+
+/** Note that an interval has been used where a single value is needed, such
+ * as an undecided comparison, so the evaluation can't be relied on
+ */
+void c8num_doubt();
+
+/** Register a kernel for binary operators between two types, for a list of
+ * operators terminated by C8_OP_UNKNOWN. Kernels are only called with
+ * operands of the given types.
+ */
+typedef struct c8obj* (*c8num_kernel_func)
+(struct c8obj* o, int op, struct c8obj* p);
+void c8num_register_kernel(int ltype, int rtype, const int* ops,
+                           c8num_kernel_func f);
+
+/** Register a fused multiply-add for operands which are all of one type,
+ * taking the forms of c8num_fma
+ */
+typedef struct c8obj* (*c8num_fma_func)
+(struct c8obj* a, struct c8obj* b, struct c8obj* c, int form);
+void c8num_register_fma(int type, c8num_fma_func f);
+
+/** Register modular exponentiation for operands which are all of one type,
+ * as for c8num_powmod. It may return 0 for operands it doesn't handle.
+ */
+typedef struct c8obj* (*c8num_powmod_func)
+(struct c8obj* b, struct c8obj* e, struct c8obj* m);
+void c8num_register_powmod(int type, c8num_powmod_func f);
+
+/** Perform an operation with o converted to the type for a wider rank, for
+ * results which o's own type can't represent
+ */
+struct c8obj* c8num_op_rank(int rank, struct c8obj* o, int op, struct c8obj* p);
+struct c8obj* c8num_op_real(struct c8obj* o, int op, struct c8obj* p);
@@ -22,6 +22,8 @@
 #include "c8objimp.h"
 #include "c8buf.h"
 #include "c8debug.h"
+#include "c8gc.h"
+#include "c8heap.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -39,7 +41,10 @@ void c8obj_unref(struct c8obj* o)
   assert(o->imp);
   assert(o->refs > 0);
   if (--o->refs == 0) {
+    if (o->gc) c8gc_forget(o);
     (o->imp->destroy)(o);
+  } else if (o->imp->traverse) {
+    c8gc_possible_root(o);
   }
 }
 
@@ -49,6 +54,14 @@ struct c8obj* c8obj_copy(const struct c8obj* o)
   return (o->imp->copy)(o);
 }
 
+struct c8obj* c8obj_take(struct c8obj* o)
+{
+  if (!o || o->refs == 1) return o;
+  struct c8obj* r = (o->imp->copy)(o);
+  c8obj_unref(o);
+  return r;
+}
+
 int c8obj_int(const struct c8obj* o)
 {
   assert(o);
@@ -82,5 +95,7 @@ void c8obj_debug(int level, const char* name, const struct c8obj* o)
 void c8obj_init(struct c8obj* o, const struct c8obj_imp* imp)
 {
   o->refs = 1;
+  o->gc = 0;
   o->imp = imp;
+  c8heap_created(imp);
 }
\ No newline at end of file
@@ -36,6 +36,12 @@ void c8obj_unref(struct c8obj* o);
  */
 struct c8obj* c8obj_copy(const struct c8obj* o);
 
+/** Take a c8obj for storing as a variable's value
+ * Consumes the caller's reference. If the c8obj is referenced elsewhere,
+ * returns a copy instead, which shares its value until either is modified.
+ */
+struct c8obj* c8obj_take(struct c8obj* o);
+
 /* Get an integer representation of this c8obj
  */
 int c8obj_int(const struct c8obj* o);
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 struct c8buf;
 struct c8obj;
 
@@ -38,16 +40,42 @@ typedef void (*c8obj_str_func)
 typedef struct c8obj* (*c8obj_op_func)
 (struct c8obj* o, int op, struct c8obj* p);
 
+typedef void (*c8obj_visit_func)
+(struct c8obj** slot, void* arg);
+
+/* Visit the slots holding this object's references to other objects.
+ * Only containers implement this, which makes them subject to cycle
+ * collection (see c8gc).
+ */
+typedef void (*c8obj_traverse_func)
+(struct c8obj* o, c8obj_visit_func visit, void* arg);
+
+/* Memory used by an object, for heap statistics (see c8heap).
+ * Storage shared with other objects is divided between its sharers.
+ */
+struct c8obj_stat {
+  const char* type;
+  size_t bytes; // Including any storage owned by the object
+  size_t limb_bytes; // Part of bytes allocated for GMP limbs
+};
+
+typedef void (*c8obj_stat_func)
+(const struct c8obj* o, struct c8obj_stat* st);
+
 struct c8obj_imp {
   c8obj_destroy_func destroy;
   c8obj_copy_func copy;
   c8obj_int_func to_int;
   c8obj_str_func to_str;
   c8obj_op_func op;
+  c8obj_traverse_func traverse;
+  c8obj_stat_func stat;
+  const char* type;
 };
 
 struct c8obj {
   int refs;
+  int gc; // Cycle collector state, owned by c8gc
   const struct c8obj_imp* imp;
 };
 
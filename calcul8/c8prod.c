@@ -0,0 +1,398 @@
+/** c8prod - parallel product trees of integers
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8prod.h"
+
+#include <gmp.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#ifdef C8_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Products smaller than this, in bits, are done on one thread
+#define C8PROD_PARALLEL_BITS (1 << 20)
+
+#define C8PROD_MAX_THREADS 16
+
+// Factors multiplied together in a word before going to GMP
+#define C8PROD_LEAF 16
+
+static int c8prod_nthreads = 0; // 0 until set or first used
+
+int c8prod_threads()
+{
+  if (!c8prod_nthreads) {
+    long n = 1;
+#ifdef C8_THREADS
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    c8prod_set_threads(n < 1 ? 1 : (int)n);
+  }
+  return c8prod_nthreads;
+}
+
+void c8prod_set_threads(int n)
+{
+  if (n < 1) n = 1;
+  if (n > C8PROD_MAX_THREADS) n = C8PROD_MAX_THREADS;
+#ifndef C8_THREADS
+  n = 1;
+#endif
+  c8prod_nthreads = n;
+}
+
+// Whether a product of about this many bits is worth splitting
+static int c8prod_parallel(double bits)
+{
+  return c8prod_threads() > 1 && bits >= C8PROD_PARALLEL_BITS;
+}
+
+struct c8prod_leaf_job {
+  const struct c8prod* p;
+  size_t lo;
+  size_t hi;
+  mpz_ptr r;
+};
+
+static void* c8prod_leaf_job(void* arg)
+{
+  struct c8prod_leaf_job* j = arg;
+  (j->p->leaf)(j->r, j->lo, j->hi, j->p->data);
+  return 0;
+}
+
+struct c8prod_merge_job {
+  mpz_ptr a;
+  mpz_srcptr b;
+};
+
+static void* c8prod_merge_job(void* arg)
+{
+  struct c8prod_merge_job* j = arg;
+  mpz_mul(j->a, j->a, j->b);
+  return 0;
+}
+
+#ifdef C8_THREADS
+// Worker threads are started when first needed and kept for later
+// products, rather than started for each batch of jobs. A batch is shared
+// between the workers and the thread running it, which waits until all of
+// its jobs are finished.
+struct c8prod_pool {
+  pthread_mutex_t lock;
+  pthread_cond_t work; // a batch has jobs to start
+  pthread_cond_t done; // the last job of a batch has finished
+  int workers;
+  void* (*f)(void*);
+  char* jobs;
+  size_t size;
+  int n;
+  int next; // next job to start
+  int pending; // jobs not yet finished
+};
+
+static struct c8prod_pool c8prod_pool = {
+  PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+  PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, 0, 0, 0
+};
+
+// Run jobs from the current batch until none are left to start, with the
+// lock held other than while running them
+static void c8prod_pool_work(struct c8prod_pool* p)
+{
+  while (p->next < p->n) {
+    char* job = p->jobs + p->next++ * p->size;
+    void* (*f)(void*) = p->f;
+    pthread_mutex_unlock(&p->lock);
+    f(job);
+    pthread_mutex_lock(&p->lock);
+    if (--p->pending == 0) pthread_cond_signal(&p->done);
+  }
+}
+
+static void* c8prod_worker(void* arg)
+{
+  struct c8prod_pool* p = arg;
+  pthread_mutex_lock(&p->lock);
+  while (1) {
+    while (p->next >= p->n) pthread_cond_wait(&p->work, &p->lock);
+    c8prod_pool_work(p);
+  }
+  return 0;
+}
+#endif
+
+// Run n jobs of the given size, on the worker threads where possible
+static void c8prod_run_jobs(void* (*f)(void*), void* jobs, size_t size, int n)
+{
+  char* job = jobs;
+#ifdef C8_THREADS
+  struct c8prod_pool* p = &c8prod_pool;
+  pthread_mutex_lock(&p->lock);
+  while (p->workers < n-1) {
+    pthread_t thread;
+    if (pthread_create(&thread, 0, c8prod_worker, p) != 0) break;
+    pthread_detach(thread);
+    ++p->workers;
+  }
+  p->f = f;
+  p->jobs = job;
+  p->size = size;
+  p->n = n;
+  p->next = 0;
+  p->pending = n;
+  pthread_cond_broadcast(&p->work);
+  c8prod_pool_work(p);
+  while (p->pending > 0) pthread_cond_wait(&p->done, &p->lock);
+  p->n = 0;
+  p->next = 0;
+  pthread_mutex_unlock(&p->lock);
+#else
+  for (int i=0; i<n; ++i) f(job + i*size);
+#endif
+}
+
+void c8prod_run(mpz_ptr r, const struct c8prod* p)
+{
+  assert(p->leaf && p->bits);
+  double total = (p->bits)(p->n, p->data);
+  int t = c8prod_threads();
+  if ((size_t)t > p->n / C8PROD_LEAF) t = p->n / C8PROD_LEAF;
+  if (t <= 1 || total < C8PROD_PARALLEL_BITS) {
+    (p->leaf)(r, 0, p->n, p->data);
+    return;
+  }
+
+  // Split into subranges of about equal size in bits
+  mpz_t prods[C8PROD_MAX_THREADS];
+  struct c8prod_leaf_job leaves[C8PROD_MAX_THREADS];
+  size_t lo = 0;
+  for (int i=0; i<t; ++i) {
+    size_t hi = p->n;
+    if (i < t-1) {
+      double target = total * (i+1) / t;
+      size_t a = lo + 1, b = p->n;
+      while (a < b) {
+        size_t m = a + (b - a) / 2;
+        if ((p->bits)(m, p->data) < target) a = m + 1;
+        else b = m;
+      }
+      hi = a;
+    }
+    mpz_init(prods[i]);
+    leaves[i].p = p;
+    leaves[i].lo = lo;
+    leaves[i].hi = hi;
+    leaves[i].r = prods[i];
+    lo = hi;
+  }
+  c8prod_run_jobs(c8prod_leaf_job, leaves, sizeof(leaves[0]), t);
+
+  // Merge neighbouring products, which are of similar size, in parallel
+  for (int m=t; m>1; m=(m+1)/2) {
+    struct c8prod_merge_job merges[C8PROD_MAX_THREADS];
+    int h = m / 2;
+    for (int i=0; i<h; ++i) {
+      merges[i].a = prods[2*i];
+      merges[i].b = prods[2*i+1];
+    }
+    c8prod_run_jobs(c8prod_merge_job, merges, sizeof(merges[0]), h);
+    for (int i=0; i<h; ++i) mpz_swap(prods[i], prods[2*i]);
+    if (m % 2) mpz_swap(prods[h], prods[m-1]);
+  }
+  mpz_swap(r, prods[0]);
+  for (int i=0; i<t; ++i) mpz_clear(prods[i]);
+}
+
+/* Sequences of unsigned longs, either consecutive from base or listed in v
+ */
+struct c8prod_ulongs {
+  unsigned long base;
+  const unsigned long* v;
+};
+
+static void c8prod_ulongs_leaf(mpz_ptr r, size_t lo, size_t hi, const void* data)
+{
+  const struct c8prod_ulongs* s = data;
+  if (hi - lo <= C8PROD_LEAF) {
+    mpz_set_ui(r, 1);
+    unsigned long acc = 1;
+    for (size_t i=lo; i<hi; ++i) {
+      unsigned long x = s->v ? s->v[i] : s->base + i;
+      if (x && acc > ULONG_MAX / x) {
+        mpz_mul_ui(r, r, acc);
+        acc = 1;
+      }
+      acc *= x;
+    }
+    mpz_mul_ui(r, r, acc);
+    return;
+  }
+  size_t mid = lo + (hi - lo) / 2;
+  mpz_t t;
+  mpz_init(t);
+  c8prod_ulongs_leaf(r, lo, mid, data);
+  c8prod_ulongs_leaf(t, mid, hi, data);
+  mpz_mul(r, r, t);
+  mpz_clear(t);
+}
+
+// Sum of log2 k for k in [base, base + i)
+static double c8prod_range_bits(size_t i, const void* data)
+{
+  const struct c8prod_ulongs* s = data;
+  return (lgamma((double)s->base + i) - lgamma((double)s->base)) / M_LN2;
+}
+
+// Sum of log2 p for the first i primes, which is close to the last of them
+static double c8prod_primes_bits(size_t i, const void* data)
+{
+  const struct c8prod_ulongs* s = data;
+  return i ? s->v[i-1] / M_LN2 : 0;
+}
+
+// Product of the integers from lo to hi
+static void c8prod_range_run(mpz_ptr r, unsigned long lo, unsigned long hi)
+{
+  struct c8prod_ulongs s = { lo, 0 };
+  struct c8prod p = { hi - lo + 1, c8prod_ulongs_leaf, c8prod_range_bits, &s };
+  c8prod_run(r, &p);
+}
+
+void c8prod_factorial(mpz_ptr r, unsigned long n)
+{
+  if (n < 2 || !c8prod_parallel(lgamma((double)n + 1) / M_LN2)) {
+    mpz_fac_ui(r, n);
+    return;
+  }
+  c8prod_range_run(r, 2, n);
+}
+
+void c8prod_range(mpz_ptr r, unsigned long lo, unsigned long hi)
+{
+  if (lo > hi) {
+    mpz_set_ui(r, 1);
+    return;
+  }
+  if (lo == 0) {
+    mpz_set_ui(r, 0);
+    return;
+  }
+  c8prod_range_run(r, lo, hi);
+}
+
+void c8prod_binomial(mpz_ptr r, unsigned long n, unsigned long k)
+{
+  if (k > n) {
+    mpz_set_ui(r, 0);
+    return;
+  }
+  if (k > n - k) k = n - k;
+  double bits = (lgamma((double)n + 1) - lgamma((double)n - k + 1)) / M_LN2;
+  if (k < 2 || !c8prod_parallel(bits)) {
+    mpz_bin_uiui(r, n, k);
+    return;
+  }
+  mpz_t d;
+  mpz_init(d);
+  c8prod_range_run(r, n - k + 1, n);
+  c8prod_factorial(d, k);
+  mpz_divexact(r, r, d);
+  mpz_clear(d);
+}
+
+void c8prod_primorial(mpz_ptr r, unsigned long n)
+{
+  if (!c8prod_parallel(n / M_LN2)) {
+    mpz_primorial_ui(r, n);
+    return;
+  }
+
+  // Sieve of Eratosthenes over odd numbers
+  size_t nodd = (n - 1) / 2; // odd numbers 3..n
+  char* composite = calloc(nodd + 1, 1);
+  assert(composite);
+  for (unsigned long i=3; i*i<=n; i+=2) {
+    if (composite[(i-3)/2]) continue;
+    for (unsigned long j=i*i; j<=n; j+=2*i) composite[(j-3)/2] = 1;
+  }
+  size_t np = 1;
+  for (size_t i=0; i<nodd; ++i) np += !composite[i];
+  unsigned long* primes = malloc(np * sizeof(unsigned long));
+  assert(primes);
+  np = 0;
+  primes[np++] = 2;
+  for (size_t i=0; i<nodd; ++i) {
+    if (!composite[i]) primes[np++] = 2*i + 3;
+  }
+  free(composite);
+
+  struct c8prod_ulongs s = { 0, primes };
+  struct c8prod p = { np, c8prod_ulongs_leaf, c8prod_primes_bits, &s };
+  c8prod_run(r, &p);
+  free(primes);
+}
+
+/* Lists of mpz values, with the sizes of their prefixes in bits
+ */
+struct c8prod_mpzs {
+  mpz_srcptr* v;
+  double* bits;
+};
+
+static void c8prod_mpzs_leaf(mpz_ptr r, size_t lo, size_t hi, const void* data)
+{
+  const struct c8prod_mpzs* s = data;
+  if (hi - lo == 0) {
+    mpz_set_ui(r, 1);
+  } else if (hi - lo == 1) {
+    mpz_set(r, s->v[lo]);
+  } else {
+    size_t mid = lo + (hi - lo) / 2;
+    mpz_t t;
+    mpz_init(t);
+    c8prod_mpzs_leaf(r, lo, mid, data);
+    c8prod_mpzs_leaf(t, mid, hi, data);
+    mpz_mul(r, r, t);
+    mpz_clear(t);
+  }
+}
+
+static double c8prod_mpzs_bits(size_t i, const void* data)
+{
+  const struct c8prod_mpzs* s = data;
+  return s->bits[i];
+}
+
+void c8prod_mpz(mpz_ptr r, mpz_srcptr* v, size_t n)
+{
+  double* bits = malloc((n + 1) * sizeof(double));
+  assert(bits);
+  bits[0] = 0;
+  for (size_t i=0; i<n; ++i) bits[i+1] = bits[i] + mpz_sizeinbase(v[i], 2);
+  struct c8prod_mpzs s = { v, bits };
+  struct c8prod p = { n, c8prod_mpzs_leaf, c8prod_mpzs_bits, &s };
+  c8prod_run(r, &p);
+  free(bits);
+}
@@ -0,0 +1,54 @@
+/** c8prod - parallel product trees of integers
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gmp.h>
+#include <stddef.h>
+
+/** A product of n factors, which is split into subranges of factors
+ * computed in parallel. leaf computes the product of factors [lo, hi)
+ * sequentially, and bits gives the approximate total size in bits of
+ * factors [0, i), used to balance the work.
+ */
+struct c8prod {
+  size_t n;
+  void (*leaf)(mpz_ptr r, size_t lo, size_t hi, const void* data);
+  double (*bits)(size_t i, const void* data);
+  const void* data;
+};
+
+/** Compute a product, in parallel if it is large enough
+ */
+void c8prod_run(mpz_ptr r, const struct c8prod* p);
+
+/** Products of common sequences, using GMP's own functions when small
+ */
+void c8prod_factorial(mpz_ptr r, unsigned long n);
+void c8prod_range(mpz_ptr r, unsigned long lo, unsigned long hi);
+void c8prod_binomial(mpz_ptr r, unsigned long n, unsigned long k);
+void c8prod_primorial(mpz_ptr r, unsigned long n);
+void c8prod_mpz(mpz_ptr r, mpz_srcptr* v, size_t n);
+
+/** Number of threads used for large products, defaulting to the number of
+ * processors online
+ */
+int c8prod_threads();
+void c8prod_set_threads(int n);
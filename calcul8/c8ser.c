@@ -0,0 +1,519 @@
+/** c8ser - binary serialization of objects
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "c8ser.h"
+#include "c8obj.h"
+#include "c8buf.h"
+#include "c8error.h"
+#include "c8bool.h"
+#include "c8string.h"
+#include "c8list.h"
+#include "c8map.h"
+#include "c8func.h"
+#include "c8ctx.h"
+#include "c8mpz.h"
+#include "c8mpq.h"
+#include "c8mpfr.h"
+#include "c8f64.h"
+#include "c8mpc.h"
+#include "c8num.h"
+
+#include <gmp.h>
+#include <mpfr.h>
+#include <mpc.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The header is the magic followed by the version as a 32 bit integer.
+// Integers are little endian, and each value is a tag followed by its
+// encoding.
+#define C8SER_MAGIC "c8r\x1a"
+
+#define C8SER_NULL 0
+#define C8SER_FALSE 1
+#define C8SER_TRUE 2
+#define C8SER_MPZ 3 // sign byte, then the magnitude as 64 bit words
+#define C8SER_MPQ 4 // numerator and denominator as above
+#define C8SER_MPFR 5 // precision, kind, then exponent and mantissa
+#define C8SER_F64 6 // IEEE double as a 64 bit integer
+#define C8SER_MPC 7 // real and imaginary parts as mpfr
+#define C8SER_STRING 8 // length, then bytes
+#define C8SER_LIST 9 // count, then values
+#define C8SER_MAP 10 // count, then keys and values
+
+#define C8SER_MPFR_ZERO 0
+#define C8SER_MPFR_NUMBER 1
+#define C8SER_MPFR_INF 2
+#define C8SER_MPFR_NAN 3
+
+// Limit on nesting of lists and maps, which is also what stops encoding
+// of containers that hold themselves
+#define C8SER_DEPTH 256
+
+static void c8ser_put(struct c8buf* buf, const void* data, size_t n)
+{
+  memcpy(c8buf_reserve(buf, n), data, n);
+  c8buf_commit(buf, n);
+}
+
+static void c8ser_put_u8(struct c8buf* buf, int x)
+{
+  unsigned char c = x;
+  c8ser_put(buf, &c, 1);
+}
+
+static void c8ser_put_u64(struct c8buf* buf, uint64_t x)
+{
+  unsigned char b[8];
+  for (int i=0; i<8; ++i) b[i] = x >> (8*i);
+  c8ser_put(buf, b, 8);
+}
+
+static void c8ser_put_mpz(struct c8buf* buf, mpz_srcptr v)
+{
+  c8ser_put_u8(buf, mpz_sgn(v) < 0);
+  size_t words = (mpz_sizeinbase(v, 2) + 63) / 64;
+  if (!mpz_sgn(v)) words = 0;
+  c8ser_put_u64(buf, words);
+  // Exported straight into the buffer
+  size_t count = 0;
+  mpz_export(c8buf_reserve(buf, words * 8), &count, -1, 8, -1, 0, v);
+  assert(count == words);
+  c8buf_commit(buf, words * 8);
+}
+
+static void c8ser_put_mpfr(struct c8buf* buf, mpfr_srcptr v)
+{
+  c8ser_put_u64(buf, mpfr_get_prec(v));
+  if (mpfr_nan_p(v)) {
+    c8ser_put_u8(buf, C8SER_MPFR_NAN);
+  } else if (mpfr_inf_p(v) || mpfr_zero_p(v)) {
+    c8ser_put_u8(buf, mpfr_inf_p(v) ? C8SER_MPFR_INF : C8SER_MPFR_ZERO);
+    c8ser_put_u8(buf, mpfr_signbit(v) != 0);
+  } else {
+    // The value is m * 2^e for an integer m of at most the precision
+    c8ser_put_u8(buf, C8SER_MPFR_NUMBER);
+    mpz_t m;
+    mpz_init(m);
+    mpfr_exp_t e = mpfr_get_z_2exp(m, v);
+    c8ser_put_u64(buf, (uint64_t)(int64_t)e);
+    c8ser_put_mpz(buf, m);
+    mpz_clear(m);
+  }
+}
+
+static int c8ser_put_obj(struct c8buf* buf, const struct c8obj* o, int depth)
+{
+  if (!o) {
+    c8ser_put_u8(buf, C8SER_NULL);
+    return 0;
+  }
+  const struct c8bool* bo = to_const_c8bool(o);
+  if (bo) {
+    c8ser_put_u8(buf, c8bool_value(bo) ? C8SER_TRUE : C8SER_FALSE);
+    return 0;
+  }
+  const struct c8mpz* zo = to_const_c8mpz(o);
+  if (zo) {
+    c8ser_put_u8(buf, C8SER_MPZ);
+    c8ser_put_mpz(buf, c8mpz_value(zo));
+    return 0;
+  }
+  const struct c8mpq* qo = to_const_c8mpq(o);
+  if (qo) {
+    c8ser_put_u8(buf, C8SER_MPQ);
+    c8ser_put_mpz(buf, mpq_numref(c8mpq_value(qo)));
+    c8ser_put_mpz(buf, mpq_denref(c8mpq_value(qo)));
+    return 0;
+  }
+  const struct c8mpfr* fo = to_const_c8mpfr(o);
+  if (fo) {
+    c8ser_put_u8(buf, C8SER_MPFR);
+    c8ser_put_mpfr(buf, c8mpfr_value(fo));
+    return 0;
+  }
+  const struct c8f64* do_ = to_const_c8f64(o);
+  if (do_) {
+    double d = c8f64_value(do_);
+    uint64_t x;
+    memcpy(&x, &d, 8);
+    c8ser_put_u8(buf, C8SER_F64);
+    c8ser_put_u64(buf, x);
+    return 0;
+  }
+  const struct c8mpc* co = to_const_c8mpc(o);
+  if (co) {
+    c8ser_put_u8(buf, C8SER_MPC);
+    c8ser_put_mpfr(buf, mpc_realref(c8mpc_value(co)));
+    c8ser_put_mpfr(buf, mpc_imagref(c8mpc_value(co)));
+    return 0;
+  }
+  const struct c8string* so = to_const_c8string(o);
+  if (so) {
+    c8ser_put_u8(buf, C8SER_STRING);
+    c8ser_put_u64(buf, c8string_len(so));
+    c8ser_put(buf, c8string_chars(so), c8string_len(so));
+    return 0;
+  }
+  const struct c8list* lo = to_const_c8list(o);
+  const struct c8map* mo = to_const_c8map(o);
+  if ((lo || mo) && depth >= C8SER_DEPTH) return C8_ERROR_ARGUMENT;
+  if (lo) {
+    c8ser_put_u8(buf, C8SER_LIST);
+    int n = c8list_size(lo);
+    c8ser_put_u64(buf, n);
+    for (int i=0; i<n; ++i) {
+      int err = c8ser_put_obj(buf, c8list_peek(lo, i), depth+1);
+      if (err) return err;
+    }
+    return 0;
+  }
+  if (mo) {
+    c8ser_put_u8(buf, C8SER_MAP);
+    struct c8list* keys = c8map_keys(mo);
+    int n = c8list_size(keys);
+    c8ser_put_u64(buf, n);
+    int err = 0;
+    for (int i=0; i<n && !err; ++i) {
+      const struct c8obj* k = c8list_peek(keys, i);
+      err = c8ser_put_obj(buf, k, depth+1);
+      if (!err) err = c8ser_put_obj(buf, c8map_peek_obj(mo, k), depth+1);
+    }
+    c8obj_unref((struct c8obj*)keys);
+    return err;
+  }
+  return C8_ERROR_ARGUMENT;
+}
+
+int c8ser_encode(struct c8buf* buf, const struct c8obj* o)
+{
+  int len = c8buf_len(buf);
+  c8ser_put(buf, C8SER_MAGIC, 4);
+  unsigned char v[4] = {C8SER_VERSION, 0, 0, 0};
+  c8ser_put(buf, v, 4);
+  int err = c8ser_put_obj(buf, o, 0);
+  if (err) {
+    // Drop what was written
+    c8buf_truncate(buf, len);
+  }
+  return err;
+}
+
+/* Decoding, from bytes which may have been mapped from a file
+ */
+struct c8ser_in {
+  const unsigned char* p;
+  size_t n;
+  int bad;
+  int depth;
+};
+
+static const unsigned char* c8ser_get(struct c8ser_in* in, uint64_t n)
+{
+  if (in->bad || n > in->n) {
+    in->bad = 1;
+    return 0;
+  }
+  const unsigned char* p = in->p;
+  in->p += n;
+  in->n -= n;
+  return p;
+}
+
+static int c8ser_get_u8(struct c8ser_in* in)
+{
+  const unsigned char* p = c8ser_get(in, 1);
+  return p ? p[0] : -1;
+}
+
+static uint64_t c8ser_get_u64(struct c8ser_in* in)
+{
+  const unsigned char* p = c8ser_get(in, 8);
+  uint64_t x = 0;
+  if (p) for (int i=0; i<8; ++i) x |= (uint64_t)p[i] << (8*i);
+  return x;
+}
+
+static void c8ser_get_mpz(struct c8ser_in* in, mpz_ptr v)
+{
+  int neg = c8ser_get_u8(in);
+  uint64_t words = c8ser_get_u64(in);
+  const unsigned char* p = (words <= in->n / 8) ? c8ser_get(in, words * 8) : 0;
+  if (!p || (neg != 0 && neg != 1)) {
+    in->bad = 1;
+    mpz_set_ui(v, 0);
+    return;
+  }
+  mpz_import(v, words, -1, 8, -1, 0, p);
+  if (neg) mpz_neg(v, v);
+}
+
+// Initialises v, which must then be cleared whether or not in->bad is set
+static void c8ser_get_mpfr(struct c8ser_in* in, mpfr_ptr v)
+{
+  uint64_t prec = c8ser_get_u64(in);
+  int kind = c8ser_get_u8(in);
+  if (prec < MPFR_PREC_MIN || prec > (uint64_t)MPFR_PREC_MAX) in->bad = 1;
+
+  int sign = 0;
+  int64_t e = 0;
+  mpz_t m;
+  mpz_init(m);
+  if (C8SER_MPFR_NUMBER == kind) {
+    // The mantissa is exactly the precision, as mpfr_get_z_2exp gives it
+    e = (int64_t)c8ser_get_u64(in);
+    c8ser_get_mpz(in, m);
+    if (mpz_sizeinbase(m, 2) != prec) in->bad = 1;
+  } else if (C8SER_MPFR_ZERO == kind || C8SER_MPFR_INF == kind) {
+    sign = c8ser_get_u8(in) ? -1 : 1;
+  } else if (C8SER_MPFR_NAN != kind) {
+    in->bad = 1;
+  }
+  if (C8SER_MPFR_NUMBER != kind && prec > (uint64_t)c8num_prec()) {
+    // These have no digits to justify allocating a larger mantissa, so
+    // a short record can't make a large allocation
+    prec = c8num_prec();
+  }
+
+  mpfr_init2(v, in->bad ? MPFR_PREC_MIN : (mpfr_prec_t)prec);
+  if (!in->bad) {
+    switch (kind) {
+      case C8SER_MPFR_NAN: mpfr_set_nan(v); break;
+      case C8SER_MPFR_ZERO: mpfr_set_zero(v, sign); break;
+      case C8SER_MPFR_INF: mpfr_set_inf(v, sign); break;
+      default:
+        // Exact unless the exponent is out of range
+        if (mpfr_set_z_2exp(v, m, e, MPFR_RNDN) != 0) in->bad = 1;
+        break;
+    }
+  }
+  mpz_clear(m);
+}
+
+static struct c8obj* c8ser_get_obj(struct c8ser_in* in)
+{
+  int tag = c8ser_get_u8(in);
+  switch (tag) {
+    case C8SER_NULL:
+      return 0;
+    case C8SER_FALSE:
+    case C8SER_TRUE:
+      return (struct c8obj*)c8bool_create(C8SER_TRUE == tag);
+    case C8SER_MPZ: {
+      mpz_t v;
+      mpz_init(v);
+      c8ser_get_mpz(in, v);
+      struct c8obj* r = in->bad ? 0 : (struct c8obj*)c8mpz_create_mpz(v);
+      mpz_clear(v);
+      return r;
+    }
+    case C8SER_MPQ: {
+      mpq_t v;
+      mpq_init(v);
+      c8ser_get_mpz(in, mpq_numref(v));
+      c8ser_get_mpz(in, mpq_denref(v));
+      struct c8obj* r = 0;
+      if (mpz_sgn(mpq_denref(v)) <= 0) {
+        in->bad = 1;
+      } else if (!in->bad) {
+        r = mpz_cmp_ui(mpq_denref(v), 1) == 0 ?
+          (struct c8obj*)c8mpz_create_mpz(mpq_numref(v)) :
+          (struct c8obj*)c8mpq_create_mpq(v);
+      }
+      mpq_clear(v);
+      return r;
+    }
+    case C8SER_MPFR: {
+      mpfr_t v;
+      c8ser_get_mpfr(in, v);
+      struct c8obj* r = in->bad ? 0 : (struct c8obj*)c8mpfr_create_exact(v);
+      mpfr_clear(v);
+      return r;
+    }
+    case C8SER_F64: {
+      uint64_t x = c8ser_get_u64(in);
+      double d;
+      memcpy(&d, &x, 8);
+      return in->bad ? 0 : (struct c8obj*)c8f64_create(d);
+    }
+    case C8SER_MPC: {
+      mpc_t v;
+      c8ser_get_mpfr(in, mpc_realref(v));
+      c8ser_get_mpfr(in, mpc_imagref(v));
+      struct c8obj* r = in->bad ? 0 : (struct c8obj*)c8mpc_create_exact(v);
+      mpc_clear(v);
+      return r;
+    }
+    case C8SER_STRING: {
+      uint64_t n = c8ser_get_u64(in);
+      const unsigned char* p = (n < INT32_MAX) ? c8ser_get(in, n) : 0;
+      if (!p) {
+        in->bad = 1;
+        return 0;
+      }
+      struct c8buf b;
+      c8buf_init(&b);
+      c8ser_put(&b, p, n);
+      struct c8string* r = c8string_create_buf(&b);
+      c8buf_clear(&b);
+      return (struct c8obj*)r;
+    }
+    case C8SER_LIST:
+    case C8SER_MAP: {
+      uint64_t n = c8ser_get_u64(in);
+      // Each value takes at least a byte
+      if (n > in->n || ++in->depth > C8SER_DEPTH) {
+        in->bad = 1;
+        return 0;
+      }
+      struct c8obj* r = 0;
+      if (C8SER_LIST == tag) {
+        struct c8list* l = c8list_create();
+        for (uint64_t i=0; i<n && !in->bad; ++i) {
+          struct c8obj* v = c8ser_get_obj(in);
+          c8list_push_back(l, v);
+          if (v) c8obj_unref(v);
+        }
+        r = (struct c8obj*)l;
+      } else {
+        struct c8map* m = c8map_create();
+        for (uint64_t i=0; i<n && !in->bad; ++i) {
+          struct c8obj* k = c8ser_get_obj(in);
+          struct c8obj* v = k ? c8ser_get_obj(in) : 0;
+          if (k && !in->bad) c8map_set_obj(m, k, v);
+          else in->bad = 1;
+          if (k) c8obj_unref(k);
+          if (v) c8obj_unref(v);
+        }
+        r = (struct c8obj*)m;
+      }
+      --in->depth;
+      return r;
+    }
+  }
+  in->bad = 1;
+  return 0;
+}
+
+struct c8obj* c8ser_decode(const void* data, size_t n)
+{
+  struct c8ser_in in = {data, n, 0, 0};
+  const unsigned char* h = c8ser_get(&in, 8);
+  if (!h || memcmp(h, C8SER_MAGIC, 4) != 0)
+    return (struct c8obj*)c8error_create(C8_ERROR_FORMAT);
+  uint32_t version = h[4] | h[5] << 8 | h[6] << 16 | (uint32_t)h[7] << 24;
+  if (version == 0 || version > C8SER_VERSION)
+    return (struct c8obj*)c8error_create(C8_ERROR_FORMAT);
+
+  struct c8obj* r = c8ser_get_obj(&in);
+  if (in.bad || in.n) {
+    if (r) c8obj_unref(r);
+    return (struct c8obj*)c8error_create(C8_ERROR_FORMAT);
+  }
+  return r;
+}
+
+int c8ser_save(const struct c8obj* o, const char* file)
+{
+  struct c8buf buf;
+  c8buf_init(&buf);
+  int err = c8ser_encode(&buf, o);
+  if (!err) {
+    FILE* f = fopen(file, "wb");
+    if (!f) {
+      err = C8_ERROR_FILE;
+    } else {
+      size_t n = c8buf_len(&buf);
+      if (fwrite(c8buf_str(&buf), 1, n, f) != n) err = C8_ERROR_FILE;
+      if (fclose(f) != 0) err = C8_ERROR_FILE;
+    }
+  }
+  c8buf_clear(&buf);
+  return err;
+}
+
+struct c8obj* c8ser_load(const char* file)
+{
+  int fd = open(file, O_RDONLY);
+  if (fd < 0)
+    return (struct c8obj*)c8error_create_arg(C8_ERROR_FILE, file);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return (struct c8obj*)c8error_create(C8_ERROR_FORMAT);
+  }
+  void* data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return (struct c8obj*)c8error_create_arg(C8_ERROR_FILE, file);
+  struct c8obj* r = c8ser_decode(data, st.st_size);
+  munmap(data, st.st_size);
+  return r;
+}
+
+void c8ser_init_ctx(struct c8ctx* ctx)
+{
+  c8ctx_add(ctx, "save", (struct c8obj*)c8func_create(c8ser_save_func));
+  c8ctx_add(ctx, "load", (struct c8obj*)c8func_create(c8ser_load_func));
+}
+
+// Copy a file name, as a string's characters needn't be terminated.
+// Returns zero for a string which can't be a file name.
+static int c8ser_path(struct c8buf* path, const struct c8string* f)
+{
+  c8buf_init(path);
+  int len = f ? c8string_len(f) : 0;
+  if (len == 0 || memchr(c8string_chars(f), 0, len)) return 0;
+  c8buf_append_strn(path, c8string_chars(f), len);
+  return 1;
+}
+
+struct c8obj* c8ser_save_func(struct c8list* args)
+{
+  if (c8list_size(args) != 2)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8buf path;
+  if (!c8ser_path(&path, to_const_c8string(c8list_peek(args, 1))))
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* r = 0;
+  int err = c8ser_save(c8list_peek(args, 0), c8buf_str(&path));
+  if (err) r = (struct c8obj*)c8error_create_arg(err, c8buf_str(&path));
+  else r = (struct c8obj*)c8bool_create(1);
+  c8buf_clear(&path);
+  return r;
+}
+
+struct c8obj* c8ser_load_func(struct c8list* args)
+{
+  if (c8list_size(args) != 1)
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8buf path;
+  if (!c8ser_path(&path, to_const_c8string(c8list_peek(args, 0))))
+    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  struct c8obj* r = c8ser_load(c8buf_str(&path));
+  c8buf_clear(&path);
+  return r;
+}
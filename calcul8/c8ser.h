@@ -0,0 +1,62 @@
+/** c8ser - binary serialization of objects
+ *
+ * Copyright (c) 2017 Andrew Wedgbury <wedge@sconemad.com>
+ *
+ * This file is part of c8r.
+ *
+ * c8r is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * c8r is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with c8r.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+struct c8obj;
+struct c8buf;
+struct c8ctx;
+struct c8list;
+
+/** Version of the encoding, which is written in the header
+ * Versions up to this one can be decoded.
+ */
+#define C8SER_VERSION 1
+
+/** Encode an object, with a header, appending to a buffer
+ * Numbers, booleans, strings, and lists and maps of them can be encoded,
+ * nested no deeper than decoding allows. Returns 0 on success, or an error code if some part of the object can't
+ * be encoded, in which case the buffer is left as it was.
+ */
+int c8ser_encode(struct c8buf* buf, const struct c8obj* o);
+
+/** Decode an object, with its header, from n bytes of data
+ * Returns the new object, or an error object if the data isn't valid.
+ */
+struct c8obj* c8ser_decode(const void* data, size_t n);
+
+/** Save an object to a file, returning 0 or an error code
+ */
+int c8ser_save(const struct c8obj* o, const char* file);
+
+/** Load an object from a file, which is mapped rather than read
+ */
+struct c8obj* c8ser_load(const char* file);
+
+/** Add serialization functions to context
+ */
+void c8ser_init_ctx(struct c8ctx* ctx);
+
+/** Functions
+ */
+struct c8obj* c8ser_save_func(struct c8list* args);
+struct c8obj* c8ser_load_func(struct c8list* args);
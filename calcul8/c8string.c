@@ -29,43 +29,177 @@
 #include "c8list.h"
 #include "c8error.h"
 #include "c8mpz.h"
+#include "c8heap.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Character storage shared between strings.
+ * Data is only ever appended, never modified, so a string can safely view
+ * any prefix of it. Concatenating onto a string that ends at the tail of its
+ * storage is then just an append, making repeated s = s + x linear overall.
+ */
+struct c8string_data {
+  int refs;
+  int interned; // Never appended to, and unique for its characters
+  unsigned int hash; // Of all characters, if interned
+  struct c8buf buf;
+};
+
 struct c8string {
   struct c8obj base;
-  struct c8buf buf;
+  struct c8string_data* data;
+  int len;
+  unsigned int hash; // Cached, or 0 if not yet computed
 };
 
+// Interned storage, by hash with linear probing. Entries are removed when
+// the storage is freed, so this holds no references.
+static struct c8string_data** interned = 0;
+static int interned_slots = 0;
+static int interned_size = 0;
+
+static int interned_find(const char* str, int len, unsigned int hash)
+{
+  int s = hash & (interned_slots - 1);
+  for (; interned[s]; s = (s + 1) & (interned_slots - 1)) {
+    const struct c8string_data* d = interned[s];
+    if (d->hash == hash && c8buf_len(&d->buf) == len &&
+        (len == 0 || memcmp(c8buf_str(&d->buf), str, len) == 0)) break;
+  }
+  return s;
+}
+
+static void interned_grow()
+{
+  struct c8string_data** old = interned;
+  int old_slots = interned_slots;
+  interned_slots = interned_slots ? interned_slots * 2 : 64;
+  interned = calloc(interned_slots, sizeof(struct c8string_data*));
+  assert(interned);
+  for (int i=0; i<old_slots; ++i) {
+    struct c8string_data* d = old[i];
+    if (!d) continue;
+    int s = d->hash & (interned_slots - 1);
+    while (interned[s]) s = (s + 1) & (interned_slots - 1);
+    interned[s] = d;
+  }
+  free(old);
+}
+
+static void interned_remove(const struct c8string_data* d)
+{
+  int s = interned_find(c8buf_str(&d->buf), c8buf_len(&d->buf), d->hash);
+  assert(interned[s] == d);
+  interned[s] = 0;
+  --interned_size;
+  // Move back any following entries which would no longer be found
+  for (int i = (s + 1) & (interned_slots - 1); interned[i];
+       i = (i + 1) & (interned_slots - 1)) {
+    int h = interned[i]->hash & (interned_slots - 1);
+    if (((i - h) & (interned_slots - 1)) >= ((i - s) & (interned_slots - 1))) {
+      interned[s] = interned[i];
+      interned[i] = 0;
+      s = i;
+    }
+  }
+}
+
+static struct c8string_data* c8string_data_create()
+{
+  struct c8string_data* d = malloc(sizeof(struct c8string_data));
+  assert(d);
+  d->refs = 1;
+  d->interned = 0;
+  d->hash = 0;
+  c8buf_init(&d->buf);
+  return d;
+}
+
+static void c8string_data_unref(struct c8string_data* d)
+{
+  assert(d->refs > 0);
+  if (--d->refs == 0) {
+    if (d->interned) interned_remove(d);
+    c8buf_clear(&d->buf);
+    free(d);
+  }
+}
+
+/* Share the storage of another string
+ */
+static void c8string_share(struct c8string* oo, const struct c8string* src)
+{
+  ++src->data->refs;
+  c8string_data_unref(oo->data);
+  oo->data = src->data;
+  oo->len = src->len;
+  oo->hash = src->hash;
+}
+
+/* Ensure this string ends at the tail of its storage so it can be appended
+ * to, copying into private storage if another string has appended past it
+ * or the storage is interned.
+ */
+static void c8string_own_tail(struct c8string* oo)
+{
+  if (oo->len == c8buf_len(&oo->data->buf) && !oo->data->interned) return;
+  struct c8string_data* d = c8string_data_create();
+  c8buf_append_strn(&d->buf, c8string_chars(oo), oo->len);
+  c8string_data_unref(oo->data);
+  oo->data = d;
+}
+
+/* Append the string representation of an object
+ */
+static void c8string_append(struct c8string* oo, const struct c8obj* p, int f)
+{
+  c8string_own_tail(oo);
+  const struct c8string* sp = to_const_c8string(p);
+  if (sp && sp->data != oo->data) {
+    c8buf_append_strn(&oo->data->buf, c8string_chars(sp), sp->len);
+  } else if (p) {
+    // Render separately, as p may refer to our own storage which can move
+    struct c8buf tmp; c8buf_init(&tmp);
+    c8obj_str(p, &tmp, f);
+    if (c8buf_len(&tmp)) c8buf_append_buf(&oo->data->buf, &tmp);
+    c8buf_clear(&tmp);
+  }
+  oo->len = c8buf_len(&oo->data->buf);
+  oo->hash = 0;
+}
+
 static void c8string_destroy(struct c8obj* o)
 {
   struct c8string* oo = to_c8string(o);
   assert(oo);
-  c8buf_clear(&oo->buf);
-  free(oo);
+  c8string_data_unref(oo->data);
+  c8heap_free(oo);
 }
 
 static struct c8obj* c8string_copy(const struct c8obj* o)
 {
   const struct c8string* oo = to_const_c8string(o);
   assert(oo);
-  return (struct c8obj*)c8string_create_buf(&oo->buf);
+  // The viewed characters never change, so the copy can share them
+  struct c8string* sr = c8string_create();
+  c8string_share(sr, oo);
+  return (struct c8obj*)sr;
 }
 
 static int c8string_int(const struct c8obj* o)
 {
   const struct c8string* oo = to_const_c8string(o);
   assert(oo);
-  return c8buf_len(&oo->buf);
+  return oo->len;
 }
 
 static void c8string_str(const struct c8obj* o, struct c8buf* buf, int f)
 {
   const struct c8string* oo = to_const_c8string(o);
   assert(oo);
-  c8buf_append_buf(buf, &oo->buf);
+  c8buf_append_strn(buf, c8string_chars(oo), oo->len);
 }
 
 static struct c8obj* c8string_op(struct c8obj* o, int op, struct c8obj* p)
@@ -85,23 +219,37 @@ static struct c8obj* c8string_op(struct c8obj* o, int op, struct c8obj* p)
   switch (op) {
     case C8_OP_ADD: {
       struct c8string* sr = (struct c8string*)c8string_copy(o);
-      c8obj_str(p, &sr->buf, 0);
+      c8string_append(sr, p, 0);
       return (struct c8obj*)sr;
     }
     case C8_OP_ASSIGN: {
-      c8buf_clear(&oo->buf);
-      c8obj_str(p, &oo->buf, 0);
+      struct c8string* sp = to_c8string(p);
+      if (sp) {
+        c8string_share(oo, sp);
+      } else {
+        c8string_data_unref(oo->data);
+        oo->data = c8string_data_create();
+        oo->len = 0;
+        oo->hash = 0;
+        c8string_append(oo, p, 0);
+      }
       return c8obj_ref(o);
     }
     case C8_OP_ADD_ASSIGN: {
-      c8obj_str(p, &oo->buf, 0);
+      c8string_append(oo, p, 0);
       return c8obj_ref(o);
     }
     case C8_OP_EQUALITY: case C8_OP_INEQUALITY: {
+      struct c8string* sp = to_c8string(p);
+      if (sp) {
+        int eq = c8string_equal(oo, sp);
+        return (struct c8obj*)c8bool_create((op==C8_OP_EQUALITY) ? eq : !eq);
+      }
       struct c8buf bp; c8buf_init(&bp);
-      c8obj_str(p, &bp, 0);
-      int cmp = strcmp(c8buf_str(&oo->buf), c8buf_str(&bp));
-      int ret = (op==C8_OP_EQUALITY) ? cmp==0 : cmp!=0;
+      if (p) c8obj_str(p, &bp, 0);
+      int eq = (c8buf_len(&bp) == oo->len) &&
+        memcmp(c8string_chars(oo), bp.len ? c8buf_str(&bp) : "", oo->len) == 0;
+      int ret = (op==C8_OP_EQUALITY) ? eq : !eq;
       c8buf_clear(&bp);
       return (struct c8obj*)c8bool_create(ret);
     }
@@ -109,12 +257,24 @@ static struct c8obj* c8string_op(struct c8obj* o, int op, struct c8obj* p)
   return 0;
 }
 
+static void c8string_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8string* oo = to_const_c8string(o);
+  assert(oo);
+  const struct c8string_data* d = oo->data;
+  st->bytes = sizeof(struct c8string) +
+    (sizeof(struct c8string_data) + d->buf.max) / d->refs;
+}
+
 static const struct c8obj_imp c8string_imp = {
   c8string_destroy,
   c8string_copy,
   c8string_int,
   c8string_str,
-  c8string_op
+  c8string_op,
+  0,
+  c8string_stat,
+  "string"
 };
 
 const struct c8string* to_const_c8string(const struct c8obj* o)
@@ -130,43 +290,130 @@ struct c8string* to_c8string(struct c8obj* o)
 
 struct c8string* c8string_create()
 {
-  struct c8string* oo = malloc(sizeof(struct c8string));
+  struct c8string* oo = c8heap_alloc(sizeof(struct c8string));
   assert(oo);
   c8obj_init(&oo->base, &c8string_imp);
-  c8buf_init(&oo->buf);
+  oo->data = c8string_data_create();
+  oo->len = 0;
+  oo->hash = 0;
   return oo;
 }
 
 struct c8string* c8string_create_str(const char* str)
 {
   struct c8string* oo = c8string_create();
-  c8buf_init_str(&oo->buf, str);
+  c8buf_append_str(&oo->data->buf, str);
+  oo->len = c8buf_len(&oo->data->buf);
   return oo;
 }
 
 struct c8string* c8string_create_buf(const struct c8buf* buf)
 {
   struct c8string* oo = c8string_create();
-  c8buf_init_copy(&oo->buf, buf);
+  if (c8buf_len(buf)) c8buf_append_buf(&oo->data->buf, buf);
+  oo->len = c8buf_len(&oo->data->buf);
+  return oo;
+}
+
+struct c8string* c8string_create_interned(const char* str, int len)
+{
+  if (!len) str = "";
+  unsigned int hash = hash_strn(str, len);
+  if (interned_size * 2 >= interned_slots) interned_grow();
+  int s = interned_find(str, len, hash);
+  struct c8string_data* d = interned[s];
+  if (!d) {
+    d = c8string_data_create();
+    c8buf_append_strn(&d->buf, str, len);
+    d->interned = 1;
+    d->hash = hash;
+    interned[s] = d;
+    ++interned_size;
+  } else {
+    ++d->refs;
+  }
+  struct c8string* oo = c8heap_alloc(sizeof(struct c8string));
+  assert(oo);
+  c8obj_init(&oo->base, &c8string_imp);
+  oo->data = d;
+  oo->len = len;
+  oo->hash = hash;
   return oo;
 }
 
+int c8string_interned(const struct c8string* oo)
+{
+  assert(oo);
+  return oo->data->interned;
+}
+
+int c8string_len(const struct c8string* oo)
+{
+  assert(oo);
+  return oo->len;
+}
+
+const char* c8string_chars(const struct c8string* oo)
+{
+  assert(oo);
+  return oo->len ? c8buf_str(&oo->data->buf) : "";
+}
+
+unsigned int c8string_hash(const struct c8string* oo)
+{
+  assert(oo);
+  if (!oo->hash) {
+    ((struct c8string*)oo)->hash = hash_strn(c8string_chars(oo), oo->len);
+  }
+  return oo->hash;
+}
+
+int c8string_equal(const struct c8string* a, const struct c8string* b)
+{
+  assert(a && b);
+  if (a->len != b->len) return 0;
+  if (a->data == b->data) return 1;
+  if (a->data->interned && b->data->interned) return 0;
+  if (a->hash && b->hash && a->hash != b->hash) return 0;
+  return memcmp(c8string_chars(a), c8string_chars(b), a->len) == 0;
+}
+
 void c8string_init_ctx(struct c8ctx* ctx)
 {
   c8ctx_add(ctx, "str", (struct c8obj*)c8func_create(c8string_to_str));
 }
 
+// Format names for str, indexed by format
+static const char* c8string_fmt_names[] = {
+  "dec", "bin", "oct", "hex", "sci", "fix", 0
+};
+
 struct c8obj* c8string_to_str(struct c8list* args)
 {
-  if (c8list_size(args) != 1)
+  int n = c8list_size(args);
+  if (n < 1 || n > 2)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
   if (!a)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+
+  // Optionally a format by name
+  int f = C8_FMT_DEC;
+  if (n > 1) {
+    const struct c8string* fs = to_const_c8string(c8list_peek(args, 1));
+    if (!fs)
+      return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+    for (f=0; c8string_fmt_names[f]; ++f) {
+      if (strlen(c8string_fmt_names[f]) == (size_t)fs->len &&
+          memcmp(c8string_fmt_names[f], c8string_chars(fs), fs->len) == 0)
+        break;
+    }
+    if (!c8string_fmt_names[f])
+      return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
+  }
   
   struct c8string* oo = c8string_create();
-  c8obj_str(a, &oo->buf, C8_FMT_DEC);
-  c8obj_unref(a);
+  c8string_append(oo, a, f);
   return (struct c8obj*)oo;
 }
 
@@ -174,17 +421,9 @@ struct c8obj* c8string_size(struct c8list* args)
 {
   if (c8list_size(args) != 1)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
-  if (!a)
+  struct c8string* s = to_c8string(c8list_peek(args, 0));
+  if (!s)
     return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  
-  struct c8string* s = to_c8string(a);
-  if (!s) {
-    c8obj_unref(a);
-    return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
-  }
 
-  int len = c8buf_len(&s->buf);
-  c8obj_unref(a);
-  return (struct c8obj*)c8mpz_create_int(len);
+  return (struct c8obj*)c8mpz_create_int(s->len);
 }
@@ -37,6 +37,31 @@ struct c8string* c8string_create();
 struct c8string* c8string_create_str(const char* str);
 struct c8string* c8string_create_buf(const struct c8buf* buf);
 
+/** Create an interned c8string object
+ * Interned strings with the same characters share storage, so can be
+ * compared by pointer.
+ */
+struct c8string* c8string_create_interned(const char* str, int len);
+
+/** Determine whether a string is interned
+ */
+int c8string_interned(const struct c8string* oo);
+
+/** Get the string length and characters
+ * The characters are not necessarily nul-terminated at the string length.
+ */
+int c8string_len(const struct c8string* oo);
+const char* c8string_chars(const struct c8string* oo);
+
+/** Get a hash of the string characters
+ * This is computed once and cached.
+ */
+unsigned int c8string_hash(const struct c8string* oo);
+
+/** Compare the characters of two strings
+ */
+int c8string_equal(const struct c8string* a, const struct c8string* b);
+
 /** Add string functions to context
  */
 void c8string_init_ctx(struct c8ctx* ctx);
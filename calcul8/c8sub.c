@@ -34,6 +34,7 @@
 #include "c8ctx.h"
 #include "c8ops.h"
 #include "c8list.h"
+#include "c8heap.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -165,7 +166,7 @@ static void c8sub_destroy(struct c8obj* o)
 {
   struct c8sub* oo = to_c8sub(o);
   assert(oo);
-  free(oo);
+  c8heap_free(oo);
 }
 
 static struct c8obj* c8sub_copy(const struct c8obj* o)
@@ -201,12 +202,22 @@ static struct c8obj* c8sub_op(struct c8obj* o, int op, struct c8obj* p)
   return 0;
 }
 
+static void c8sub_stat(const struct c8obj* o, struct c8obj_stat* st)
+{
+  const struct c8sub* oo = to_const_c8sub(o);
+  assert(oo);
+  st->bytes = sizeof(struct c8sub);
+}
+
 static const struct c8obj_imp c8sub_imp = {
   c8sub_destroy,
   c8sub_copy,
   c8sub_int,
   c8sub_str,
-  c8sub_op
+  c8sub_op,
+  0,
+  c8sub_stat,
+  "sub"
 };
 
 const struct c8sub* to_const_c8sub(const struct c8obj* o)
@@ -223,10 +234,9 @@ struct c8sub* to_c8sub(struct c8obj* o)
 struct c8sub* c8sub_create(struct c8subdef* def, struct c8script* script)
 {
   assert(def);
-  struct c8sub* oo = malloc(sizeof(struct c8sub));
+  struct c8sub* oo = c8heap_alloc(sizeof(struct c8sub));
   assert(oo);
-  oo->base.refs = 1;
-  oo->base.imp = &c8sub_imp;
+  c8obj_init(&oo->base, &c8sub_imp);
   oo->def = def;
   oo->script = script;
   return oo;
@@ -243,11 +253,13 @@ struct c8obj* c8sub_call(struct c8sub* oo, struct c8list* args)
       return (struct c8obj*)c8error_create(C8_ERROR_ARGUMENT);
     for (int i=0; i<na; ++i) {
       const char* name = (const char*)c8vec_at(&oo->def->args, i);
-      struct c8obj* value = c8list_at(args, i);
+      struct c8obj* value = c8obj_take(c8list_at(args, i));
       c8ctx_add(ctx, name, value);
     }
   }
 
+  // The subroutine's script has its own evaluator, so precision and
+  // rounding set in the subroutine last until it returns
   struct c8ctx* gctx = c8eval_global(c8script_eval(oo->script));
   struct c8script* subscr = c8script_create(gctx);
   c8stmt_run(oo->def->body, subscr);
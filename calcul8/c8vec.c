@@ -22,10 +22,13 @@
 
 #include <assert.h>
 #include <stdlib.h>
-#include <string.h>
+
+// Smallest allocation kept when shrinking
+#define C8VEC_MIN 8
 
 void c8vec_init(struct c8vec* o)
 {
+  o->head = 0;
   o->size = 0;
   o->max = 0;
   o->items = 0;
@@ -43,62 +46,99 @@ int c8vec_size(const struct c8vec* o)
   return o->size;
 }
 
-void* c8vec_at(struct c8vec* o, int i)
+// Position of item i in the ring (max is always a power of 2)
+static int c8vec_pos(const struct c8vec* o, int i)
 {
-  assert(o);
   if (i<0) i = o->size + i;
   assert(i>=0 && i<o->size);
-  return o->items[i];
+  return (o->head + i) & (o->max - 1);
+}
+
+void* c8vec_at(struct c8vec* o, int i)
+{
+  assert(o);
+  return o->items[c8vec_pos(o, i)];
 }
 
 const void* c8vec_const_at(const struct c8vec* o, int i)
 {
   assert(o);
-  if (i<0) i = o->size + i;
-  assert(i>=0 && i<o->size);
-  return o->items[i];
+  return o->items[c8vec_pos(o, i)];
+}
+
+void** c8vec_slot(struct c8vec* o, int i)
+{
+  assert(o);
+  return &o->items[c8vec_pos(o, i)];
 }
 
-static void c8vec_realloc(struct c8vec* o)
+static void c8vec_resize(struct c8vec* o, int max)
 {
   assert(o);
+  assert(max >= o->size);
+  void** items = malloc(max * sizeof(void*));
+  assert(items);
+  // Unwrap the ring into the start of the new buffer
+  for (int i=0; i<o->size; ++i) items[i] = o->items[c8vec_pos(o, i)];
+  free(o->items);
+  o->items = items;
+  o->head = 0;
+  o->max = max;
+}
+
+void c8vec_reserve(struct c8vec* o, int n)
+{
+  assert(o);
+  if (n <= o->max) return;
   // Increase in powers of 2
-  for (o->max=1; o->max<=o->size; o->max*=2) ;
-  o->items = realloc(o->items, o->max * sizeof(void*));
+  int max = 1;
+  while (max < n) max *= 2;
+  c8vec_resize(o, max);
+}
+
+static void c8vec_shrink(struct c8vec* o)
+{
+  // Halve once only a quarter is used, so alternating push/pop around a
+  // boundary doesn't repeatedly reallocate
+  if (o->max > C8VEC_MIN && o->size <= o->max / 4) {
+    c8vec_resize(o, o->max / 2);
+  }
 }
 
 void c8vec_push_back(struct c8vec* o, void* item)
 {
   assert(o);
+  c8vec_reserve(o, o->size + 1);
+  o->items[(o->head + o->size) & (o->max - 1)] = item;
   ++o->size;
-  if (o->size > o->max) c8vec_realloc(o);
-  o->items[o->size-1] = item;
 }
 
 void* c8vec_pop_back(struct c8vec* o)
 {
   assert(o);
   assert(o->size > 0);
-  --o->size; //xxx need to realloc if reduced significantly?
-  return o->items[o->size];
+  void* r = o->items[c8vec_pos(o, -1)];
+  --o->size;
+  c8vec_shrink(o);
+  return r;
 }
 
 void c8vec_push_front(struct c8vec* o, void* item)
 {
   assert(o);
-  int psize = o->size;
+  c8vec_reserve(o, o->size + 1);
+  o->head = (o->head - 1) & (o->max - 1);
+  o->items[o->head] = item;
   ++o->size;
-  if (o->size > o->max) c8vec_realloc(o);
-  memmove(&o->items[1], o->items, psize * sizeof(void*));
-  o->items[0] = item;
 }
 
 void* c8vec_pop_front(struct c8vec* o)
 {
   assert(o);
   assert(o->size > 0);
-  void* r = o->items[0];
-  --o->size; //xxx need to realloc if reduced significantly?
-  memmove(o->items, &o->items[1], o->size * sizeof(void*));
+  void* r = o->items[o->head];
+  o->head = (o->head + 1) & (o->max - 1);
+  --o->size;
+  c8vec_shrink(o);
   return r;
 }
@@ -21,9 +21,12 @@
 #pragma once
 
 /** Generic vector struct
+ * Items are held in a ring buffer, so pushing and popping at either end
+ * are constant time.
  */
 struct c8vec {
   void** items;
+  int head;
   int size;
   int max;
 };
@@ -34,6 +37,14 @@ void c8vec_clear(struct c8vec* o);
 int c8vec_size(const struct c8vec* o);
 void* c8vec_at(struct c8vec* o, int i);
 const void* c8vec_const_at(const struct c8vec* o, int i);
+
+/** Get the address of an item, valid until the vector is next modified
+ */
+void** c8vec_slot(struct c8vec* o, int i);
+
+/** Ensure space for at least n items without further allocation
+ */
+void c8vec_reserve(struct c8vec* o, int n);
   
 void c8vec_push_back(struct c8vec* o, void* item);
 void* c8vec_pop_back(struct c8vec* o);
@@ -22,13 +22,19 @@
 
 #include "c8version.h"
 #include "c8buf.h"
+#include "c8fmt.h"
 #include "c8ops.h"
 #include "c8obj.h"
 #include "c8error.h"
 #include "c8string.h"
 #include "c8num.h"
 #include "c8mpz.h"
+#include "c8prod.h"
+#include "c8memo.h"
+#include "c8mpq.h"
 #include "c8mpfr.h"
+#include "c8ival.h"
+#include "c8f64.h"
 #include "c8mpc.h"
 #include "c8list.h"
 #include "c8eval.h"
@@ -36,4 +42,7 @@
 #include "c8script.h"
 #include "c8ctx.h"
 #include "c8func.h"
+#include "c8gc.h"
+#include "c8heap.h"
+#include "c8ser.h"
 #include "c8debug.h"
@@ -31,6 +31,7 @@ void evaluate(const char* line)
 {
   struct c8ctx* ctx = c8ctx_create();
   c8mpfr_init_ctx(ctx);
+  c8ival_init_ctx(ctx);
   c8mpz_init_ctx(ctx);
 
   struct c8buf ver; c8buf_init(&ver);
@@ -30,6 +30,7 @@ static struct c8ctx* ctx;
 static struct c8script* script;
 static struct c8eval* eval;
 static int debug_level = 0;
+static int fast_real = 0;
 
 int print_usage(const char* pgm)
 {
@@ -37,6 +38,9 @@ int print_usage(const char* pgm)
          "Options:\n"
          "  -v      print version info\n"
          "  -dN     use debug level N (0...4)\n"
+         "  -gN     collect cycles every N candidates (0 disables)\n"
+         "  -f      use fast double precision reals\n"
+         "  -pN     use N bits of precision for reals\n"
          "\n", pgm);
   return 0;
 }
@@ -129,12 +133,18 @@ struct c8obj* print(struct c8list* args)
 {
   if (c8list_size(args) != 1) 
     return (struct c8obj*) c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
+  const struct c8mpz* z = to_const_c8mpz(a);
+  if (z) {
+    // Stream integers, which may be too large to hold as a string
+    c8fmt_mpz_write(c8mpz_value(z), 10, c8fmt_file_sink, stdout);
+    printf("\n");
+    return 0;
+  }
   struct c8buf m; c8buf_init(&m);
   c8obj_str(a, &m, C8_FMT_DEC);
   printf("%s\n", c8buf_str(&m));
   c8buf_clear(&m);
-  c8obj_unref(a);
   return 0;
 }
 
@@ -142,12 +152,11 @@ struct c8obj* run(struct c8list* args)
 {
   if (c8list_size(args) != 1)
     return (struct c8obj*) c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
   struct c8buf m; c8buf_init(&m);
   c8obj_str(a, &m, C8_FMT_DEC);
   run_script(c8buf_str(&m));
   c8buf_clear(&m);
-  c8obj_unref(a);
   return 0;
 }
 
@@ -155,9 +164,8 @@ struct c8obj* debug(struct c8list* args)
 {
   if (c8list_size(args) != 1) 
     return (struct c8obj*) c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* a = c8list_at(args, 0);
+  struct c8obj* a = c8list_peek(args, 0);
   c8debug_level(c8obj_int(a));
-  c8obj_unref(a);
   return 0;
 }
 
@@ -165,14 +173,12 @@ struct c8obj* test(struct c8list* args)
 {
   if (c8list_size(args) < 1 || c8list_size(args) > 2)
     return (struct c8obj*) c8error_create(C8_ERROR_ARGUMENT);
-  struct c8obj* cond = c8list_at(args, 0);
+  struct c8obj* cond = c8list_peek(args, 0);
   if (c8obj_int(cond) == 0) {
 
     struct c8buf msg; c8buf_init(&msg);
     if (c8list_size(args) == 2) {
-      struct c8obj* omsg = c8list_at(args, 1);
-      c8obj_str(omsg, &msg, C8_FMT_DEC);
-      c8obj_unref(omsg);
+      c8obj_str(c8list_peek(args, 1), &msg, C8_FMT_DEC);
     }
 
     c8debug(C8_DEBUG_ERROR, "script:%d: Test failed: %s",
@@ -180,7 +186,6 @@ struct c8obj* test(struct c8list* args)
     c8buf_clear(&msg);
     exit(1);
   }
-  c8obj_unref(cond);
   return 0;
 }
 
@@ -188,11 +193,19 @@ int main(int argc, char* argv[])
 {
   int c;
   extern char* optarg;
-  while ((c = getopt(argc, argv,"?vd:")) >= 0) {
+  while ((c = getopt(argc, argv,"?vd:g:fp:")) >= 0) {
     switch (c) {
     case '?': return print_usage(argv[0]);
     case 'v': return print_version();
     case 'd': debug_level = atoi(optarg); break;
+    case 'g': c8gc_threshold(atoi(optarg)); break;
+    case 'f': fast_real = 1; break;
+    case 'p': {
+      long bits = 0;
+      if (!c8num_prec_parse(optarg, &bits)) return print_usage(argv[0]);
+      c8num_set_prec(bits);
+      break;
+    }
     }
   }
 
@@ -201,8 +214,13 @@ int main(int argc, char* argv[])
   c8string_init_ctx(ctx);
   c8num_init_ctx(ctx);
   c8mpz_init_ctx(ctx);
+  c8mpq_init_ctx(ctx);
   c8mpfr_init_ctx(ctx);
+  c8ival_init_ctx(ctx);
+  if (fast_real) c8f64_init_ctx(ctx);
   c8mpc_init_ctx(ctx);
+  c8heap_init_ctx(ctx);
+  c8ser_init_ctx(ctx);
   c8ctx_add(ctx, "print", (struct c8obj*)c8func_create(print));
   c8ctx_add(ctx, "run", (struct c8obj*)c8func_create(run));
   c8ctx_add(ctx, "debug", (struct c8obj*)c8func_create(debug));